@@ -0,0 +1,68 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/aabb.hpp>
+#include <emath/aabb3.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<typename V>
+std::vector<V> random_points(size_t n)
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> dist(-1000, 1000);
+	std::vector<V> points(n);
+	for (V& p : points) {
+		for (int d = 0; d < int(sizeof(V) / sizeof(float)); ++d) { p[d] = dist(rng); }
+	}
+	return points;
+}
+
+} // namespace
+
+static void BM_AABB2_FromPoints(benchmark::State& state)
+{
+	const auto points = random_points<Vec2f>(size_t(state.range(0)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(AABB2f::from_points(points.data(), points.size()));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AABB2_FromPoints)->Arg(1000)->Arg(1000000);
+
+static void BM_AABB3_FromPoints(benchmark::State& state)
+{
+	const auto points = random_points<Vec3f>(size_t(state.range(0)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(AABB3f::from_points(points.data(), points.size()));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AABB3_FromPoints)->Arg(1000)->Arg(1000000);
+
+/// The include() loop that from_points replaced.
+static void BM_AABB3_IncludeLoop(benchmark::State& state)
+{
+	const auto points = random_points<Vec3f>(size_t(state.range(0)));
+	for (auto _ : state) {
+		AABB3f box = AABB3f::nothing();
+		for (const Vec3f& p : points) { box.include(p); }
+		benchmark::DoNotOptimize(box);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AABB3_IncludeLoop)->Arg(1000)->Arg(1000000);
+
+static void BM_AABB3_FromPointsParallel(benchmark::State& state)
+{
+	const auto points = random_points<Vec3f>(1000000);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(AABB3f::from_points(points.data(), points.size(), 4));
+	}
+	state.SetItemsProcessed(state.iterations() * 1000000);
+}
+BENCHMARK(BM_AABB3_FromPointsParallel)->UseRealTime();
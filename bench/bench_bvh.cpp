@@ -0,0 +1,110 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/bvh.hpp>
+
+using namespace emath;
+
+namespace {
+
+const float WORLD_SIZE = 1000;
+
+/// A level: mostly short capsule walls, with some circles and boxes.
+struct Scene
+{
+	std::vector<Circle>       circles;
+	std::vector<CapsuleBaked> capsules;
+	std::vector<AABB2f>       aabbs;
+	std::vector<Ray>          rays;
+};
+
+Scene make_scene(size_t num_shapes)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> pos(0, WORLD_SIZE), offset(-10, 10), size(0.5f, 3);
+	Scene scene;
+	for (size_t i = 0; i < num_shapes; ++i) {
+		const Vec2f p(pos(rng), pos(rng));
+		if (i % 8 == 0) {
+			scene.circles.push_back(Circle{p, size(rng)});
+		} else if (i % 8 == 1) {
+			const Vec2f e(size(rng), size(rng));
+			scene.aabbs.push_back(AABB2f::from_min_max(p - e, p + e));
+		} else {
+			scene.capsules.push_back(CapsuleBaked(Capsule(p, p + Vec2f(offset(rng), offset(rng)), size(rng) * 0.3f)));
+		}
+	}
+	std::uniform_real_distribution<float> dir(-1, 1);
+	for (int i = 0; i < 1024; ++i) {
+		scene.rays.push_back(Ray{{pos(rng), pos(rng)}, normalized(Vec2f(dir(rng), dir(rng)))});
+	}
+	return scene;
+}
+
+/// What the BVH replaces.
+bool linear_closest_hit(const Scene& scene, trace::info& ti)
+{
+	bool hit = false;
+	for (const auto& c : scene.circles)  { hit |= trace::ray_circle(ti, c);  }
+	for (const auto& c : scene.capsules) { hit |= trace::ray_capsule(ti, c); }
+	for (const auto& b : scene.aabbs)    { hit |= trace::rayAABB(ti, b);     }
+	return hit;
+}
+
+const float MAX_T = 200;
+
+} // namespace
+
+static void BM_BVH_ClosestHit(benchmark::State& state)
+{
+	const Scene scene = make_scene(size_t(state.range(0)));
+	BVH2 bvh;
+	bvh.build(scene.circles, scene.capsules, scene.aabbs);
+	size_t i = 0;
+	for (auto _ : state) {
+		trace::info ti(scene.rays[i++ % scene.rays.size()], MAX_T);
+		benchmark::DoNotOptimize(bvh.closest_hit(ti));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BVH_ClosestHit)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_BVH_LinearScan(benchmark::State& state)
+{
+	const Scene scene = make_scene(size_t(state.range(0)));
+	size_t i = 0;
+	for (auto _ : state) {
+		trace::info ti(scene.rays[i++ % scene.rays.size()], MAX_T);
+		benchmark::DoNotOptimize(linear_closest_hit(scene, ti));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BVH_LinearScan)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_BVH_Build(benchmark::State& state)
+{
+	const Scene scene = make_scene(size_t(state.range(0)));
+	for (auto _ : state) {
+		BVH2 bvh;
+		bvh.build(scene.circles, scene.capsules, scene.aabbs);
+		benchmark::DoNotOptimize(bvh.num_nodes());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BVH_Build)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_BVH_Refit(benchmark::State& state)
+{
+	const Scene scene = make_scene(size_t(state.range(0)));
+	BVH2 bvh;
+	bvh.build(scene.circles, scene.capsules, scene.aabbs);
+	for (auto _ : state) {
+		for (Circle& c : bvh.circles()) { c.p.x += 0.01f; }
+		bvh.refit();
+		benchmark::DoNotOptimize(bvh.bounds());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BVH_Refit)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/frustum.hpp>
+#include <emath/mat4.hpp>
+#include <emath/vec3.hpp>
+
+using namespace emath;
+
+namespace {
+
+Frustum bench_frustum()
+{
+	return Frustum::from_matrix(
+		Mat4f::perspective(60, 1.5f, 0.5f, 300) * Mat4f::look_at({0, 2, 0}, {30, 0, 100}, {0, 1, 0}));
+}
+
+struct Boxes
+{
+	std::vector<Vec3f> centers, extents;
+};
+
+Boxes random_boxes(size_t n)
+{
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<float> pos(-400, 400), ext(0.5f, 5);
+	Boxes boxes;
+	boxes.centers.resize(n);
+	boxes.extents.resize(n);
+	for (size_t i = 0; i < n; ++i) {
+		boxes.centers[i] = {pos(rng), pos(rng) * 0.1f, pos(rng)};
+		boxes.extents[i] = {ext(rng), ext(rng), ext(rng)};
+	}
+	return boxes;
+}
+
+const size_t N = 4096;
+
+} // namespace
+
+static void BM_Frustum_CullBox(benchmark::State& state)
+{
+	const Frustum f = bench_frustum();
+	const Boxes boxes = random_boxes(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(f.cull_box(boxes.centers[i % N], boxes.extents[i % N]));
+		i += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Frustum_CullBox);
+
+static void BM_Frustum_TestSphere(benchmark::State& state)
+{
+	const Frustum f = bench_frustum();
+	const Boxes boxes = random_boxes(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(f.test_sphere(boxes.centers[i % N], boxes.extents[i % N].x));
+		i += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Frustum_TestSphere);
+
+static void BM_Frustum_FromMatrix(benchmark::State& state)
+{
+	const Mat4f mvp = Mat4f::perspective(60, 1.5f, 0.5f, 300) * Mat4f::look_at({0, 2, 0}, {30, 0, 100}, {0, 1, 0});
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Frustum::from_matrix(mvp));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Frustum_FromMatrix);
+
+// ----------------------------------------------------------------------------
+// cull_boxes vs calling cull_box in a loop.
+
+static void BM_Frustum_CullBoxLoop(benchmark::State& state)
+{
+	const Frustum f = bench_frustum();
+	const size_t n = size_t(state.range(0));
+	const Boxes boxes = random_boxes(n);
+	std::vector<uint8_t> visible((n + 7) / 8);
+	for (auto _ : state) {
+		std::fill(visible.begin(), visible.end(), 0);
+		for (size_t i = 0; i < n; ++i) {
+			if (!f.cull_box(boxes.centers[i], boxes.extents[i])) {
+				visible[i / 8] |= uint8_t(1u << (i % 8));
+			}
+		}
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+BENCHMARK(BM_Frustum_CullBoxLoop)->Arg(1000)->Arg(200000);
+
+static void BM_Frustum_CullBoxesAoS(benchmark::State& state)
+{
+	const Frustum f = bench_frustum();
+	const size_t n = size_t(state.range(0));
+	const Boxes boxes = random_boxes(n);
+	std::vector<uint8_t> visible((n + 7) / 8);
+	for (auto _ : state) {
+		f.cull_boxes(boxes.centers.data(), boxes.extents.data(), n, visible.data());
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+BENCHMARK(BM_Frustum_CullBoxesAoS)->Arg(1000)->Arg(200000);
+
+static void BM_Frustum_CullBoxesSoA(benchmark::State& state)
+{
+	const Frustum f = bench_frustum();
+	const size_t n = size_t(state.range(0));
+	const Boxes boxes = random_boxes(n);
+	std::vector<float> cx(n), cy(n), cz(n), ex(n), ey(n), ez(n);
+	for (size_t i = 0; i < n; ++i) {
+		cx[i] = boxes.centers[i].x; cy[i] = boxes.centers[i].y; cz[i] = boxes.centers[i].z;
+		ex[i] = boxes.extents[i].x; ey[i] = boxes.extents[i].y; ez[i] = boxes.extents[i].z;
+	}
+	std::vector<uint8_t> visible((n + 7) / 8);
+	for (auto _ : state) {
+		f.cull_boxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), n, visible.data());
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+BENCHMARK(BM_Frustum_CullBoxesSoA)->Arg(1000)->Arg(200000);
@@ -0,0 +1,87 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/mat4.hpp>
+#include <emath/vec3.hpp>
+#include <emath/vec4.hpp>
+
+using namespace emath;
+
+namespace {
+
+std::vector<Mat4f> random_matrices(size_t n)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-2, 2);
+	std::vector<Mat4f> mats(n);
+	for (Mat4f& m : mats) {
+		for (int i = 0; i < 16; ++i) { m.data()[i] = dist(rng); }
+	}
+	return mats;
+}
+
+const size_t N = 1024;
+
+} // namespace
+
+static void BM_Mat4_Multiply(benchmark::State& state)
+{
+	const auto mats = random_matrices(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(mats[i % N] * mats[(i + 1) % N]);
+		i += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat4_Multiply);
+
+static void BM_Mat4_Inverted(benchmark::State& state)
+{
+	const auto mats = random_matrices(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(inverted(mats[i++ % N]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat4_Inverted);
+
+static void BM_Mat4_Transposed(benchmark::State& state)
+{
+	const auto mats = random_matrices(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(transposed(mats[i++ % N]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat4_Transposed);
+
+static void BM_Mat4_MulVec4(benchmark::State& state)
+{
+	const auto mats = random_matrices(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(mul(mats[i++ % N], Vec4f(1, 2, 3, 1)));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat4_MulVec4);
+
+static void BM_Mat4d_Inverted(benchmark::State& state)
+{
+	const auto mats = random_matrices(N);
+	std::vector<Mat4d> matsd(N);
+	for (size_t k = 0; k < N; ++k) {
+		for (int e = 0; e < 16; ++e) { matsd[k].data()[e] = mats[k].data()[e]; }
+	}
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(inverted(matsd[i++ % N]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat4d_Inverted);
@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <emath/matrix.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<typename T>
+Matrix<T> numbered(int width, int height)
+{
+	Matrix<T> m(width, height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			m(x, y) = T(y * width + x);
+		}
+	}
+	return m;
+}
+
+/// The element-by-element transpose this replaced, for comparison.
+template<typename T>
+Matrix<T> naive_transpose(const Matrix<T>& m)
+{
+	Matrix<T> t(m.height(), m.width());
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) {
+			t(y, x) = m(x, y);
+		}
+	}
+	return t;
+}
+
+/// From fitting in L1 to way bigger than the caches, plus a couple of sizes that aren't multiples of the tiles.
+void transpose_sizes(benchmark::internal::Benchmark* b)
+{
+	for (int size : {64, 256, 1024, 4096, 8192}) {
+		b->Args({size, size});
+	}
+	b->Args({1000, 3000});
+	b->Args({4097, 1001});
+	b->Unit(benchmark::kMicrosecond);
+}
+
+template<typename T>
+void set_bytes(benchmark::State& state)
+{
+	state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(1) * int64_t(sizeof(T)));
+}
+
+} // namespace
+
+template<typename T>
+static void BM_Matrix_Transpose(benchmark::State& state)
+{
+	const Matrix<T> m = numbered<T>(int(state.range(0)), int(state.range(1)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(m.transpose().data());
+	}
+	set_bytes<T>(state);
+}
+BENCHMARK_TEMPLATE(BM_Matrix_Transpose, float)->Apply(transpose_sizes);
+BENCHMARK_TEMPLATE(BM_Matrix_Transpose, double)->Apply(transpose_sizes);
+BENCHMARK_TEMPLATE(BM_Matrix_Transpose, uint8_t)->Apply(transpose_sizes);
+
+template<typename T>
+static void BM_Matrix_TransposeNaive(benchmark::State& state)
+{
+	const Matrix<T> m = numbered<T>(int(state.range(0)), int(state.range(1)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(naive_transpose(m).data());
+	}
+	set_bytes<T>(state);
+}
+BENCHMARK_TEMPLATE(BM_Matrix_TransposeNaive, float)->Apply(transpose_sizes);
+
+static void BM_Matrix_TransposeParallel(benchmark::State& state)
+{
+	const int size = int(state.range(0));
+	const Matrixf m = numbered<float>(size, size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(m.transpose(unsigned(state.range(1))).data());
+	}
+	state.SetBytesProcessed(state.iterations() * int64_t(size) * size * int64_t(sizeof(float)));
+}
+BENCHMARK(BM_Matrix_TransposeParallel)
+	->ArgsProduct({{1024, 8192}, {2, 4, 8}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_Matrix_TransposeInPlace(benchmark::State& state)
+{
+	const int size = int(state.range(0));
+	Matrixf m = numbered<float>(size, size);
+	for (auto _ : state) {
+		m.transpose_in_place();
+		benchmark::DoNotOptimize(m.data());
+	}
+	state.SetBytesProcessed(state.iterations() * int64_t(size) * size * int64_t(sizeof(float)));
+}
+BENCHMARK(BM_Matrix_TransposeInPlace)->Arg(256)->Arg(1024)->Arg(4096)->Arg(8192)->Unit(benchmark::kMicrosecond);
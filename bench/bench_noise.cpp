@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+
+#include <emath/noise.hpp>
+
+using namespace emath;
+
+static void BM_Noise_2d(benchmark::State& state)
+{
+	float x = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(noise_2d(x, 0.37f * x));
+		x += 0.0137f;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Noise_2d);
+
+static void BM_Noise_3d(benchmark::State& state)
+{
+	float x = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(noise_3d(x, 0.37f * x, 0.71f * x));
+		x += 0.0137f;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Noise_3d);
+
+static void BM_Noise_4d(benchmark::State& state)
+{
+	float x = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(noise_4d(x, 0.37f * x, 0.71f * x, 0.13f * x));
+		x += 0.0137f;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Noise_4d);
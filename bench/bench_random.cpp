@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+
+#include <emath/random.hpp>
+
+using namespace emath;
+
+template<typename Engine>
+static void BM_Random_Float(benchmark::State& state)
+{
+	RandomT<Engine> random(42);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(random.random_float());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Random_Float, Pcg32);
+BENCHMARK_TEMPLATE(BM_Random_Float, Xoshiro128);
+
+static void BM_Random_Int(benchmark::State& state)
+{
+	Random random(42);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(random.random_int(1000));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_Int);
+
+static void BM_Random_Normal(benchmark::State& state)
+{
+	Random random(42);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(random.random_normal());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_Normal);
+
+static void BM_Random_Dir3d(benchmark::State& state)
+{
+	Random random(42);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(random.random_dir_3d());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_Dir3d);
+
+static void BM_Random_ThreadLocal(benchmark::State& state)
+{
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Random::thread_local_instance().random_float());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_ThreadLocal);
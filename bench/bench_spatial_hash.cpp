@@ -0,0 +1,152 @@
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/spatial_hash.hpp>
+
+using namespace emath;
+
+namespace {
+
+const float CELL_SIZE = 4;
+
+/// How std::hash<Vec2i> used to mix: a single multiply.
+struct OldVec2iHash
+{
+	size_t operator()(const Vec2i& v) const
+	{
+		return std::hash<int>()(v.x) + std::hash<int>()(v.y) * HUGE_PRIME_0;
+	}
+};
+
+/// The obvious alternative to SpatialHash<2>: a map from cell to entities.
+template<typename Hash>
+class UnorderedMapGrid
+{
+public:
+	using Entry = SpatialHash<2>::Entry;
+
+	void insert(uint32_t id, const Vec2f& pos) { _cells[cell_of(pos)].push_back(Entry{id, pos}); }
+
+	void query_radius(const Vec2f& center, float radius, std::vector<uint32_t>* out) const
+	{
+		const Vec2i lo = cell_of(center - Vec2f(radius, radius));
+		const Vec2i hi = cell_of(center + Vec2f(radius, radius));
+		for (int y = lo.y; y <= hi.y; ++y) {
+			for (int x = lo.x; x <= hi.x; ++x) {
+				const auto it = _cells.find(Vec2i(x, y));
+				if (it == _cells.end()) { continue; }
+				for (const Entry& e : it->second) {
+					if (distance_sq(e.pos, center) <= radius * radius) { out->push_back(e.id); }
+				}
+			}
+		}
+	}
+
+private:
+	static Vec2i cell_of(const Vec2f& pos)
+	{
+		return Vec2i(int(std::floor(pos.x / CELL_SIZE)), int(std::floor(pos.y / CELL_SIZE)));
+	}
+
+	std::unordered_map<Vec2i, std::vector<Entry>, Hash> _cells;
+};
+
+/// About one entity per cell.
+std::vector<Vec2f> random_positions(size_t n)
+{
+	std::mt19937 rng(20);
+	const float world_size = CELL_SIZE * std::sqrt(float(n));
+	std::uniform_real_distribution<float> pos(-world_size / 2, world_size / 2);
+	std::vector<Vec2f> positions(n);
+	for (Vec2f& p : positions) { p = Vec2f(pos(rng), pos(rng)); }
+	return positions;
+}
+
+void sizes(benchmark::internal::Benchmark* b)
+{
+	b->Arg(10000)->Arg(1000000);
+}
+
+template<typename Grid>
+Grid make_grid(const std::vector<Vec2f>& positions);
+
+template<>
+SpatialHash<2> make_grid(const std::vector<Vec2f>& positions)
+{
+	SpatialHash<2> grid(CELL_SIZE);
+	for (size_t i = 0; i < positions.size(); ++i) { grid.insert(uint32_t(i), positions[i]); }
+	return grid;
+}
+
+template<>
+UnorderedMapGrid<std::hash<Vec2i>> make_grid(const std::vector<Vec2f>& positions)
+{
+	UnorderedMapGrid<std::hash<Vec2i>> grid;
+	for (size_t i = 0; i < positions.size(); ++i) { grid.insert(uint32_t(i), positions[i]); }
+	return grid;
+}
+
+template<>
+UnorderedMapGrid<OldVec2iHash> make_grid(const std::vector<Vec2f>& positions)
+{
+	UnorderedMapGrid<OldVec2iHash> grid;
+	for (size_t i = 0; i < positions.size(); ++i) { grid.insert(uint32_t(i), positions[i]); }
+	return grid;
+}
+
+using StdMapGrid = UnorderedMapGrid<std::hash<Vec2i>>;
+using OldMapGrid = UnorderedMapGrid<OldVec2iHash>;
+
+} // namespace
+
+template<typename Grid>
+static void BM_SpatialHash_Insert(benchmark::State& state)
+{
+	const auto positions = random_positions(size_t(state.range(0)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(make_grid<Grid>(positions));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_SpatialHash_Insert, SpatialHash<2>)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SpatialHash_Insert, StdMapGrid)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SpatialHash_Insert, OldMapGrid)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+
+template<typename Grid>
+static void BM_SpatialHash_QueryRadius(benchmark::State& state)
+{
+	const auto positions = random_positions(size_t(state.range(0)));
+	const Grid grid = make_grid<Grid>(positions);
+	std::vector<uint32_t> found;
+	size_t i = 0;
+	for (auto _ : state) {
+		found.clear();
+		grid.query_radius(positions[i++ % positions.size()], CELL_SIZE, &found);
+		benchmark::DoNotOptimize(found.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_SpatialHash_QueryRadius, SpatialHash<2>)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_SpatialHash_QueryRadius, StdMapGrid)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_SpatialHash_QueryRadius, OldMapGrid)->Apply(sizes);
+
+static void BM_SpatialHash_Move(benchmark::State& state)
+{
+	auto positions = random_positions(size_t(state.range(0)));
+	SpatialHash<2> grid = make_grid<SpatialHash<2>>(positions);
+	std::mt19937 rng(21);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	size_t i = 0;
+	for (auto _ : state) {
+		const size_t id = i++ % positions.size();
+		const Vec2f new_pos = positions[id] + Vec2f(step(rng), step(rng));
+		grid.move(uint32_t(id), positions[id], new_pos);
+		positions[id] = new_pos;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpatialHash_Move)->Apply(sizes);
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/sweep_and_prune.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// n boxes at the same density whatever n is, so every box overlaps a few others.
+struct Boxes
+{
+	std::vector<Vec2f>  positions, velocities;
+	std::vector<AABB2f> boxes;
+
+	explicit Boxes(size_t n)
+	{
+		std::mt19937 rng(19);
+		const float world_size = 10 * std::sqrt(float(n));
+		std::uniform_real_distribution<float> pos(0, world_size), vel(-0.1f, 0.1f);
+		for (size_t i = 0; i < n; ++i) {
+			positions.emplace_back(pos(rng), pos(rng));
+			velocities.emplace_back(vel(rng), vel(rng));
+		}
+		boxes.resize(n);
+		update_boxes();
+	}
+
+	void step()
+	{
+		for (size_t i = 0; i < positions.size(); ++i) { positions[i] += velocities[i]; }
+		update_boxes();
+	}
+
+	void update_boxes()
+	{
+		for (size_t i = 0; i < positions.size(); ++i) {
+			boxes[i] = AABB2f::from_min_max(positions[i] - Vec2f(2, 2), positions[i] + Vec2f(2, 2));
+		}
+	}
+};
+
+void sap_sizes(benchmark::internal::Benchmark* b)
+{
+	b->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+/// One frame: move every box a little, then find the pairs.
+static void BM_SAP_Frame(benchmark::State& state)
+{
+	Boxes boxes(size_t(state.range(0)));
+	SweepAndPrune sap;
+	std::vector<SweepAndPrune::Handle> handles;
+	for (const AABB2f& box : boxes.boxes) { handles.push_back(sap.add(box)); }
+	std::vector<SweepAndPrune::Pair> pairs;
+	sap.find_pairs(&pairs);
+
+	for (auto _ : state) {
+		boxes.step();
+		for (size_t i = 0; i < handles.size(); ++i) { sap.update(handles[i], boxes.boxes[i]); }
+		sap.find_pairs(&pairs);
+		benchmark::DoNotOptimize(pairs.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["pairs"] = double(pairs.size());
+}
+BENCHMARK(BM_SAP_Frame)->Apply(sap_sizes);
+
+/// Adding everything and sorting from scratch, as on the first frame.
+static void BM_SAP_FromScratch(benchmark::State& state)
+{
+	const Boxes boxes(size_t(state.range(0)));
+	std::vector<SweepAndPrune::Pair> pairs;
+	for (auto _ : state) {
+		SweepAndPrune sap;
+		for (const AABB2f& box : boxes.boxes) { sap.add(box); }
+		sap.find_pairs(&pairs);
+		benchmark::DoNotOptimize(pairs.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SAP_FromScratch)->Apply(sap_sizes);
+
+/// Testing every pair with AABB2f::intersects. Too slow for 100k.
+static void BM_SAP_BruteForce(benchmark::State& state)
+{
+	Boxes boxes(size_t(state.range(0)));
+	std::vector<SweepAndPrune::Pair> pairs;
+	for (auto _ : state) {
+		boxes.step();
+		pairs.clear();
+		const auto& b = boxes.boxes;
+		for (size_t i = 0; i < b.size(); ++i) {
+			for (size_t j = i + 1; j < b.size(); ++j) {
+				if (AABB2f::intersects(b[i], b[j])) { pairs.push_back({uint32_t(i), uint32_t(j)}); }
+			}
+		}
+		benchmark::DoNotOptimize(pairs.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SAP_BruteForce)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,135 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/matrix.hpp>
+#include <emath/morton.hpp>
+#include <emath/tiled_matrix.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<typename Grid>
+Grid make_grid(int size);
+
+template<>
+Matrixf make_grid(int size)
+{
+	Matrixf m(size, size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) { m(x, y) = float(x ^ y); }
+	}
+	return m;
+}
+
+template<typename Grid>
+Grid make_grid(int size)
+{
+	return Grid(make_grid<Matrixf>(size).view());
+}
+
+/// 3x3 box filter around (x, y), which must not be on the edge.
+template<typename Grid>
+inline float box_3x3(const Grid& g, int x, int y)
+{
+	return g(x - 1, y - 1) + g(x, y - 1) + g(x + 1, y - 1)
+	     + g(x - 1, y    ) + g(x, y    ) + g(x + 1, y    )
+	     + g(x - 1, y + 1) + g(x, y + 1) + g(x + 1, y + 1);
+}
+
+void sizes(benchmark::internal::Benchmark* b)
+{
+	b->Arg(512)->Arg(4096)->Unit(benchmark::kMicrosecond);
+}
+
+using Tiled4x4   = TiledMatrix<float, 2>;
+using Tiled8x8   = TiledMatrix<float, 3>;
+using Tiled16x16 = TiledMatrix<float, 4>;
+
+} // namespace
+
+/// The whole grid through a 3x3 stencil, row by row. Favors the row-major Matrix.
+template<typename Grid>
+static void BM_Stencil_RowMajor(benchmark::State& state)
+{
+	const int size = int(state.range(0));
+	const Grid g = make_grid<Grid>(size);
+	for (auto _ : state) {
+		float total = 0;
+		for (int y = 1; y + 1 < size; ++y) {
+			for (int x = 1; x + 1 < size; ++x) { total += box_3x3(g, x, y); }
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(size - 2) * (size - 2));
+}
+BENCHMARK_TEMPLATE(BM_Stencil_RowMajor, Matrixf)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Stencil_RowMajor, Tiled4x4)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Stencil_RowMajor, Tiled8x8)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Stencil_RowMajor, Tiled16x16)->Apply(sizes);
+
+/// The same, but column by column.
+template<typename Grid>
+static void BM_Stencil_ColumnMajor(benchmark::State& state)
+{
+	const int size = int(state.range(0));
+	const Grid g = make_grid<Grid>(size);
+	for (auto _ : state) {
+		float total = 0;
+		for (int x = 1; x + 1 < size; ++x) {
+			for (int y = 1; y + 1 < size; ++y) { total += box_3x3(g, x, y); }
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(size - 2) * (size - 2));
+}
+BENCHMARK_TEMPLATE(BM_Stencil_ColumnMajor, Matrixf)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Stencil_ColumnMajor, Tiled8x8)->Apply(sizes);
+
+/// 3x3 neighborhoods around random points, as when sampling a height field.
+template<typename Grid>
+static void BM_Stencil_Random(benchmark::State& state)
+{
+	const int size = int(state.range(0));
+	const Grid g = make_grid<Grid>(size);
+	std::mt19937 rng(21);
+	std::uniform_int_distribution<int> coord(1, size - 2);
+	std::vector<Vec2i> points(1 << 16);
+	for (Vec2i& p : points) { p = Vec2i(coord(rng), coord(rng)); }
+	size_t i = 0;
+	for (auto _ : state) {
+		const Vec2i& p = points[i++ % points.size()];
+		benchmark::DoNotOptimize(box_3x3(g, p.x, p.y));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Stencil_Random, Matrixf)->Arg(512)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Stencil_Random, Tiled4x4)->Arg(512)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Stencil_Random, Tiled8x8)->Arg(512)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Stencil_Random, Tiled16x16)->Arg(512)->Arg(4096);
+
+// ----------------------------------------------------------------------------
+
+static void BM_Morton_Encode2(benchmark::State& state)
+{
+	uint32_t x = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(morton_encode(x, x * 7));
+		x += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Morton_Encode2);
+
+static void BM_Morton_Encode3(benchmark::State& state)
+{
+	uint32_t x = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(morton_encode(x, x * 7, x * 13));
+		x += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Morton_Encode3);
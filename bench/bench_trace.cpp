@@ -0,0 +1,101 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <emath/capsule.hpp>
+#include <emath/circle.hpp>
+#include <emath/trace.hpp>
+
+using namespace emath;
+using namespace emath::trace;
+
+namespace {
+
+std::vector<Ray> random_rays(size_t n)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<float> dist(-10, 10);
+	std::vector<Ray> rays(n);
+	for (Ray& r : rays) {
+		r.o = {dist(rng), dist(rng)};
+		r.d = {dist(rng), dist(rng)};
+	}
+	return rays;
+}
+
+const size_t N = 1024;
+
+const Circle       CIRCLE{{1, 2}, 3};
+const CapsuleBaked CAPSULE(Capsule({-3, 1}, {4, -2}, 1.5f));
+const AABB2f       BOX = AABB2f::from_min_max({-2, -1}, {3, 4});
+
+template<typename Fun>
+void bench_scalar(benchmark::State& state, const Fun& fun)
+{
+	const auto rays = random_rays(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		info ti(rays[i++ % N], 2.0f);
+		benchmark::DoNotOptimize(fun(ti));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Fun>
+void bench_packet(benchmark::State& state, const Fun& fun)
+{
+	const auto rays = random_rays(N);
+	size_t i = 0;
+	for (auto _ : state) {
+		info_packet tp(&rays[i % N], info_packet::SIZE, 2.0f);
+		benchmark::DoNotOptimize(fun(tp));
+		i += info_packet::SIZE;
+	}
+	state.SetItemsProcessed(state.iterations() * info_packet::SIZE);
+}
+
+} // namespace
+
+static void BM_Trace_RayCircle(benchmark::State& state)
+{
+	bench_scalar(state, [](info& ti) { return ray_circle(ti, CIRCLE); });
+}
+BENCHMARK(BM_Trace_RayCircle);
+
+static void BM_Trace_RayCapsule(benchmark::State& state)
+{
+	bench_scalar(state, [](info& ti) { return ray_capsule(ti, CAPSULE); });
+}
+BENCHMARK(BM_Trace_RayCapsule);
+
+static void BM_Trace_RayAABB(benchmark::State& state)
+{
+	bench_scalar(state, [](info& ti) { return rayAABB(ti, BOX); });
+}
+BENCHMARK(BM_Trace_RayAABB);
+
+static void BM_Trace_RayCircleCCD(benchmark::State& state)
+{
+	const Circle c_1{{2, 1}, 4};
+	bench_scalar(state, [&](info& ti) { return ray_circle_ccd(ti, CIRCLE, c_1); });
+}
+BENCHMARK(BM_Trace_RayCircleCCD);
+
+static void BM_Trace_PacketCircle(benchmark::State& state)
+{
+	bench_packet(state, [](info_packet& tp) { return ray_circle(tp, CIRCLE); });
+}
+BENCHMARK(BM_Trace_PacketCircle);
+
+static void BM_Trace_PacketCapsule(benchmark::State& state)
+{
+	bench_packet(state, [](info_packet& tp) { return ray_capsule(tp, CAPSULE); });
+}
+BENCHMARK(BM_Trace_PacketCapsule);
+
+static void BM_Trace_PacketAABB(benchmark::State& state)
+{
+	bench_packet(state, [](info_packet& tp) { return rayAABB(tp, BOX); });
+}
+BENCHMARK(BM_Trace_PacketAABB);
@@ -4,6 +4,7 @@
 #include <initializer_list>
 #include <vector>
 
+#include "bounds.hpp"
 #include "mat3.hpp"
 #include "vec2.hpp"
 
@@ -25,6 +26,13 @@ public:
 
 	static const AABB_T from_points(std::initializer_list<V> list);
 	static const AABB_T from_points(const std::vector<V>& list);
+
+	/// Vectorized for float (see bounds.hpp). With num_threads > 1 the points are split into that many chunks.
+	static const AABB_T from_points(const V* points, size_t n, unsigned num_threads = 1);
+
+	/// For positions in interleaved vertex buffers: 'first' points to the first position,
+	/// and the positions are 'stride' bytes apart.
+	static const AABB_T from_points_strided(const void* first, size_t stride, size_t n, unsigned num_threads = 1);
 	static const AABB_T from_min_max(const V& min, const V& max);
 	static const AABB_T from_min_size(const V& min, const V& size);
 	static const AABB_T from_center_size(const V& center, const V& size);
@@ -163,20 +171,27 @@ using AABB2i = AABB_T<int>;
 template<typename T>
 inline const AABB_T<T> AABB_T<T>::from_points(std::initializer_list<V> list)
 {
-	AABB_T ret = AABB_T::nothing();
-	for (auto& v : list) {
-		ret.include(v);
-	}
-	return ret;
+	return from_points(list.begin(), list.size());
 }
 
 template<typename T>
 inline const AABB_T<T> AABB_T<T>::from_points(const std::vector<V>& list)
 {
-	AABB_T ret = AABB_T::nothing();
-	for (auto& v : list) {
-		ret.include(v);
-	}
+	return from_points(list.data(), list.size());
+}
+
+template<typename T>
+inline const AABB_T<T> AABB_T<T>::from_points(const V* points, size_t n, unsigned num_threads)
+{
+	return from_points_strided(points, sizeof(V), n, num_threads);
+}
+
+template<typename T>
+inline const AABB_T<T> AABB_T<T>::from_points_strided(const void* first, size_t stride, size_t n, unsigned num_threads)
+{
+	if (n == 0) { return nothing(); }
+	AABB_T ret;
+	point_bounds<T, DIM>(first, stride, n, num_threads, &ret._min[0], &ret._max[0]);
 	return ret;
 }
 
@@ -0,0 +1,155 @@
+#include "aabb3.hpp"
+
+#include <algorithm>
+
+#include "simd.hpp"
+
+namespace emath {
+
+namespace {
+
+#if EMATH_SIMD_WIDTH > 1
+/// One axis of the slab test for WIDTH boxes. Same operations in the same order as AABB3_T::intersects_ray.
+inline void slab(simd::floatv& t_min, simd::floatv& t_max, simd::floatv lo, simd::floatv hi,
+                 simd::floatv origin, simd::floatv inv_dir)
+{
+	using namespace simd;
+	const floatv a = mul(sub(lo, origin), inv_dir);
+	const floatv b = mul(sub(hi, origin), inv_dir);
+	t_min = min(max(a, t_min), max(b, t_min));
+	t_max = max(min(a, t_max), min(b, t_max));
+}
+#endif
+
+/// The block size is a multiple of 8 so each block fills whole bytes of a bitmask.
+/// Not a static member: std::min takes it by reference, which needs a definition in C++14.
+constexpr size_t BOX_BLOCK = 64;
+
+/// Boxes transposed into SoA blocks, see the AoS versions below.
+struct BoxBlock
+{
+	float min_x[BOX_BLOCK], min_y[BOX_BLOCK], min_z[BOX_BLOCK];
+	float max_x[BOX_BLOCK], max_y[BOX_BLOCK], max_z[BOX_BLOCK];
+
+	void load(const AABB3f* boxes, size_t count)
+	{
+		for (size_t j = 0; j < count; ++j) {
+			min_x[j] = boxes[j].min().x;
+			min_y[j] = boxes[j].min().y;
+			min_z[j] = boxes[j].min().z;
+			max_x[j] = boxes[j].max().x;
+			max_y[j] = boxes[j].max().y;
+			max_z[j] = boxes[j].max().z;
+		}
+	}
+};
+
+/// Updates best/best_t with any box in [0, n) that is hit closer than best_t.
+/// 'offset' is added to the index of what is found.
+void closest_box(const SlabRay3f& ray, float t_min, const BoxBlock& block, size_t n, size_t offset,
+                 long& best, float& best_t)
+{
+	size_t i = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+	const floatv o_x = set1(ray.origin.x),  o_y = set1(ray.origin.y),  o_z = set1(ray.origin.z);
+	const floatv i_x = set1(ray.inv_dir.x), i_y = set1(ray.inv_dir.y), i_z = set1(ray.inv_dir.z);
+	const floatv t_min_v = set1(t_min);
+
+	for (; i + WIDTH <= n; i += WIDTH) {
+		// Shrinking t_max to the best so far means we only hear about improvements (or ties).
+		floatv t0 = t_min_v, t1 = set1(best_t);
+		slab(t0, t1, load(block.min_x + i), load(block.max_x + i), o_x, i_x);
+		slab(t0, t1, load(block.min_y + i), load(block.max_y + i), o_y, i_y);
+		slab(t0, t1, load(block.min_z + i), load(block.max_z + i), o_z, i_z);
+		const int hits = movemask(cmp_le(t0, t1));
+		if (hits == 0) { continue; }
+
+		alignas(32) float lanes[WIDTH];
+		store(lanes, t0);
+		for (int lane = 0; lane < WIDTH; ++lane) {
+			if ((hits & (1 << lane)) && (best < 0 || lanes[lane] < best_t)) {
+				best   = long(offset + i + lane);
+				best_t = lanes[lane];
+			}
+		}
+	}
+#endif
+
+	for (; i < n; ++i) {
+		const AABB3f box = AABB3f::from_min_max({block.min_x[i], block.min_y[i], block.min_z[i]},
+		                                        {block.max_x[i], block.max_y[i], block.max_z[i]});
+		float t;
+		if (box.intersects_ray(ray, t_min, best_t, &t) && (best < 0 || t < best_t)) {
+			best   = long(offset + i);
+			best_t = t;
+		}
+	}
+}
+
+} // namespace
+
+void ray_boxes(const SlabRay3f& ray, float t_min, float t_max,
+               const float* min_x, const float* min_y, const float* min_z,
+               const float* max_x, const float* max_y, const float* max_z,
+               size_t n, uint8_t* out_hits, float* out_t)
+{
+	std::fill(out_hits, out_hits + (n + 7) / 8, uint8_t(0));
+
+	size_t i = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+	const floatv o_x = set1(ray.origin.x),  o_y = set1(ray.origin.y),  o_z = set1(ray.origin.z);
+	const floatv i_x = set1(ray.inv_dir.x), i_y = set1(ray.inv_dir.y), i_z = set1(ray.inv_dir.z);
+	const floatv t_min_v = set1(t_min), t_max_v = set1(t_max);
+
+	for (; i + WIDTH <= n; i += WIDTH) {
+		floatv t0 = t_min_v, t1 = t_max_v;
+		slab(t0, t1, load(min_x + i), load(max_x + i), o_x, i_x);
+		slab(t0, t1, load(min_y + i), load(max_y + i), o_y, i_y);
+		slab(t0, t1, load(min_z + i), load(max_z + i), o_z, i_z);
+		out_hits[i / 8] |= uint8_t(movemask(cmp_le(t0, t1)) << (i % 8));
+		if (out_t) { store(out_t + i, t0); }
+	}
+#endif
+
+	for (; i < n; ++i) {
+		const AABB3f box = AABB3f::from_min_max({min_x[i], min_y[i], min_z[i]}, {max_x[i], max_y[i], max_z[i]});
+		float t;
+		if (box.intersects_ray(ray, t_min, t_max, &t)) {
+			out_hits[i / 8] |= uint8_t(1 << (i % 8));
+		}
+		if (out_t) { out_t[i] = t; }
+	}
+}
+
+void ray_boxes(const SlabRay3f& ray, float t_min, float t_max,
+               const AABB3f* boxes, size_t n, uint8_t* out_hits, float* out_t)
+{
+	BoxBlock block;
+	for (size_t start = 0; start < n; start += BOX_BLOCK) {
+		const size_t count = std::min(BOX_BLOCK, n - start);
+		block.load(boxes + start, count);
+		ray_boxes(ray, t_min, t_max, block.min_x, block.min_y, block.min_z, block.max_x, block.max_y, block.max_z,
+		          count, out_hits + start / 8, out_t ? out_t + start : nullptr);
+	}
+}
+
+long ray_closest_box(const SlabRay3f& ray, float t_min, float t_max,
+                     const AABB3f* boxes, size_t n, float* out_t)
+{
+	long  best   = -1;
+	float best_t = t_max;
+	BoxBlock block;
+	for (size_t start = 0; start < n; start += BOX_BLOCK) {
+		const size_t count = std::min(BOX_BLOCK, n - start);
+		block.load(boxes + start, count);
+		closest_box(ray, t_min, block, count, start, best, best_t);
+	}
+	if (best >= 0 && out_t) { *out_t = best_t; }
+	return best;
+}
+
+} // namespace emath
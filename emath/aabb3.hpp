@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "bounds.hpp"
+#include "mat4.hpp"
+#include "vec3.hpp"
+
+namespace emath {
+
+/// A ray prepared for slab tests: the inverse direction is computed once, up front.
+/// Components of 'dir' may be zero (the inverse is then +-inf).
+template<typename T>
+struct SlabRay3_T
+{
+	Vec3T<T> origin;
+	Vec3T<T> inv_dir;
+
+	SlabRay3_T() = default;
+	SlabRay3_T(const Vec3T<T>& origin, const Vec3T<T>& dir)
+		: origin(origin), inv_dir(T(1) / dir.x, T(1) / dir.y, T(1) / dir.z) {}
+};
+
+using SlabRay3f = SlabRay3_T<float>;
+using SlabRay3d = SlabRay3_T<double>;
+
+/// 3D version of AABB_T, with the same interface.
+template<typename T>
+class AABB3_T
+{
+public:
+	using V = Vec3T<T>;
+	using element_type = T;
+	static constexpr int DIM = 3;
+
+	// Default ctor: NO INIT!
+	AABB3_T() { }
+
+	// ------------------------------------------------
+	// Static ctors:
+
+	static const AABB3_T from_points(std::initializer_list<V> list);
+	static const AABB3_T from_points(const std::vector<V>& list);
+
+	/// Vectorized for float (see bounds.hpp). With num_threads > 1 the points are split into that many chunks.
+	static const AABB3_T from_points(const V* points, size_t n, unsigned num_threads = 1);
+
+	/// For positions in interleaved vertex buffers: 'first' points to the first position,
+	/// and the positions are 'stride' bytes apart.
+	static const AABB3_T from_points_strided(const void* first, size_t stride, size_t n, unsigned num_threads = 1);
+	static const AABB3_T from_min_max(const V& min, const V& max);
+	static const AABB3_T from_min_size(const V& min, const V& size);
+	static const AABB3_T from_center_size(const V& center, const V& size);
+
+	static const AABB3_T everything();
+	static const AABB3_T nothing();
+
+	// ------------------------------------------------
+
+	const V& min()    const { return _min; }
+	const V& max()    const { return _max; }
+	const V  center() const { return (_min + _max) / T(2); }
+	const V  size()   const { return _max-_min; }
+	element_type volume() const { return width() * height() * depth(); }
+	element_type width()  const { return size().x; }
+	element_type height() const { return size().y; }
+	element_type depth()  const { return size().z; }
+
+	/// Corner i has x from max() if bit 0 of i is set, y if bit 1 is, z if bit 2 is.
+	const V corner(int i) const
+	{
+		return V((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+	}
+
+	// ------------------------------------------------
+	// Tests
+
+	V clamp(const V& v) const
+	{
+		return V(emath::clamp(v.x, _min.x, _max.x), emath::clamp(v.y, _min.y, _max.y), emath::clamp(v.z, _min.z, _max.z));
+	}
+
+	bool contains(const V& v) const
+	{
+		for (int d=0; d<DIM; ++d) {
+			if (v[d] < _min[d] || _max[d] < v[d]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool contains(const AABB3_T& b) const
+	{
+		return min().x <= b.min().x && b.max().x <= max().x
+		    && min().y <= b.min().y && b.max().y <= max().y
+		    && min().z <= b.min().z && b.max().z <= max().z;
+	}
+
+	// <= 0 if inside.
+	T distance_to(const V& v) const
+	{
+		if (contains(v)) {
+			// Distance to the closest face:
+			T closest = INF<T>;
+			for (int i=0; i<DIM; ++i) {
+				closest = std::min(closest, std::min(v[i] - _min[i], _max[i] - v[i]));
+			}
+			return -closest;
+		} else {
+			return distance(v, clamp(v));
+		}
+	}
+
+	/// Slab test: does origin + t * dir hit the box for some t in [t_min, t_max]?
+	/// On a hit, *out_t is set to where the ray enters the box (t_min if it starts inside).
+	/// Branchless. The box is closed: a ray parallel to a face and exactly in its plane counts as a hit.
+	bool intersects_ray(const SlabRay3_T<T>& ray, T t_min, T t_max, T* out_t = nullptr) const
+	{
+		// a or b is NaN (0 * inf) when the ray lies in a face plane. (x < y ? x : y) returns y if either is NaN,
+		// so with the running t_min/t_max as the second operand a NaN never replaces them, whichever face it is.
+		// This is also the argument order of simd::min/max, so the batch versions (ray_boxes etc)
+		// give the exact same answers.
+		for (int d=0; d<DIM; ++d) {
+			const T a = (_min[d] - ray.origin[d]) * ray.inv_dir[d];
+			const T b = (_max[d] - ray.origin[d]) * ray.inv_dir[d];
+			const T a_min = (a > t_min ? a : t_min), b_min = (b > t_min ? b : t_min);
+			const T a_max = (a < t_max ? a : t_max), b_max = (b < t_max ? b : t_max);
+			t_min = (a_min < b_min ? a_min : b_min);
+			t_max = (a_max > b_max ? a_max : b_max);
+		}
+		if (out_t) { *out_t = t_min; }
+		return t_min <= t_max;
+	}
+
+	// ------------------------------------------------
+	// Utils
+
+	AABB3_T enlarged_by_rad(T rad) const
+	{
+		V rv(rad);
+		return from_min_max(min()-rv, max()+rv);
+	}
+
+	static bool intersects(const AABB3_T& a, const AABB3_T& b)
+	{
+		for (int d=0; d<DIM; ++d) {
+			if (a._max[d] <= b._min[d] || b._max[d] <= a._min[d]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void include(const V& v)
+	{
+		for (int i=0; i<DIM; ++i) {
+			_min[i] = emath::min(_min[i], v[i]);
+			_max[i] = emath::max(_max[i], v[i]);
+		}
+	}
+
+	void include(const AABB3_T& b)
+	{
+		for (int i=0; i<DIM; ++i) {
+			_min[i] = emath::min(_min[i], b._min[i]);
+			_max[i] = emath::max(_max[i], b._max[i]);
+		}
+	}
+
+	// ------------------------------------------------
+	friend AABB3_T operator*(T s, const AABB3_T& v)
+	{
+		return AABB3_T(s*v._min, s*v._max);
+	}
+
+	friend AABB3_T operator*(const AABB3_T& v, T s)
+	{
+		return AABB3_T(v._min*s, v._max*s);
+	}
+
+private:
+	AABB3_T(const V& min, const V& max) : _min(min), _max(max) { }
+
+	V _min, _max;
+};
+
+// ------------------------------------------------
+using AABB3f = AABB3_T<float>;
+using AABB3d = AABB3_T<double>;
+using AABB3i = AABB3_T<int>;
+
+// ------------------------------------------------
+// Implementations
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_points(std::initializer_list<V> list)
+{
+	return from_points(list.begin(), list.size());
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_points(const std::vector<V>& list)
+{
+	return from_points(list.data(), list.size());
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_points(const V* points, size_t n, unsigned num_threads)
+{
+	return from_points_strided(points, sizeof(V), n, num_threads);
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_points_strided(const void* first, size_t stride, size_t n, unsigned num_threads)
+{
+	if (n == 0) { return nothing(); }
+	AABB3_T ret;
+	point_bounds<T, DIM>(first, stride, n, num_threads, &ret._min[0], &ret._max[0]);
+	return ret;
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_min_max(const V& min, const V& max)
+{
+	return AABB3_T(min, max);
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_min_size(const V& min, const V& size)
+{
+	return AABB3_T(min, min+size);
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::from_center_size(const V& center, const V& size)
+{
+	V hs = size / T(2);
+	return AABB3_T(center-hs, center+hs);
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::everything()
+{
+	return from_min_max(V(-INF<T>), V(+INF<T>));
+}
+
+template<typename T>
+inline const AABB3_T<T> AABB3_T<T>::nothing()
+{
+	return from_min_max(V(+INF<T>), V(-INF<T>));
+}
+
+// ------------------------------------------------
+
+inline AABB3f lerp(const AABB3f& a, const AABB3f& b, float t)
+{
+	return AABB3f::from_center_size(
+		lerp(a.center(), b.center(), t),
+		lerp(a.size(),   b.size(),   t)
+	);
+}
+
+/// The bounds of the transformed box.
+template<typename T>
+inline AABB3_T<T> transform(const Mat4T<T>& out_from_in, const AABB3_T<T>& aabb)
+{
+	AABB3_T<T> ret = AABB3_T<T>::nothing();
+	for (int i = 0; i < 8; ++i) {
+		ret.include(mul_pos(out_from_in, aabb.corner(i)));
+	}
+	return ret;
+}
+
+// ------------------------------------------------
+// One ray against many boxes, vectorized over the boxes.
+// All give the same answers as calling AABB3f::intersects_ray on each box.
+// The SoA version is the fastest by far; the AoS ones transpose into small SoA blocks first.
+
+/// Bit (i % 8) of out_hits[i / 8] is set if box i is hit for some t in [t_min, t_max].
+/// out_hits must hold (n + 7) / 8 bytes. If given, out_t[i] is the entry t of box i (only meaningful for hits).
+void ray_boxes(const SlabRay3f& ray, float t_min, float t_max,
+               const float* min_x, const float* min_y, const float* min_z,
+               const float* max_x, const float* max_y, const float* max_z,
+               size_t n, uint8_t* out_hits, float* out_t = nullptr);
+
+/// Same as above, for an array of boxes (AoS).
+void ray_boxes(const SlabRay3f& ray, float t_min, float t_max,
+               const AABB3f* boxes, size_t n, uint8_t* out_hits, float* out_t = nullptr);
+
+/// The index of the box with the smallest entry t in [t_min, t_max], or -1 if none is hit.
+/// Ties go to the lowest index.
+long ray_closest_box(const SlabRay3f& ray, float t_min, float t_max,
+                     const AABB3f* boxes, size_t n, float* out_t = nullptr);
+
+} // namespace emath
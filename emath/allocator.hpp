@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+namespace emath {
+
+/*
+ A standard allocator that aligns every allocation to (at least) Alignment bytes.
+ The default of 64 is a cache line, and enough for any SIMD load.
+ Stateless, so all instances compare equal.
+ */
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+	static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+	using value_type = T;
+	static constexpr size_t alignment = (Alignment > alignof(T) ? Alignment : alignof(T));
+
+	template<typename U>
+	struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+	AlignedAllocator() noexcept = default;
+
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		if (n > (std::numeric_limits<size_t>::max() - alignment - sizeof(void*)) / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+
+		// Over-allocate, and remember what malloc gave us just before the aligned pointer:
+		void* raw = std::malloc(n * sizeof(T) + alignment + sizeof(void*));
+		if (!raw) {
+			throw std::bad_alloc();
+		}
+		const uintptr_t start   = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+		const uintptr_t aligned = (start + alignment - 1) & ~uintptr_t(alignment - 1);
+		reinterpret_cast<void**>(aligned)[-1] = raw;
+		return reinterpret_cast<T*>(aligned);
+	}
+
+	void deallocate(T* p, size_t) noexcept
+	{
+		if (p) {
+			std::free(reinterpret_cast<void**>(p)[-1]);
+		}
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+	template<typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+} // namespace emath
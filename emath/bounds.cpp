@@ -0,0 +1,77 @@
+#include "bounds.hpp"
+
+#include "simd.hpp"
+
+namespace emath {
+
+namespace {
+
+/// Packed points: the floats are one flat array where float i is component i % DIM.
+/// Each accumulator register always sees the same components in the same lanes,
+/// so we can min/max whole registers and sort out the components at the end.
+template<int DIM>
+void packed_point_bounds(const float* flat, size_t n, float* out_min, float* out_max)
+{
+	const size_t num_floats = n * DIM;
+	size_t i = 0;
+
+	for (int d = 0; d < DIM; ++d) {
+		out_min[d] = out_max[d] = flat[d];
+	}
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+	// 2 * DIM registers per step: a multiple of DIM floats, and enough independent min/max chains.
+	constexpr int    NUM_ACC = 2 * DIM;
+	constexpr size_t STEP    = NUM_ACC * WIDTH;
+
+	if (num_floats >= STEP) {
+		floatv acc_min[NUM_ACC], acc_max[NUM_ACC];
+		for (int r = 0; r < NUM_ACC; ++r) {
+			acc_min[r] = acc_max[r] = load(flat + r * WIDTH);
+		}
+		for (i = STEP; i + STEP <= num_floats; i += STEP) {
+			for (int r = 0; r < NUM_ACC; ++r) {
+				const floatv v = load(flat + i + r * WIDTH);
+				acc_min[r] = min(acc_min[r], v);
+				acc_max[r] = max(acc_max[r], v);
+			}
+		}
+
+		alignas(32) float lanes_min[WIDTH], lanes_max[WIDTH];
+		for (int r = 0; r < NUM_ACC; ++r) {
+			store(lanes_min, acc_min[r]);
+			store(lanes_max, acc_max[r]);
+			for (int l = 0; l < WIDTH; ++l) {
+				const int d = (r * WIDTH + l) % DIM;
+				out_min[d] = std::min(out_min[d], lanes_min[l]);
+				out_max[d] = std::max(out_max[d], lanes_max[l]);
+			}
+		}
+	}
+#endif
+
+	for (; i < num_floats; i += DIM) {
+		for (int d = 0; d < DIM; ++d) {
+			out_min[d] = std::min(out_min[d], flat[i + d]);
+			out_max[d] = std::max(out_max[d], flat[i + d]);
+		}
+	}
+}
+
+} // namespace
+
+void float_point_bounds(const void* first, size_t stride, size_t n, int dim, float* out_min, float* out_max)
+{
+	DCHECK_F(dim == 2 || dim == 3);
+	const bool packed = (stride == dim * sizeof(float));
+	if (dim == 2) {
+		if (packed) { packed_point_bounds<2>(static_cast<const float*>(first), n, out_min, out_max); }
+		else        { scalar_point_bounds<float, 2>(first, stride, n, out_min, out_max); }
+	} else {
+		if (packed) { packed_point_bounds<3>(static_cast<const float*>(first), n, out_min, out_max); }
+		else        { scalar_point_bounds<float, 3>(first, stride, n, out_min, out_max); }
+	}
+}
+
+} // namespace emath
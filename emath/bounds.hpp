@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <loguru.hpp>
+
+#include "parallel.hpp"
+
+namespace emath {
+
+/*
+ Bounds of many points, used by AABB_T::from_points and AABB3_T::from_points.
+
+ The points are DIM consecutive T:s each, 'stride' bytes apart (so packed Vec2f/Vec3f arrays
+ as well as positions in interleaved vertex buffers work). n must be at least 1.
+ With num_threads > 1 the points are split into that many chunks.
+
+ Points are compared with <, so NaN:s give unspecified results.
+ */
+
+/// One chunk, scalar. Keeps two independent sets of accumulators to not be limited by latency.
+template<typename T, int DIM>
+void scalar_point_bounds(const void* first, size_t stride, size_t n, T* out_min, T* out_max)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(first);
+	auto point = [&](size_t i) { return reinterpret_cast<const T*>(bytes + i * stride); };
+
+	T min0[DIM], max0[DIM], min1[DIM], max1[DIM];
+	for (int d = 0; d < DIM; ++d) {
+		min0[d] = max0[d] = min1[d] = max1[d] = point(0)[d];
+	}
+
+	size_t i = 1;
+	for (; i + 2 <= n; i += 2) {
+		const T* p = point(i);
+		const T* q = point(i + 1);
+		for (int d = 0; d < DIM; ++d) {
+			min0[d] = (p[d] < min0[d] ? p[d] : min0[d]);
+			max0[d] = (p[d] > max0[d] ? p[d] : max0[d]);
+			min1[d] = (q[d] < min1[d] ? q[d] : min1[d]);
+			max1[d] = (q[d] > max1[d] ? q[d] : max1[d]);
+		}
+	}
+	for (; i < n; ++i) {
+		const T* p = point(i);
+		for (int d = 0; d < DIM; ++d) {
+			min0[d] = (p[d] < min0[d] ? p[d] : min0[d]);
+			max0[d] = (p[d] > max0[d] ? p[d] : max0[d]);
+		}
+	}
+
+	for (int d = 0; d < DIM; ++d) {
+		out_min[d] = std::min(min0[d], min1[d]);
+		out_max[d] = std::max(max0[d], max1[d]);
+	}
+}
+
+/// Vectorized for packed points (stride == dim * sizeof(float)), scalar otherwise. dim is 2 or 3.
+void float_point_bounds(const void* first, size_t stride, size_t n, int dim, float* out_min, float* out_max);
+
+template<typename T, int DIM>
+struct PointBounds
+{
+	static void chunk(const void* first, size_t stride, size_t n, T* out_min, T* out_max)
+	{
+		scalar_point_bounds<T, DIM>(first, stride, n, out_min, out_max);
+	}
+};
+
+template<int DIM>
+struct PointBounds<float, DIM>
+{
+	static void chunk(const void* first, size_t stride, size_t n, float* out_min, float* out_max)
+	{
+		float_point_bounds(first, stride, n, DIM, out_min, out_max);
+	}
+};
+
+template<typename T, int DIM>
+void point_bounds(const void* first, size_t stride, size_t n, unsigned num_threads, T* out_min, T* out_max)
+{
+	DCHECK_F(n > 0);
+	const size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, n));
+	if (num_chunks == 1) {
+		PointBounds<T, DIM>::chunk(first, stride, n, out_min, out_max);
+		return;
+	}
+
+	std::vector<T> mins(num_chunks * DIM), maxs(num_chunks * DIM);
+	const uint8_t* bytes = static_cast<const uint8_t*>(first);
+	parallel_for(num_chunks, num_threads, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			const size_t first_point = n * c / num_chunks;
+			const size_t end_point   = n * (c + 1) / num_chunks;
+			PointBounds<T, DIM>::chunk(bytes + first_point * stride, stride, end_point - first_point,
+			                           &mins[c * DIM], &maxs[c * DIM]);
+		}
+	});
+
+	for (int d = 0; d < DIM; ++d) {
+		out_min[d] = mins[d];
+		out_max[d] = maxs[d];
+		for (size_t c = 1; c < num_chunks; ++c) {
+			out_min[d] = std::min(out_min[d], mins[c * DIM + d]);
+			out_max[d] = std::max(out_max[d], maxs[c * DIM + d]);
+		}
+	}
+}
+
+} // namespace emath
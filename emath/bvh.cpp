@@ -0,0 +1,293 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <loguru.hpp>
+
+namespace emath {
+
+namespace {
+
+const size_t   MAX_LEAF_SIZE     = 4;
+const int      NUM_BINS          = 16;
+const unsigned MAX_SAH_DEPTH     = 24; // Deeper than this we use median splits, to bound the depth.
+const unsigned MAX_STACK_SIZE    = 64;
+const float    TRAVERSAL_COST    = 1.0f; // Relative to the cost of testing one primitive.
+
+/// In 2D, the chance of a random ray hitting a box is proportional to its perimeter.
+inline float half_perimeter(const AABB2f& b)
+{
+	return b.width() + b.height();
+}
+
+/// Does the ray hit the box for some t in [min_t, max_t]?
+inline bool ray_hits_box(const Vec2f& o, const Vec2f& d, const Vec2f& inv_d,
+                         const AABB2f& b, float min_t, float max_t)
+{
+	for (int a = 0; a < 2; ++a) {
+		if (d[a] == 0) {
+			if (o[a] < b.min()[a] || b.max()[a] < o[a]) {
+				return false;
+			}
+		} else {
+			float t_near = (b.min()[a] - o[a]) * inv_d[a];
+			float t_far  = (b.max()[a] - o[a]) * inv_d[a];
+			if (t_near > t_far) { std::swap(t_near, t_far); }
+			min_t = std::max(min_t, t_near);
+			max_t = std::min(max_t, t_far);
+		}
+	}
+	return min_t <= max_t;
+}
+
+} // namespace
+
+struct BVH2::BuildPrim
+{
+	AABB2f    bounds;
+	Vec2f     centroid;
+	Primitive prim;
+};
+
+// ----------------------------------------------------------------------------
+
+AABB2f BVH2::prim_bounds(const Primitive& prim) const
+{
+	AABB2f b;
+	switch (prim.shape) {
+		case Shape::Circle: {
+			const Circle& c = _circles[prim.index];
+			b = AABB2f::from_center_size(c.p, Vec2f(2 * c.rad));
+		} break;
+
+		case Shape::Capsule: {
+			const CapsuleBaked& c = _capsules[prim.index];
+			b = AABB2f::from_points({c.p[0], c.p[1]}).enlarged_by_rad(c.rad);
+		} break;
+
+		case Shape::AABB: {
+			b = _aabbs[prim.index];
+		} break;
+	}
+
+	// The trace functions compute hit points with their own rounding,
+	// so pad a little to make sure those always land inside the box.
+	const float magnitude = std::max(std::max(std::abs(b.min().x), std::abs(b.min().y)),
+	                                 std::max(std::abs(b.max().x), std::abs(b.max().y)));
+	return b.enlarged_by_rad(1e-5f * (1 + magnitude));
+}
+
+void BVH2::build(std::vector<Circle> circles, std::vector<CapsuleBaked> capsules, std::vector<AABB2f> aabbs)
+{
+	_circles  = std::move(circles);
+	_capsules = std::move(capsules);
+	_aabbs    = std::move(aabbs);
+
+	_nodes.clear();
+	_prims.clear();
+
+	std::vector<BuildPrim> prims;
+	prims.reserve(_circles.size() + _capsules.size() + _aabbs.size());
+	auto add = [&](Shape shape, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			BuildPrim bp;
+			bp.prim     = Primitive{shape, uint32_t(i)};
+			bp.bounds   = prim_bounds(bp.prim);
+			bp.centroid = bp.bounds.center();
+			prims.push_back(bp);
+		}
+	};
+	add(Shape::Circle,  _circles.size());
+	add(Shape::Capsule, _capsules.size());
+	add(Shape::AABB,    _aabbs.size());
+
+	if (prims.empty()) { return; }
+
+	_nodes.reserve(2 * prims.size());
+	_prims.reserve(prims.size());
+	build_recursive(prims, 0, prims.size(), 0);
+}
+
+uint32_t BVH2::build_recursive(std::vector<BuildPrim>& prims, size_t begin, size_t end, unsigned depth)
+{
+	const uint32_t node_index = uint32_t(_nodes.size());
+	_nodes.emplace_back();
+
+	AABB2f bounds = AABB2f::nothing();
+	AABB2f centroid_bounds = AABB2f::nothing();
+	for (size_t i = begin; i < end; ++i) {
+		bounds.include(prims[i].bounds);
+		centroid_bounds.include(prims[i].centroid);
+	}
+
+	const size_t count = end - begin;
+	const int axis = (centroid_bounds.width() >= centroid_bounds.height() ? 0 : 1);
+	const float axis_min    = centroid_bounds.min()[axis];
+	const float axis_extent = centroid_bounds.size()[axis];
+
+	auto make_leaf = [&]() {
+		Node& node  = _nodes[node_index];
+		node.bounds = bounds;
+		node.offset = uint32_t(_prims.size());
+		node.count  = uint16_t(count);
+		node.axis   = 0;
+		for (size_t i = begin; i < end; ++i) {
+			_prims.push_back(prims[i].prim);
+		}
+		return node_index;
+	};
+
+	if (count <= 1) {
+		return make_leaf();
+	}
+
+	size_t mid = begin;
+
+	if (axis_extent > 0 && depth < MAX_SAH_DEPTH) {
+		// Binned SAH: put the centroids in bins, then try splitting between each pair of bins.
+		struct Bin
+		{
+			AABB2f bounds = AABB2f::nothing();
+			size_t count  = 0;
+		};
+		Bin bins[NUM_BINS];
+
+		const float bin_scale = NUM_BINS / axis_extent;
+		auto bin_index = [&](const BuildPrim& bp) {
+			return std::min(NUM_BINS - 1, int((bp.centroid[axis] - axis_min) * bin_scale));
+		};
+
+		for (size_t i = begin; i < end; ++i) {
+			Bin& bin = bins[bin_index(prims[i])];
+			bin.bounds.include(prims[i].bounds);
+			bin.count += 1;
+		}
+
+		// right_cost[i] is the cost of everything in bins [i+1, NUM_BINS).
+		float right_cost[NUM_BINS];
+		AABB2f right_bounds = AABB2f::nothing();
+		size_t right_count = 0;
+		for (int i = NUM_BINS - 1; i > 0; --i) {
+			right_bounds.include(bins[i].bounds);
+			right_count += bins[i].count;
+			right_cost[i - 1] = (right_count > 0 ? right_count * half_perimeter(right_bounds) : 0);
+		}
+
+		int   best_split = -1;
+		float best_cost  = INFf;
+		AABB2f left_bounds = AABB2f::nothing();
+		size_t left_count = 0;
+		for (int i = 0; i < NUM_BINS - 1; ++i) {
+			left_bounds.include(bins[i].bounds);
+			left_count += bins[i].count;
+			if (left_count == 0 || left_count == count) { continue; }
+			const float cost = left_count * half_perimeter(left_bounds) + right_cost[i];
+			if (cost < best_cost) {
+				best_cost  = cost;
+				best_split = i;
+			}
+		}
+
+		const float leaf_cost  = float(count);
+		const float split_cost = TRAVERSAL_COST + best_cost / half_perimeter(bounds);
+
+		if (count <= MAX_LEAF_SIZE && (best_split < 0 || leaf_cost <= split_cost)) {
+			return make_leaf();
+		}
+
+		if (best_split >= 0) {
+			mid = std::partition(prims.begin() + begin, prims.begin() + end, [&](const BuildPrim& bp) {
+				return bin_index(bp) <= best_split;
+			}) - prims.begin();
+		}
+	} else if (count <= MAX_LEAF_SIZE) {
+		return make_leaf();
+	}
+
+	if (mid == begin || mid == end) {
+		// All centroids in one spot, or we are getting too deep: median split.
+		mid = begin + count / 2;
+		std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+			[&](const BuildPrim& a, const BuildPrim& b) { return a.centroid[axis] < b.centroid[axis]; });
+	}
+
+	build_recursive(prims, begin, mid, depth + 1); // Always at node_index + 1
+	const uint32_t second = build_recursive(prims, mid, end, depth + 1);
+
+	Node& node  = _nodes[node_index];
+	node.bounds = bounds;
+	node.offset = second;
+	node.count  = 0;
+	node.axis   = uint8_t(axis);
+	return node_index;
+}
+
+void BVH2::refit()
+{
+	// Children always come after their parent, so a backwards sweep sees children first.
+	for (size_t i = _nodes.size(); i-- > 0; ) {
+		Node& node = _nodes[i];
+		if (node.count > 0) {
+			node.bounds = AABB2f::nothing();
+			for (uint32_t k = 0; k < node.count; ++k) {
+				node.bounds.include(prim_bounds(_prims[node.offset + k]));
+			}
+		} else {
+			node.bounds = _nodes[i + 1].bounds;
+			node.bounds.include(_nodes[node.offset].bounds);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool BVH2::closest_hit(trace::info& ti, Primitive* out_hit) const
+{
+	if (_nodes.empty()) { return false; }
+
+	const Vec2f o = ti.ray.origin();
+	const Vec2f d = ti.ray.dir();
+	const Vec2f inv_d(1 / d.x, 1 / d.y);
+
+	bool did_hit = false;
+
+	uint32_t stack[MAX_STACK_SIZE];
+	unsigned stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const uint32_t node_index = stack[--stack_size];
+		const Node& node = _nodes[node_index];
+
+		if (!ray_hits_box(o, d, inv_d, node.bounds, ti.min_t, ti.t)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t k = 0; k < node.count; ++k) {
+				const Primitive& prim = _prims[node.offset + k];
+				bool hit = false;
+				switch (prim.shape) {
+					case Shape::Circle:  hit = trace::ray_circle (ti, _circles[prim.index]);  break;
+					case Shape::Capsule: hit = trace::ray_capsule(ti, _capsules[prim.index]); break;
+					case Shape::AABB:    hit = trace::rayAABB    (ti, _aabbs[prim.index]);    break;
+				}
+				if (hit) {
+					did_hit = true;
+					if (out_hit) { *out_hit = prim; }
+				}
+			}
+		} else {
+			// Visit the child closest to the ray origin first, so ti.t shrinks sooner:
+			uint32_t first  = node_index + 1;
+			uint32_t second = node.offset;
+			if (d[node.axis] < 0) { std::swap(first, second); }
+			DCHECK_F(stack_size + 2 <= MAX_STACK_SIZE);
+			stack[stack_size++] = second;
+			stack[stack_size++] = first;
+		}
+	}
+
+	return did_hit;
+}
+
+} // namespace emath
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "aabb.hpp"
+#include "capsule.hpp"
+#include "circle.hpp"
+#include "fwd.hpp"
+#include "trace.hpp"
+
+namespace emath {
+
+/*
+ Static 2D bounding volume hierarchy over a mix of circles, capsules and boxes,
+ for tracing rays against many shapes at once.
+
+ Built top-down with a binned surface area heuristic (in 2D the "surface" is the perimeter).
+ The nodes are stored depth-first in one flat array, so the first child of a node
+ is always the next node, and only the second child needs an index.
+
+ The shapes can be moved after building: change them via circles()/capsules()/aabbs()
+ and call refit(). This keeps the tree topology, so if things move a lot, build again.
+ */
+class BVH2
+{
+public:
+	enum class Shape : uint8_t { Circle, Capsule, AABB };
+
+	/// Which shape was hit: an index into circles(), capsules() or aabbs().
+	struct Primitive
+	{
+		Shape    shape;
+		uint32_t index;
+	};
+
+	BVH2() = default;
+
+	/// Builds the tree from scratch.
+	void build(std::vector<Circle> circles, std::vector<CapsuleBaked> capsules, std::vector<AABB2f> aabbs);
+
+	/// Recompute all bounds after moving shapes. Call after changing anything in
+	/// circles(), capsules() or aabbs() (but don't add or remove any!).
+	void refit();
+
+	std::vector<Circle>&       circles()        { return _circles;  }
+	std::vector<CapsuleBaked>& capsules()       { return _capsules; }
+	std::vector<AABB2f>&       aabbs()          { return _aabbs;    }
+	const std::vector<Circle>&       circles()  const { return _circles;  }
+	const std::vector<CapsuleBaked>& capsules() const { return _capsules; }
+	const std::vector<AABB2f>&       aabbs()    const { return _aabbs;    }
+
+	/// Same as calling trace::ray_circle/ray_capsule/rayAABB on every shape:
+	/// on a hit, ti.t and ti.normal_dir are updated for the closest one and true is returned.
+	/// If two shapes are hit at the exact same t, which one is reported may differ from a linear scan.
+	bool closest_hit(trace::info& ti, Primitive* out_hit = nullptr) const;
+
+	size_t num_nodes() const { return _nodes.size(); }
+	bool empty() const { return _prims.empty(); }
+
+	/// The bounds of everything, or AABB2f::nothing() if empty.
+	AABB2f bounds() const { return _nodes.empty() ? AABB2f::nothing() : _nodes[0].bounds; }
+
+private:
+	struct Node
+	{
+		AABB2f   bounds;
+		uint32_t offset; // Leaf: first index into _prims. Inner: index of second child.
+		uint16_t count;  // Number of primitives, or 0 for inner nodes.
+		uint8_t  axis;   // Split axis of inner nodes, for front-to-back traversal.
+		uint8_t  pad_;
+	};
+	static_assert(sizeof(Node) == 24, "Pack");
+
+	struct BuildPrim;
+
+	AABB2f prim_bounds(const Primitive& prim) const;
+	uint32_t build_recursive(std::vector<BuildPrim>& prims, size_t begin, size_t end, unsigned depth);
+
+	std::vector<Node>         _nodes;
+	std::vector<Primitive>    _prims; // In leaf order.
+	std::vector<Circle>       _circles;
+	std::vector<CapsuleBaked> _capsules;
+	std::vector<AABB2f>       _aabbs;
+};
+
+} // namespace emath
@@ -12,20 +12,10 @@ namespace emath {
 struct Capsule
 {
 	union {
-		struct {
-			union {
-				Vec2f p[2];
-				struct { Vec2f p0, p1; };
-				LineSeg line_seg;
-			};
-			float rad; // >= 0 please
-		};
-
-		struct {
-			Vec2f p0_again;
-			Circle circ_1;
-		};
+		Vec2f p[2];
+		LineSeg line_seg;
 	};
+	float rad; // >= 0 please
 
 	Capsule() = default; // Quick
 
@@ -35,34 +25,34 @@ struct Capsule
 		rad = rad_;
 	}
 
+	Vec2f&       p0()       { return p[0]; }
+	const Vec2f& p0() const { return p[0]; }
+	Vec2f&       p1()       { return p[1]; }
+	const Vec2f& p1() const { return p[1]; }
+
 	// p0==p1, rad can be anything >=0.
 	bool is_circle() const { return p[0]==p[1]; }
 
-	Circle& circle()
-	{
-		assert(is_circle());
-		return circ_1;
-	}
-	const Circle& circle() const
+	Circle circle() const
 	{
 		assert(is_circle());
-		return circ_1;
+		return circle_1();
 	}
 
 	// Endpoints:
 	Circle circle_0() const
 	{
-		return Circle{p0, rad};
+		return Circle{p[0], rad};
 	}
 
-	const Circle& circle_1() const
+	Circle circle_1() const
 	{
-		return circ_1;
+		return Circle{p[1], rad};
 	}
 
 	emath::Vec2f dir() const
 	{
-		return p1-p0;
+		return p[1]-p[0];
 	}
 
 	emath::Vec2f dir_unit() const
@@ -85,10 +75,7 @@ struct Capsule
 	static bool intersects(const Capsule& a, const Capsule& b);
 };
 
-// TODO
-//static_assert(MEMBER_OFFSET(Capsule, circ_1) == MEMBER_OFFSET(Capsule, p[1]), "Pack");
 static_assert(sizeof(Capsule) == sizeof(LineSeg) + sizeof(float), "Pack");
-static_assert(sizeof(Capsule) == sizeof(Vec2f) + sizeof(Circle), "Pack");
 
 static_assert(std::is_pod<Capsule>::value,                "is_pod");
 static_assert(std::is_standard_layout<Capsule>::value,    "is_standard_layout");
@@ -110,7 +97,7 @@ inline float distance(const Capsule& cap, const Circle& circ)
 
 inline bool operator==(const Capsule& a, const Capsule& b)
 {
-	return a.p0==b.p0 && a.p1==b.p1 && a.rad==b.rad;
+	return a.p[0]==b.p[0] && a.p[1]==b.p[1] && a.rad==b.rad;
 }
 
 // ------------------------------------------------
@@ -120,13 +107,13 @@ struct CapsuleBaked : public Capsule
 {
 public:
 	Vec2f A,N; // Base vectors for coordinate transform
-	float length; // Distance between cap.p0 and cap.p1.
+	float length; // Distance between cap.p[0] and cap.p[1].
 
 	CapsuleBaked()=default;
 
 	explicit CapsuleBaked(const Capsule& c) : Capsule(c)
 	{
-		A = p1 - p0;
+		A = p[1] - p[0];
 		length = normalize(A);
 		N = rot90CW(A);
 	}
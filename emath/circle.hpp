@@ -1,6 +1,7 @@
 #pragma once
 
 #include "fwd.hpp"
+#include "vec2.hpp"
 
 namespace emath {
 
@@ -0,0 +1,153 @@
+#include "filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <loguru.hpp>
+
+namespace emath {
+
+namespace {
+
+/// out[x] = mean of in[x - r, x + r], clipped to [0, width).
+/// Accumulates in double, so the running sum does not drift over long rows.
+void box_row(const float* in, float* out, int width, int r)
+{
+	double acc = 0;
+	for (int i = 0; i <= std::min(r, width - 1); ++i) {
+		acc += in[i];
+	}
+	auto clipped = [&](int x) {
+		const int lo = std::max(x - r, 0);
+		const int hi = std::min(x + r, width - 1);
+		out[x] = float(acc / (hi - lo + 1));
+		if (x + r + 1 < width) { acc += in[x + r + 1]; }
+		if (x - r >= 0)        { acc -= in[x - r];     }
+	};
+
+	const double scale = 1.0 / (2 * r + 1);
+	int x = 0;
+	for (; x < width && x < r; ++x) {
+		clipped(x);
+	}
+	for (; x + r + 1 < width; ++x) { // The whole window is inside
+		out[x] = float(acc * scale);
+		acc += double(in[x + r + 1]) - double(in[x - r]);
+	}
+	for (; x < width; ++x) {
+		clipped(x);
+	}
+}
+
+/// The vertical pass for rows [begin, end). Keeps a running sum per column, which is a
+/// plain loop over contiguous memory that the compiler vectorizes.
+void box_columns(ConstMatrixView<float> src, MatrixView<float> dst, int r, int begin, int end)
+{
+	const int width  = src.width();
+	const int height = src.height();
+	std::vector<double> col(width, 0.0);
+
+	for (int y = std::max(begin - r, 0); y <= std::min(begin + r, height - 1); ++y) {
+		const float* row = src.row_ptr(y);
+		for (int x = 0; x < width; ++x) {
+			col[x] += row[x];
+		}
+	}
+
+	for (int y = begin; y < end; ++y) {
+		const int    lo    = std::max(y - r, 0);
+		const int    hi    = std::min(y + r, height - 1);
+		const double scale = 1.0 / (hi - lo + 1);
+		float* out = dst.row_ptr(y);
+		for (int x = 0; x < width; ++x) {
+			out[x] = float(col[x] * scale);
+		}
+
+		const float* add = (y + r + 1 < height ? src.row_ptr(y + r + 1) : nullptr);
+		const float* sub = (y - r >= 0         ? src.row_ptr(y - r)     : nullptr);
+		if (add && sub) {
+			for (int x = 0; x < width; ++x) {
+				col[x] += double(add[x]) - double(sub[x]);
+			}
+		} else if (add) {
+			for (int x = 0; x < width; ++x) {
+				col[x] += add[x];
+			}
+		} else if (sub) {
+			for (int x = 0; x < width; ++x) {
+				col[x] -= sub[x];
+			}
+		}
+	}
+}
+
+void box_blur_into(ConstMatrixView<float> src, MatrixView<float> dst, int radius_x, int radius_y,
+                   unsigned num_threads, Matrixf& tmp)
+{
+	const int width  = src.width();
+	const int height = src.height();
+
+	// Horizontal into tmp, then vertical from tmp into dst, so dst may be src.
+	tmp.resize_discard(width, height);
+	parallel_for(size_t(height), num_threads, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y) {
+			box_row(src.row_ptr(int(y)), tmp.row_ptr(int(y)), width, radius_x);
+		}
+	});
+
+	parallel_for(size_t(height), num_threads, [&](size_t begin, size_t end) {
+		box_columns(tmp, dst, radius_y, int(begin), int(end));
+	});
+}
+
+} // namespace
+
+void box_blur(ConstMatrixView<float> src, MatrixView<float> dst, int radius_x, int radius_y, unsigned num_threads)
+{
+	CHECK_F(src.width() == dst.width() && src.height() == dst.height(), "Size mismatch");
+	CHECK_F(radius_x >= 0 && radius_y >= 0, "Negative blur radius");
+	if (src.empty()) { return; }
+
+	Matrixf tmp;
+	box_blur_into(src, dst, radius_x, radius_y, num_threads, tmp);
+}
+
+void gaussian_blur(ConstMatrixView<float> src, MatrixView<float> dst, float sigma, unsigned num_threads)
+{
+	CHECK_F(src.width() == dst.width() && src.height() == dst.height(), "Size mismatch");
+	if (src.empty()) { return; }
+
+	// Three boxes whose combined variance matches sigma^2 (a box of width w has variance (w^2 - 1) / 12).
+	// Their widths are wl or wl + 2, for some odd wl. See "Fast Almost-Gaussian Filtering", Kovesi 2010.
+	const int    n       = 3;
+	const double var     = double(sigma) * sigma;
+	int          wl      = int(std::floor(std::sqrt(12 * var / n + 1)));
+	if (wl % 2 == 0) { wl -= 1; }
+	const int    num_wl  = int(std::round((12 * var - n * wl * wl - 4 * n * wl - 3 * n) / (-4 * wl - 4)));
+
+	Matrixf tmp;
+	ConstMatrixView<float> in = src;
+	for (int i = 0; i < n; ++i) {
+		const int w = (i < num_wl ? wl : wl + 2);
+		const int r = std::max(0, (w - 1) / 2);
+		box_blur_into(in, dst, r, r, num_threads, tmp);
+		in = dst;
+	}
+}
+
+Matrixf box_blur(const Matrixf& src, int radius, unsigned num_threads)
+{
+	Matrixf result(src.width(), src.height());
+	box_blur(src, result, radius, radius, num_threads);
+	return result;
+}
+
+Matrixf gaussian_blur(const Matrixf& src, float sigma, unsigned num_threads)
+{
+	Matrixf result(src.width(), src.height());
+	gaussian_blur(src, result, sigma, num_threads);
+	return result;
+}
+
+} // namespace emath
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "fwd.hpp"
+#include "matrix.hpp"
+
+namespace emath {
+
+/*
+ Blurs of float grids (heightmaps, occupancy grids, cost maps, ...).
+
+ Both are separable and use running sums, so the cost per element does not depend on the radius.
+ Rows are split over num_threads.
+
+ Near the edges the average is taken over the part of the window that is inside the matrix,
+ so values don't fade towards the borders.
+ For a single rectangle, use SummedAreaTable::mean_clamped, which gives the same average.
+
+ 'dst' must have the same size as 'src', and may be the same matrix.
+ */
+
+/// Each element becomes the mean of the (2 * radius_x + 1) x (2 * radius_y + 1) window around it.
+void box_blur(ConstMatrixView<float> src, MatrixView<float> dst, int radius_x, int radius_y, unsigned num_threads = 1);
+
+/// Approximated by three box blurs. Box widths are whole numbers, so this is close to
+/// a true Gaussian for sigmas of a few elements and up, and a bit narrower below that.
+void gaussian_blur(ConstMatrixView<float> src, MatrixView<float> dst, float sigma, unsigned num_threads = 1);
+
+Matrixf box_blur(const Matrixf& src, int radius, unsigned num_threads = 1);
+Matrixf gaussian_blur(const Matrixf& src, float sigma, unsigned num_threads = 1);
+
+} // namespace emath
@@ -1,20 +1,80 @@
 #include "frustum.hpp"
 
+#include <algorithm>
+#include <loguru.hpp>
+
 // #if !EMILIB_GLES
 // #  include <emilib/gl_lib_opengl.hpp>
 // #endif
 
 #include "intersect.hpp"
+#include "simd.hpp"
 #include "vec4.hpp"
 
 namespace emath {
 
-Frustum Frustum::from_matrix(const Mat4f& mvp)
+template<typename T>
+constexpr uint8_t FrustumT<T>::ALL_PLANES; // Needed before C++17 when bound to a reference.
+
+template<typename T>
+FrustumT<T> FrustumT<T>::from_matrix(const Mat4T<T>& mvp, Corners corners)
+{
+	return FrustumT(mvp, corners);
+}
+
+template<typename T>
+void FrustumT<T>::compute_corners()
+{
+	if (_has_corners) { return; }
+
+	// Same as Plane::plane_intersection(z, x, y) for each corner, but each corner shares its
+	// cross products with three others, so there are twelve of them instead of 24.
+	const Plane* z[2] = { &_planes[Back],   &_planes[Front] };
+	const Plane* x[2] = { &_planes[Left],   &_planes[Right] };
+	const Plane* y[2] = { &_planes[Bottom], &_planes[Top]   };
+
+	Vec3 xy[2][2], yz[2][2], zx[2][2];
+	for (int a = 0; a < 2; ++a) {
+		for (int b = 0; b < 2; ++b) {
+			xy[a][b] = cross(x[a]->normal(), y[b]->normal());
+			yz[a][b] = cross(y[a]->normal(), z[b]->normal());
+			zx[a][b] = cross(z[a]->normal(), x[b]->normal());
+		}
+	}
+
+	size_t i = 0;
+	for (int zi = 0; zi < 2; ++zi) {
+		for (int xi = 0; xi < 2; ++xi) {
+			for (int yi = 0; yi < 2; ++yi) {
+				const T det = dot(z[zi]->normal(), xy[xi][yi]);
+				const Vec3 top =
+					xy[xi][yi] * -z[zi]->distance() +
+					yz[yi][zi] * -x[xi]->distance() +
+					zx[zi][xi] * -y[yi]->distance();
+				_points[i++] = top / det;
+			}
+		}
+	}
+
+	_has_corners = true;
+}
+
+template<typename T>
+FrustumT<float> FrustumT<T>::relative_to(const Vec3& origin) const
 {
-	return Frustum(mvp);
+	FrustumT<float> result;
+	for (size_t i=0; i<NSides; ++i) {
+		result._planes[i] = PlaneT<float>(_planes[i].relative_to(origin));
+	}
+	for (size_t i=0; i<NPoints; ++i) {
+		result._points[i] = Vec3f(_points[i] - origin);
+	}
+	result._has_corners = _has_corners;
+	return result;
 }
 
-bool Frustum::contains_point(const Vec3f& p) const
+template<typename T>
+bool FrustumT<T>::contains_point(const Vec3& p) const
 {
 	for (size_t i=0 ; i<NSides ; ++i) {
 		if (_planes[i].distance(p) > 0) {
@@ -24,8 +84,10 @@ bool Frustum::contains_point(const Vec3f& p) const
 	return true;
 }
 
-Frustum::PlaneIntersectResult Frustum::plane_intersection(const Plane& p) const
+template<typename T>
+typename FrustumT<T>::PlaneIntersectResult FrustumT<T>::plane_intersection(const Plane& p) const
 {
+	DCHECK_F(_has_corners, "The corners were skipped");
 	int sgn = emath::sign(p.distance(_points[0]));
 
 	for (size_t i=1; i<NPoints; ++i) {
@@ -37,12 +99,13 @@ Frustum::PlaneIntersectResult Frustum::plane_intersection(const Plane& p) const
 	return sgn > 0 ? PlaneIntersectResult::Infront : sgn == 0 ? PlaneIntersectResult::Intersect : PlaneIntersectResult::Behind;
 }
 
-IntersectResult Frustum::test_sphere(const Vec3f& c, float r) const
+template<typename T>
+IntersectResult FrustumT<T>::test_sphere(const Vec3& c, T r) const
 {
 	bool intersects = false;
 
 	for (size_t i=0; i<NSides; ++i) {
-		float distance = _planes[i].distance(c);
+		T distance = _planes[i].distance(c);
 
 		if (distance > r) {
 			return IntersectResult::Outside;
@@ -60,8 +123,10 @@ IntersectResult Frustum::test_sphere(const Vec3f& c, float r) const
 	}
 }
 
-bool Frustum::cull_box(const Vec3f& c, const Vec3f& e) const
+template<typename T>
+bool FrustumT<T>::cull_box(const Vec3& c, const Vec3& e) const
 {
+	DCHECK_F(_has_corners, "The corners were skipped");
 	const auto mins = c - e;
 	const auto maxs = c + e;
 
@@ -69,7 +134,7 @@ bool Frustum::cull_box(const Vec3f& c, const Vec3f& e) const
 	// Test all planes against closest corner
 
 	for (auto& p : _planes) {
-		Vec3f closest = {
+		Vec3 closest = {
 			p.normal().x > 0 ? mins.x : maxs.x,
 			p.normal().y > 0 ? mins.y : maxs.y,
 			p.normal().z > 0 ? mins.z : maxs.z
@@ -166,63 +231,228 @@ bool Frustum::cull_box(const Vec3f& c, const Vec3f& e) const
 	#endif
 }
 
-Frustum::Frustum(const Mat4f& mat)
+template<typename T>
+IntersectResult FrustumT<T>::cull_box_masked(const Vec3& c, const Vec3& e, uint8_t* inout_mask,
+                                             uint8_t* inout_last_plane, CullStats* stats) const
 {
-	//Vec4f rows[4] = { mat.row(0), mat.row(1), mat.row(2), mat.row(3) };
-	Vec4f rows[4] = { mat.col(0), mat.col(1), mat.col(2), mat.col(3) };
+	DCHECK_NOTNULL_F(inout_mask);
+	const auto mins = c - e;
+	const auto maxs = c + e;
 
-	_planes[Right]  = Plane(+rows[0] - rows[3]);
-	_planes[Left]   = Plane(-rows[0] - rows[3]);
-	_planes[Top]    = Plane(+rows[1] - rows[3]);
-	_planes[Bottom] = Plane(-rows[1] - rows[3]);
-	_planes[Back]   = Plane(+rows[2] - rows[3]);
-	_planes[Front]  = Plane(-rows[2] - rows[3]);
+	uint8_t mask = *inout_mask;
+	const size_t first = inout_last_plane ? *inout_last_plane : 0;
+	DCHECK_F(first < NSides);
+	if (stats) { stats->nodes += 1; }
 
-#if 1
-	// NOT TESTED in 'Voxels'
-	_points[0] = Plane::plane_intersection(_planes[Back],  _planes[Left],  _planes[Bottom]);
-	_points[1] = Plane::plane_intersection(_planes[Back],  _planes[Left],  _planes[Top]   );
-	_points[2] = Plane::plane_intersection(_planes[Back],  _planes[Right], _planes[Bottom]);
-	_points[3] = Plane::plane_intersection(_planes[Back],  _planes[Right], _planes[Top]   );
-
-	_points[4] = Plane::plane_intersection(_planes[Front], _planes[Left],  _planes[Bottom]);
-	_points[5] = Plane::plane_intersection(_planes[Front], _planes[Left],  _planes[Top]   );
-	_points[6] = Plane::plane_intersection(_planes[Front], _planes[Right], _planes[Bottom]);
-	_points[7] = Plane::plane_intersection(_planes[Front], _planes[Right], _planes[Top]   );
-#else
-	_points[0] = Vec3f(-1, -1, -1);
-	_points[1] = Vec3f(-1, +1, -1);
-	_points[2] = Vec3f(+1, -1, -1);
-	_points[3] = Vec3f(+1, +1, -1);
+	for (size_t k = 0; k < NSides; ++k) {
+		const size_t i = (first + k) % NSides;
+		if ((mask & (1 << i)) == 0) { continue; }
+		if (stats) { stats->plane_tests += 1; }
+
+		const Plane& p = _planes[i];
+		const Vec3 closest = {
+			p.normal().x > 0 ? mins.x : maxs.x,
+			p.normal().y > 0 ? mins.y : maxs.y,
+			p.normal().z > 0 ? mins.z : maxs.z
+		};
+		if (p.distance(closest) >= 0) {
+			if (inout_last_plane) { *inout_last_plane = uint8_t(i); }
+			if (stats) { stats->culled += 1; }
+			return IntersectResult::Outside;
+		}
+
+		const Vec3 farthest = {
+			p.normal().x > 0 ? maxs.x : mins.x,
+			p.normal().y > 0 ? maxs.y : mins.y,
+			p.normal().z > 0 ? maxs.z : mins.z
+		};
+		if (p.distance(farthest) < 0) {
+			mask &= uint8_t(~(1 << i)); // Completely inside this plane, and so are the children.
+		}
+	}
+
+	*inout_mask = mask;
+	return mask == 0 ? IntersectResult::Inside : IntersectResult::Intersects;
+}
+
+template<typename T>
+IntersectResult FrustumT<T>::test_sphere_masked(const Vec3& c, T r, uint8_t* inout_mask,
+                                                uint8_t* inout_last_plane, CullStats* stats) const
+{
+	DCHECK_NOTNULL_F(inout_mask);
+	uint8_t mask = *inout_mask;
+	const size_t first = inout_last_plane ? *inout_last_plane : 0;
+	DCHECK_F(first < NSides);
+	if (stats) { stats->nodes += 1; }
+
+	for (size_t k = 0; k < NSides; ++k) {
+		const size_t i = (first + k) % NSides;
+		if ((mask & (1 << i)) == 0) { continue; }
+		if (stats) { stats->plane_tests += 1; }
+
+		const T distance = _planes[i].distance(c);
+		if (distance > r) {
+			if (inout_last_plane) { *inout_last_plane = uint8_t(i); }
+			if (stats) { stats->culled += 1; }
+			return IntersectResult::Outside;
+		}
+		if (distance <= -r) {
+			mask &= uint8_t(~(1 << i));
+		}
+	}
+
+	*inout_mask = mask;
+	return mask == 0 ? IntersectResult::Inside : IntersectResult::Intersects;
+}
+
+template<typename T>
+size_t FrustumT<T>::cull_boxes_simd(const T*, const T*, const T*, const T*, const T*, const T*,
+                                    size_t, uint8_t*) const
+{
+	return 0;
+}
+
+template<>
+size_t FrustumT<float>::cull_boxes_simd(const float* cx, const float* cy, const float* cz,
+                                        const float* ex, const float* ey, const float* ez,
+                                        size_t n, uint8_t* out_visible) const
+{
+	size_t i = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+
+	// "All eight frustum corners are beyond the box on this side"
+	// is the same as "the bounds of the corners are beyond the box":
+	Vec3f pmin = _points[0];
+	Vec3f pmax = _points[0];
+	for (size_t p = 1; p < NPoints; ++p) {
+		for (int d = 0; d < 3; ++d) {
+			pmin[d] = std::min(pmin[d], _points[p][d]);
+			pmax[d] = std::max(pmax[d], _points[p][d]);
+		}
+	}
+
+	const floatv pmin_x = set1(pmin.x), pmin_y = set1(pmin.y), pmin_z = set1(pmin.z);
+	const floatv pmax_x = set1(pmax.x), pmax_y = set1(pmax.y), pmax_z = set1(pmax.z);
+
+	floatv nx[NSides], ny[NSides], nz[NSides], dist[NSides];
+	bool   pos_x[NSides], pos_y[NSides], pos_z[NSides];
+	for (size_t p = 0; p < NSides; ++p) {
+		const Vec3f& normal = _planes[p].normal();
+		nx[p] = set1(normal.x);
+		ny[p] = set1(normal.y);
+		nz[p] = set1(normal.z);
+		dist[p] = set1(_planes[p].distance());
+		pos_x[p] = normal.x > 0;
+		pos_y[p] = normal.y > 0;
+		pos_z[p] = normal.z > 0;
+	}
+
+	for (; i + WIDTH <= n; i += WIDTH) {
+		const floatv c_x = load(cx + i), c_y = load(cy + i), c_z = load(cz + i);
+		const floatv e_x = load(ex + i), e_y = load(ey + i), e_z = load(ez + i);
 
-	_points[4] = Vec3f(-1, -1, +1);
-	_points[5] = Vec3f(-1, +1, +1);
-	_points[6] = Vec3f(+1, -1, +1);
-	_points[7] = Vec3f(+1, +1, +1);
+		const floatv min_x = sub(c_x, e_x), min_y = sub(c_y, e_y), min_z = sub(c_z, e_z);
+		const floatv max_x = add(c_x, e_x), max_y = add(c_y, e_y), max_z = add(c_z, e_z);
 
-	Mat4f inv = inverted(mat);
+		floatv culled = zero();
 
-	for (uint i=0; i<NPoints; ++i) {
-		_points[i] = mul_pos(inv, _points[i]);
+		// Same operations in the same order as cull_box, so we get the same rounding:
+		for (size_t p = 0; p < NSides; ++p) {
+			const floatv closest_x = pos_x[p] ? min_x : max_x;
+			const floatv closest_y = pos_y[p] ? min_y : max_y;
+			const floatv closest_z = pos_z[p] ? min_z : max_z;
+			floatv d = add(mul(closest_x, nx[p]), mul(closest_y, ny[p]));
+			d = add(add(d, mul(closest_z, nz[p])), dist[p]);
+			culled = bit_or(culled, cmp_ge(d, zero()));
+		}
+
+		culled = bit_or(culled, cmp_gt(pmin_x, max_x));
+		culled = bit_or(culled, cmp_lt(pmax_x, min_x));
+		culled = bit_or(culled, cmp_gt(pmin_y, max_y));
+		culled = bit_or(culled, cmp_lt(pmax_y, min_y));
+		culled = bit_or(culled, cmp_gt(pmin_z, max_z));
+		culled = bit_or(culled, cmp_lt(pmax_z, min_z));
+
+		const int visible_bits = ~movemask(culled) & ((1 << WIDTH) - 1);
+		out_visible[i / 8] |= uint8_t(visible_bits << (i % 8));
 	}
+#else
+	(void)cx; (void)cy; (void)cz; (void)ex; (void)ey; (void)ez; (void)n; (void)out_visible;
 #endif
+
+	return i;
 }
 
-bool intersects(const Frustum& lhs, const Frustum& rhs)
+template<typename T>
+void FrustumT<T>::cull_boxes(const T* cx, const T* cy, const T* cz,
+                             const T* ex, const T* ey, const T* ez,
+                             size_t n, uint8_t* out_visible) const
 {
-	for (size_t i=0; i<Frustum::NSides; ++i) {
-		if (rhs.plane_intersection(lhs._planes[i]) == Frustum::PlaneIntersectResult::Infront) {
-			return false;
+	DCHECK_F(_has_corners, "The corners were skipped");
+	std::fill(out_visible, out_visible + (n + 7) / 8, uint8_t(0));
+
+	size_t i = cull_boxes_simd(cx, cy, cz, ex, ey, ez, n, out_visible);
+
+	for (; i < n; ++i) {
+		if (!cull_box(Vec3(cx[i], cy[i], cz[i]), Vec3(ex[i], ey[i], ez[i]))) {
+			out_visible[i / 8] |= uint8_t(1 << (i % 8));
 		}
 	}
+}
 
-	for (size_t i=0; i<Frustum::NSides; ++i) {
-		if (lhs.plane_intersection(rhs._planes[i]) == Frustum::PlaneIntersectResult::Infront) {
-			return false;
+template<typename T>
+void FrustumT<T>::cull_boxes(const Vec3* centers, const Vec3* extents, size_t n, uint8_t* out_visible) const
+{
+	// Transpose into small SoA blocks on the stack. The block size is a multiple of 8
+	// so that each block fills whole bytes of the bitmask.
+	constexpr size_t BLOCK = 64;
+	T cx[BLOCK], cy[BLOCK], cz[BLOCK];
+	T ex[BLOCK], ey[BLOCK], ez[BLOCK];
+
+	for (size_t start = 0; start < n; start += BLOCK) {
+		const size_t count = std::min(BLOCK, n - start);
+		for (size_t j = 0; j < count; ++j) {
+			cx[j] = centers[start + j].x;
+			cy[j] = centers[start + j].y;
+			cz[j] = centers[start + j].z;
+			ex[j] = extents[start + j].x;
+			ey[j] = extents[start + j].y;
+			ez[j] = extents[start + j].z;
 		}
+		cull_boxes(cx, cy, cz, ex, ey, ez, count, out_visible + start / 8);
 	}
+}
 
-	return true;
+template<typename T>
+FrustumT<T>::FrustumT(const Mat4T<T>& mat, Corners corners)
+{
+	//Vec4T<T> rows[4] = { mat.row(0), mat.row(1), mat.row(2), mat.row(3) };
+	Vec4T<T> rows[4] = { mat.col(0), mat.col(1), mat.col(2), mat.col(3) };
+
+	_planes[Right]  = Plane(+rows[0] - rows[3]);
+	_planes[Left]   = Plane(-rows[0] - rows[3]);
+	_planes[Top]    = Plane(+rows[1] - rows[3]);
+	_planes[Bottom] = Plane(-rows[1] - rows[3]);
+	_planes[Back]   = Plane(+rows[2] - rows[3]);
+	_planes[Front]  = Plane(-rows[2] - rows[3]);
+
+	if (corners == Corners::Compute) {
+		compute_corners();
+	} else if (corners == Corners::FromInverse) {
+		// Same order as compute_corners(): Back is z = +1 and Front is z = -1.
+		static const Vec3 NDC_CORNERS[NPoints] = {
+			{-1, -1, +1}, {-1, +1, +1}, {+1, -1, +1}, {+1, +1, +1},
+			{-1, -1, -1}, {-1, +1, -1}, {+1, -1, -1}, {+1, +1, -1},
+		};
+
+		const Mat4T<T> inv = inverted(mat);
+		for (size_t i=0; i<NPoints; ++i) {
+			_points[i] = mul_pos(inv, NDC_CORNERS[i]);
+		}
+		_has_corners = true;
+	}
 }
 
 //#if !EMILIB_GLES
@@ -276,4 +506,7 @@ BoundingSphere Frustum::CalcBoudingSphere() const
 }
 #endif
 
+template class FrustumT<float>;
+template class FrustumT<double>;
+
 } // namespace emath
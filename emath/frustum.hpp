@@ -15,15 +15,59 @@ class BoundingSphere;
 
 enum class IntersectResult { Outside, Inside, Intersects };
 
-/// 3D view frustum.
-class Frustum
+/*
+ 3D view frustum. T is float or double (Frustum and Frustumd).
+
+ Far from the origin, float planes jitter and misclassify things. For a big world, keep the camera
+ in double (Frustumd::from_matrix with a Mat4d) and call relative_to(camera position) once per frame.
+ That gives a float Frustum around the camera: test everything against it with positions relative to
+ the same origin (Vec3f(pos - origin), computed in double). The rebased values are small, so float is
+ precise again, and the batch tests run at full SIMD speed.
+ */
+template<typename T>
+class FrustumT
 {
 public:
-	Frustum() = default;
+	using Vec3  = Vec3T<T>;
+	using Plane = PlaneT<T>;
+
+	FrustumT() = default;
+
+	/// The corners are only needed by cull_box(es), plane_intersection and intersects (and FrustumSet).
+	enum class Corners
+	{
+		/// Intersect the planes. Precise, and the default.
+		Compute,
+
+		/// Transform the NDC cube with inverted(mvp). Faster, but in float the inverse loses precision
+		/// as far/near grows: the far corners can be off by up to 2e-4 of the far distance at
+		/// far/near = 100, 2e-3 at 1000 and 2e-2 at 10000. Fine for lights with a short range.
+		FromInverse,
+
+		/// No corners. For when you only use the other tests, e.g. for many light frustums per frame.
+		/// Call compute_corners() if you need them later.
+		Skip,
+	};
 
-	static Frustum from_matrix(const Mat4f& mvp);
+	static FrustumT from_matrix(const Mat4T<T>& mvp, Corners corners = Corners::Compute);
 
-	bool contains_point(const Vec3f& p) const;
+	bool has_corners() const { return _has_corners; }
+
+	/// Computes the corners from the planes (if it wasn't done already), for when they were skipped.
+	void compute_corners();
+
+	/// The same frustum in float, in coordinates where 'origin' is at zero.
+	/// The planes are rebased before rounding, so they stay precise as long as the camera is close to 'origin'.
+	FrustumT<float> relative_to(const Vec3& origin) const;
+
+	/// Pointing outwards, in the order Right, Left, Top, Bottom, Back, Front.
+	const Plane& plane(size_t i) const { return _planes[i]; }
+
+	/// The eight corners: four on the Back plane, then four on the Front plane,
+	/// each as left-bottom, left-top, right-bottom, right-top.
+	const Vec3& point(size_t i) const { return _points[i]; }
+
+	bool contains_point(const Vec3& p) const;
 
 	enum class PlaneIntersectResult { Infront, Behind, Intersect };
 
@@ -31,13 +75,75 @@ public:
 	/// Behind if it's completely behind, and Intersect if they intersect.
 	PlaneIntersectResult plane_intersection(const Plane& p) const;
 
-	IntersectResult test_sphere(const Vec3f& c, float r) const;
+	IntersectResult test_sphere(const Vec3& c, T r) const;
 	//IntersectResult test(const BoundingSphere& b);
 
 	/// return true if we can cull it.
-	bool cull_box(const Vec3f& center, const Vec3f& extent) const;
+	bool cull_box(const Vec3& center, const Vec3& extent) const;
+
+	/// Batch version of cull_box over n boxes given as separate center/extent arrays (SoA).
+	/// Writes a visibility bitmask: bit (i % 8) of out_visible[i / 8] is set if box i is NOT culled.
+	/// out_visible must hold (n + 7) / 8 bytes.
+	/// Gives the same answers as calling cull_box on each box. Only the float version uses SIMD.
+	void cull_boxes(const T* cx, const T* cy, const T* cz,
+	                const T* ex, const T* ey, const T* ez,
+	                size_t n, uint8_t* out_visible) const;
+
+	/// Same as above, but for arrays of centers and extents (AoS).
+	void cull_boxes(const Vec3* centers, const Vec3* extents, size_t n, uint8_t* out_visible) const;
+
+	// ------------------------------------------------
+	// Hierarchical culling of bounding volume trees.
+	//
+	// A plane mask has bit i set if plane i still needs to be tested. Start at the root with
+	// ALL_PLANES and pass the mask you get back on to the children: planes that a parent is
+	// completely inside of are never tested again further down, and once the mask is zero
+	// the whole subtree is inside.
+	//
+	// Plane coherency: give each node a byte (starting at zero) for the plane that culled it last.
+	// That plane is tested first next time, which often culls the node with a single test.
+
+	static constexpr uint8_t ALL_PLANES = 0x3F;
+
+	/// Counts the work done by the masked tests. Reset it every frame.
+	struct CullStats
+	{
+		size_t nodes       = 0; ///< Number of masked tests
+		size_t plane_tests = 0; ///< Number of planes actually tested
+		size_t culled      = 0; ///< How many returned Outside
+	};
+
+	/// Like cull_box, but only tests the planes in *inout_mask (without the test of the frustum corners,
+	/// so it may keep a few boxes that cull_box would cull). Unless Outside is returned, *inout_mask
+	/// is updated to the planes the box intersects, and Inside is returned if there are none.
+	IntersectResult cull_box_masked(const Vec3& center, const Vec3& extent, uint8_t* inout_mask,
+	                                uint8_t* inout_last_plane = nullptr, CullStats* stats = nullptr) const;
+
+	/// Same for a sphere. Agrees with test_sphere on what is Outside.
+	IntersectResult test_sphere_masked(const Vec3& center, T radius, uint8_t* inout_mask,
+	                                   uint8_t* inout_last_plane = nullptr, CullStats* stats = nullptr) const;
+
+	// ------------------------------------------------
+
+	friend bool intersects(const FrustumT& lhs, const FrustumT& rhs)
+	{
+		for (size_t i=0; i<NSides; ++i) {
+			if (rhs.plane_intersection(lhs._planes[i]) == PlaneIntersectResult::Infront) {
+				return false;
+			}
+		}
 
-	friend bool intersects(const Frustum& lhs, const Frustum& rhs);
+		for (size_t i=0; i<NSides; ++i) {
+			if (lhs.plane_intersection(rhs._planes[i]) == PlaneIntersectResult::Infront) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<typename> friend class FrustumT;
+	friend class FrustumSet;
 
 #if 0
 	void draw() const;
@@ -45,7 +151,12 @@ public:
 #endif
 
 private:
-	Frustum(const Mat4f& mvp);
+	FrustumT(const Mat4T<T>& mvp, Corners corners);
+
+	/// How many boxes from the start were done with SIMD. Zero unless T is float.
+	size_t cull_boxes_simd(const T* cx, const T* cy, const T* cz,
+	                       const T* ex, const T* ey, const T* ez,
+	                       size_t n, uint8_t* out_visible) const;
 
 	enum Side
 	{
@@ -63,7 +174,20 @@ private:
 	/* The planes are pointing outwards. That means that things
 	 in front of them (p.dist(x) > 0) are outside the frustum. */
 	Plane _planes[NSides];
-	Vec3f  _points[NPoints];
+	Vec3  _points[NPoints];
+	bool  _has_corners = false;
 };
 
+using Frustum  = FrustumT<float>;
+using Frustumd = FrustumT<double>;
+
+template<>
+size_t FrustumT<float>::cull_boxes_simd(const float* cx, const float* cy, const float* cz,
+                                        const float* ex, const float* ey, const float* ez,
+                                        size_t n, uint8_t* out_visible) const;
+
+// Instantiated in frustum.cpp.
+extern template class FrustumT<float>;
+extern template class FrustumT<double>;
+
 } // namespace emath
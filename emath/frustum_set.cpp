@@ -0,0 +1,162 @@
+#include "frustum_set.hpp"
+
+#include <algorithm>
+#include <loguru.hpp>
+
+#include "simd.hpp"
+
+namespace emath {
+
+int FrustumSet::add(const Frustum& frustum)
+{
+	CHECK_F(_size < MAX_FRUSTUMS, "A FrustumSet holds at most %d frustums", MAX_FRUSTUMS);
+	CHECK_F(frustum.has_corners(), "The box tests need the corners of the frustum");
+	const int i = _size++;
+	_frustums[i] = frustum;
+
+	for (size_t p = 0; p < NSides; ++p) {
+		_nx[p][i]   = frustum._planes[p].normal().x;
+		_ny[p][i]   = frustum._planes[p].normal().y;
+		_nz[p][i]   = frustum._planes[p].normal().z;
+		_dist[p][i] = frustum._planes[p].distance();
+	}
+
+	for (int d = 0; d < 3; ++d) {
+		_pmin[d][i] = _pmax[d][i] = frustum._points[0][d];
+		for (size_t k = 1; k < Frustum::NPoints; ++k) {
+			_pmin[d][i] = std::min(_pmin[d][i], frustum._points[k][d]);
+			_pmax[d][i] = std::max(_pmax[d][i], frustum._points[k][d]);
+		}
+	}
+
+	return i;
+}
+
+uint8_t FrustumSet::test_sphere(const Vec3f& center, float radius, uint8_t* out_inside) const
+{
+	uint8_t visible = 0;
+	uint8_t inside  = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+
+	const floatv c_x = set1(center.x), c_y = set1(center.y), c_z = set1(center.z);
+	const floatv r   = set1(radius);
+
+	for (int lane0 = 0; lane0 < _size; lane0 += WIDTH) {
+		floatv outside    = zero();
+		floatv intersects = zero();
+		for (size_t p = 0; p < NSides; ++p) {
+			// Same operations in the same order as Plane::distance:
+			floatv d = simd::add(mul(c_x, load(&_nx[p][lane0])), mul(c_y, load(&_ny[p][lane0])));
+			d = simd::add(simd::add(d, mul(c_z, load(&_nz[p][lane0]))), load(&_dist[p][lane0]));
+			outside    = bit_or(outside,    cmp_gt(d, r));
+			intersects = bit_or(intersects, cmp_lt(abs(d), r));
+		}
+		const unsigned lanes           = (1u << WIDTH) - 1;
+		const unsigned outside_bits    = unsigned(movemask(outside));
+		const unsigned intersects_bits = unsigned(movemask(intersects));
+		visible |= uint8_t((~outside_bits & lanes) << lane0);
+		inside  |= uint8_t((~(outside_bits | intersects_bits) & lanes) << lane0);
+	}
+#else
+	for (int i = 0; i < _size; ++i) {
+		const IntersectResult result = _frustums[i].test_sphere(center, radius);
+		if (result != IntersectResult::Outside) { visible |= uint8_t(1 << i); }
+		if (result == IntersectResult::Inside)  { inside  |= uint8_t(1 << i); }
+	}
+#endif
+
+	const uint8_t used = uint8_t((1u << _size) - 1);
+	if (out_inside) { *out_inside = inside & used; }
+	return visible & used;
+}
+
+uint8_t FrustumSet::test_box(const Vec3f& center, const Vec3f& extent) const
+{
+	uint8_t mask;
+	test_boxes(&center, &extent, 1, &mask);
+	return mask;
+}
+
+void FrustumSet::test_spheres(const Vec3f* centers, const float* radii, size_t n, uint8_t* out_masks) const
+{
+	for (size_t i = 0; i < n; ++i) {
+		out_masks[i] = test_sphere(centers[i], radii[i]);
+	}
+}
+
+void FrustumSet::test_boxes(const Vec3f* centers, const Vec3f* extents, size_t n, uint8_t* out_masks) const
+{
+	const uint8_t used = uint8_t((1u << _size) - 1);
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+
+	if (_size == 0) {
+		std::fill(out_masks, out_masks + n, uint8_t(0));
+		return;
+	}
+
+	// One group of WIDTH frustums with AVX, two with SSE. Each group goes over all the boxes,
+	// with everything that doesn't depend on the box loaded up front.
+	for (int lane0 = 0; lane0 < _size; lane0 += WIDTH) {
+		floatv nx[NSides], ny[NSides], nz[NSides], dist[NSides];
+		floatv pos_x[NSides], pos_y[NSides], pos_z[NSides];
+		for (size_t p = 0; p < NSides; ++p) {
+			nx[p]    = load(&_nx[p][lane0]);
+			ny[p]    = load(&_ny[p][lane0]);
+			nz[p]    = load(&_nz[p][lane0]);
+			dist[p]  = load(&_dist[p][lane0]);
+			pos_x[p] = cmp_gt(nx[p], zero());
+			pos_y[p] = cmp_gt(ny[p], zero());
+			pos_z[p] = cmp_gt(nz[p], zero());
+		}
+		const floatv pmin_x = load(&_pmin[0][lane0]), pmin_y = load(&_pmin[1][lane0]), pmin_z = load(&_pmin[2][lane0]);
+		const floatv pmax_x = load(&_pmax[0][lane0]), pmax_y = load(&_pmax[1][lane0]), pmax_z = load(&_pmax[2][lane0]);
+		const uint8_t group_bits = uint8_t(((1u << WIDTH) - 1) << lane0) & used;
+
+		for (size_t i = 0; i < n; ++i) {
+			const floatv c_x = set1(centers[i].x), c_y = set1(centers[i].y), c_z = set1(centers[i].z);
+			const floatv e_x = set1(extents[i].x), e_y = set1(extents[i].y), e_z = set1(extents[i].z);
+			const floatv min_x = sub(c_x, e_x), min_y = sub(c_y, e_y), min_z = sub(c_z, e_z);
+			const floatv max_x = simd::add(c_x, e_x), max_y = simd::add(c_y, e_y), max_z = simd::add(c_z, e_z);
+
+			floatv culled = zero();
+
+			// Same as Frustum::cull_box, with the closest corner picked per lane.
+			// and/andnot/or measured a lot faster than select (blendv) here.
+			for (size_t p = 0; p < NSides; ++p) {
+				const floatv closest_x = bit_or(bit_and(pos_x[p], min_x), bit_andnot(pos_x[p], max_x));
+				const floatv closest_y = bit_or(bit_and(pos_y[p], min_y), bit_andnot(pos_y[p], max_y));
+				const floatv closest_z = bit_or(bit_and(pos_z[p], min_z), bit_andnot(pos_z[p], max_z));
+				floatv d = simd::add(mul(closest_x, nx[p]), mul(closest_y, ny[p]));
+				d = simd::add(simd::add(d, mul(closest_z, nz[p])), dist[p]);
+				culled = bit_or(culled, cmp_ge(d, zero()));
+			}
+
+			culled = bit_or(culled, cmp_gt(pmin_x, max_x));
+			culled = bit_or(culled, cmp_lt(pmax_x, min_x));
+			culled = bit_or(culled, cmp_gt(pmin_y, max_y));
+			culled = bit_or(culled, cmp_lt(pmax_y, min_y));
+			culled = bit_or(culled, cmp_gt(pmin_z, max_z));
+			culled = bit_or(culled, cmp_lt(pmax_z, min_z));
+
+			const uint8_t visible = uint8_t(~unsigned(movemask(culled)) << lane0) & group_bits;
+			out_masks[i] = (lane0 == 0 ? 0 : out_masks[i]) | visible;
+		}
+	}
+#else
+	for (size_t i = 0; i < n; ++i) {
+		uint8_t visible = 0;
+		for (int f = 0; f < _size; ++f) {
+			if (!_frustums[f].cull_box(centers[i], extents[i])) {
+				visible |= uint8_t(1 << f);
+			}
+		}
+		out_masks[i] = visible & used;
+	}
+#endif
+}
+
+} // namespace emath
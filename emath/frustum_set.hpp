@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "frustum.hpp"
+
+namespace emath {
+
+/*
+ Up to eight frustums (e.g. a camera and its shadow cascades) tested against the same objects.
+ Each object is tested against all of them at once: the planes are stored SoA, one SIMD lane
+ per frustum, so one pass of six plane tests covers all eight frustums (two passes with SSE).
+
+ The results are bitmasks: bit i is set if frustum i (in the order they were added) sees the object.
+ They match the per-frustum tests exactly: Frustum::test_sphere != Outside, and !Frustum::cull_box.
+ */
+class FrustumSet
+{
+public:
+	static constexpr int MAX_FRUSTUMS = 8;
+
+	FrustumSet() = default;
+
+	/// Returns the bit of the new frustum.
+	int add(const Frustum& frustum);
+
+	void clear() { _size = 0; }
+
+	int size() const { return _size; }
+	const Frustum& frustum(int i) const { return _frustums[i]; }
+
+	/// Which frustums the sphere is not outside of.
+	/// If out_inside is given, it gets the frustums the sphere is completely inside of.
+	uint8_t test_sphere(const Vec3f& center, float radius, uint8_t* out_inside = nullptr) const;
+
+	/// Which frustums don't cull the box.
+	uint8_t test_box(const Vec3f& center, const Vec3f& extent) const;
+
+	/// One mask per object in out_masks.
+	void test_spheres(const Vec3f* centers, const float* radii, size_t n, uint8_t* out_masks) const;
+	void test_boxes(const Vec3f* centers, const Vec3f* extents, size_t n, uint8_t* out_masks) const;
+
+private:
+	static constexpr size_t NSides = Frustum::NSides;
+
+	// SoA: lane i of each array belongs to frustum i. Unused lanes are zero.
+	alignas(32) float _nx[NSides][MAX_FRUSTUMS] = {};
+	alignas(32) float _ny[NSides][MAX_FRUSTUMS] = {};
+	alignas(32) float _nz[NSides][MAX_FRUSTUMS] = {};
+	alignas(32) float _dist[NSides][MAX_FRUSTUMS] = {};
+
+	// Bounds of the corners of each frustum:
+	alignas(32) float _pmin[3][MAX_FRUSTUMS] = {};
+	alignas(32) float _pmax[3][MAX_FRUSTUMS] = {};
+
+	Frustum _frustums[MAX_FRUSTUMS];
+	int     _size = 0;
+};
+
+} // namespace emath
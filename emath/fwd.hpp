@@ -5,7 +5,10 @@
 
 namespace emath {
 
-class Random;
+class Pcg32;
+class Xoshiro128;
+template<typename Engine> class RandomT;
+using Random = RandomT<Pcg32>;
 class Capsule;
 class CapsuleBaked;
 class Circle;
@@ -18,6 +21,18 @@ namespace trace
 
 using byte = unsigned char;
 
+/*
+ Define EMATH_ALIGN_VEC4=1 to give Vec4T and Mat4T the alignment of four elements
+ (16 bytes for Vec4f/Mat4f), which suits SIMD loads.
+ Only alignof changes, never sizeof or the memory order,
+ but it must be defined the same in all translation units.
+ */
+#ifndef EMATH_ALIGN_VEC4
+	#define EMATH_ALIGN_VEC4 0
+#endif
+
+#define EMATH_VEC4_ALIGNMENT(T) (EMATH_ALIGN_VEC4 ? 4 * sizeof(T) : alignof(T))
+
 // --------------------------------------------------
 
 struct scalar_tag{};
@@ -197,7 +212,7 @@ static_assert(sizeof(Vec3f)    == 3 * sizeof(float),     "Pack");
  using RGBAf = Vec4T<float, RGBA_tag>;
  */
 template<typename T, class Tag = scalar_tag>
-class Vec4T
+class alignas(EMATH_VEC4_ALIGNMENT(T)) Vec4T
 {
 public:
 	using element_type = T;
@@ -273,12 +288,28 @@ class AABB_T;
 using AABB2f = AABB_T<float>;
 using AABB2d = AABB_T<double>;
 
-// ----------------------------------------------------------------------------
+template<typename T>
+class AABB3_T;
+using AABB3f = AABB3_T<float>;
+using AABB3d = AABB3_T<double>;
 
 template<typename T>
+class PlaneT;
+using Plane  = PlaneT<float>;
+using Planed = PlaneT<double>;
+
+// ----------------------------------------------------------------------------
+
+template<typename T, size_t Alignment>
+class AlignedAllocator;
+
+template<typename T, typename Allocator = AlignedAllocator<T, 64>>
 class Matrix;
 using Matrixi = Matrix<int>;
 using Matrixf = Matrix<float>;
 using Matrixd = Matrix<double>;
 
+template<typename T>
+class MatrixView;
+
 } // namespace emath
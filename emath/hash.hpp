@@ -1,3 +1,6 @@
+#pragma once
+
+#include <cstdint>
 #include <functional>
 
 #include "fwd.hpp"
@@ -11,6 +14,34 @@ inline size_t combine_hashes(const size_t seed, const size_t new_hash)
     return new_hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
 
+/// Every bit of the input affects every bit of the output (the splitmix64 finalizer).
+/// A bijection, so it never adds collisions. Use before taking the low bits of a hash,
+/// e.g. for a power-of-two sized table.
+inline uint64_t hash_mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/// For grid coordinates. The two 32-bit coordinates are packed into 64 bits and mixed,
+/// so no two cells collide before the table size is taken into account.
+inline uint64_t hash_cell(const Vec2i& c)
+{
+	return hash_mix(uint64_t(uint32_t(c.x)) | (uint64_t(uint32_t(c.y)) << 32));
+}
+
+/// Well mixed, but 96 bits don't fit in 64, so unlike the Vec2i version this can collide.
+/// E.g. hash_mix(0) == 0, so (0, 0, 0) and (x, y, 1) collide when (y << 32 | x) == hash_mix(1).
+inline uint64_t hash_cell(const Vec3i& c)
+{
+	const uint64_t xy = uint64_t(uint32_t(c.x)) | (uint64_t(uint32_t(c.y)) << 32);
+	return hash_mix(xy ^ hash_mix(uint64_t(uint32_t(c.z))));
+}
+
 } // namespace emath
 
 namespace std {
@@ -20,7 +51,7 @@ struct hash<emath::Vec2T<T>>
 {
 	size_t operator()(const emath::Vec2T<T>& val) const
 	{
-		return std::hash<T>()(val.x) + std::hash<T>()(val.y) * emath::HUGE_PRIME_0;
+		return size_t(emath::hash_mix(std::hash<T>()(val.x) + std::hash<T>()(val.y) * uint64_t(emath::HUGE_PRIME_0)));
 	}
 };
 
@@ -29,8 +60,21 @@ struct hash<emath::Vec3T<T>>
 {
 	size_t operator()(const emath::Vec3T<T>& val) const
 	{
-		return std::hash<T>()(val.x) + std::hash<T>()(val.y) * emath::HUGE_PRIME_0 + std::hash<T>()(val.z) * emath::HUGE_PRIME_1;
+		return size_t(emath::hash_mix(std::hash<T>()(val.x) + std::hash<T>()(val.y) * uint64_t(emath::HUGE_PRIME_0)
+		                                                     + std::hash<T>()(val.z) * uint64_t(emath::HUGE_PRIME_1)));
 	}
 };
 
+template<>
+struct hash<emath::Vec2T<int>>
+{
+	size_t operator()(const emath::Vec2i& val) const { return size_t(emath::hash_cell(val)); }
+};
+
+template<>
+struct hash<emath::Vec3T<int>>
+{
+	size_t operator()(const emath::Vec3i& val) const { return size_t(emath::hash_cell(val)); }
+};
+
 } // namespace std
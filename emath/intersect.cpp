@@ -1,6 +1,7 @@
 //  Created by Emil Ernerfeldt on 2013-02-16.
 
 #include "intersect.hpp"
+#include "circle.hpp"
 #include "plane.hpp"
 #include "vec2.hpp"
 
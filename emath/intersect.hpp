@@ -1,10 +1,10 @@
 #pragma once
 
 #include "fwd.hpp"
+#include "vec3.hpp"
 
 namespace emath {
 struct Circle;
-class Plane;
 namespace intersect {
 
 /// true if entire box is on the positive side of the plane.
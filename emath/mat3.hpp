@@ -162,8 +162,10 @@ namespace emath
 
 		T det = mat[0][0]*Adj[0][0] + mat[0][1]*Adj[1][0] + mat[0][2]*Adj[2][0];
 
-		if (fabs(det) < 0.000001f)
-			return Mat3T();
+		if (fabs(det) < 0.000001f) // Singular: all zeros
+			return Mat3T(0, 0, 0,
+			             0, 0, 0,
+			             0, 0, 0);
 
 		return Adj * (1.0f/det);
 	}
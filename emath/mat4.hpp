@@ -2,8 +2,10 @@
 #pragma once
 
 #include <algorithm>
+#include <ostream>
 
 #include "mat3.hpp"
+#include "simd.hpp"
 #include "vec2.hpp"
 
 namespace emath
@@ -16,7 +18,7 @@ namespace emath
 	 This is slightly peculiar, as that does not conform to column vectors.
 	 */
 	template<typename T>
-	class Mat4T
+	class alignas(EMATH_VEC4_ALIGNMENT(T)) Mat4T
 	{
 	public:
 		T mat[4][4];
@@ -48,14 +50,14 @@ namespace emath
 		inline       T* data() { return &mat[0][0]; }
 		inline const T* data() const { return &mat[0][0]; }
 
-		Vec4f row(uint num) const
+		Vec4T<T> row(uint num) const
 		{
-			return Vec4f(mat[num][0], mat[num][1], mat[num][2], mat[num][3]);
+			return Vec4T<T>(mat[num][0], mat[num][1], mat[num][2], mat[num][3]);
 		}
 
-		Vec4f col(uint num) const
+		Vec4T<T> col(uint num) const
 		{
-			return Vec4f(mat[0][num], mat[1][num], mat[2][num], mat[3][num]);
+			return Vec4T<T>(mat[0][num], mat[1][num], mat[2][num], mat[3][num]);
 		}
 
 		inline       T*  operator [] (int row);
@@ -635,7 +637,7 @@ namespace emath
 	template<typename T>
 	inline Vec4T<T> mul(const Mat4T<T>& m, const Vec4T<T>& p)
 	{
-		return Vec4f(
+		return Vec4T<T>(
 			m.mat[0][0]*p[0] + m.mat[1][0]*p[1] + m.mat[2][0]*p[2] + m.mat[3][0]*p[3],
 			m.mat[0][1]*p[0] + m.mat[1][1]*p[1] + m.mat[2][1]*p[2] + m.mat[3][1]*p[3],
 			m.mat[0][2]*p[0] + m.mat[1][2]*p[1] + m.mat[2][2]*p[2] + m.mat[3][2]*p[3],
@@ -670,6 +672,8 @@ namespace emath
 		return v4.xyz / v4.w;
 	}
 
+	/// Transforms a direction (e.g. a normal) with normal_transformer().
+	/// Returns zero if the upper-left 3x3 is singular, as Mat3T::inverse does.
 	template<typename T>
 	inline Vec3T<T> mul_dir(const Mat4T<T>& m, const Vec3T<T>& dir)
 	{
@@ -682,6 +686,250 @@ namespace emath
 		return mul(m.normal_transformer(), Vec3T<T>(dir, 0)).xy;
 	}
 
+	// ------------------------------------------------
+	// SIMD specializations for Mat4f.
+	// These read and write the exact same memory order as the generic code above,
+	// so data() stays OpenGL-compatible. Without SSE2 the generic code is used.
+
+#if EMATH_SSE2
+	namespace simd {
+		inline __m128 mat4_row(const Mat4f& m, int row) { return _mm_loadu_ps(m.mat[row]); }
+
+		inline __m128 splat(__m128 v, int i)
+		{
+			switch (i) {
+				case 0:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+				case 1:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+				case 2:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+				default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+		}
+
+		/// a * b + c
+		inline __m128 madd(__m128 a, __m128 b, __m128 c)
+		{
+		#if EMATH_FMA
+			return _mm_fmadd_ps(a, b, c);
+		#else
+			return _mm_add_ps(_mm_mul_ps(a, b), c);
+		#endif
+		}
+
+		/// v.x * r0 + v.y * r1 + v.z * r2 + v.w * r3, i.e. row vector times matrix.
+		inline __m128 mul_rows(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+		{
+			__m128 result = _mm_mul_ps(splat(v, 0), r0);
+			result = madd(splat(v, 1), r1, result);
+			result = madd(splat(v, 2), r2, result);
+			result = madd(splat(v, 3), r3, result);
+			return result;
+		}
+
+		/// Cross product of the xyz parts. w of the result is 0.
+		inline __m128 cross3(__m128 a, __m128 b)
+		{
+			const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		inline float dot3(__m128 a, __m128 b)
+		{
+			alignas(16) float p[4];
+			_mm_store_ps(p, _mm_mul_ps(a, b));
+			return p[0] + p[1] + p[2];
+		}
+
+		// Helpers for the inverse. The 2x2 matrices are stored row-major in a __m128.
+		#define EMATH_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+		#define EMATH_SWIZZLE(a, x, y, z, w)    _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(w, z, y, x)))
+
+		/// A * B
+		inline __m128 mat2_mul(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, EMATH_SWIZZLE(b, 0, 3, 0, 3)),
+			                  _mm_mul_ps(EMATH_SWIZZLE(a, 1, 0, 3, 2), EMATH_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		/// adjugate(A) * B
+		inline __m128 mat2_adj_mul(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(EMATH_SWIZZLE(a, 3, 3, 0, 0), b),
+			                  _mm_mul_ps(EMATH_SWIZZLE(a, 1, 1, 2, 2), EMATH_SWIZZLE(b, 2, 3, 0, 1)));
+		}
+
+		/// A * adjugate(B)
+		inline __m128 mat2_mul_adj(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, EMATH_SWIZZLE(b, 3, 0, 3, 0)),
+			                  _mm_mul_ps(EMATH_SWIZZLE(a, 1, 0, 3, 2), EMATH_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+	} // namespace simd
+
+	template<>
+	inline Mat4T<float> Mat4T<float>::operator * (const Mat4T& rhs) const
+	{
+		// Same as the generic version: row i of the result is row i of rhs times *this.
+		Mat4T M;
+	#if EMATH_AVX
+		// Two result rows per iteration, one in each 128-bit half:
+		const __m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mat[0]));
+		const __m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mat[1]));
+		const __m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mat[2]));
+		const __m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mat[3]));
+		for (int i = 0; i < 4; i += 2) {
+			const __m256 a = _mm256_loadu_ps(rhs.mat[i]);
+			__m256 result = _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+		#if EMATH_FMA
+			result = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r1, result);
+			result = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r2, result);
+			result = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), r3, result);
+		#else
+			result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+			result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+			result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+		#endif
+			_mm256_storeu_ps(M.mat[i], result);
+		}
+	#else
+		const __m128 r0 = simd::mat4_row(*this, 0);
+		const __m128 r1 = simd::mat4_row(*this, 1);
+		const __m128 r2 = simd::mat4_row(*this, 2);
+		const __m128 r3 = simd::mat4_row(*this, 3);
+		for (int i = 0; i < 4; ++i) {
+			_mm_storeu_ps(M.mat[i], simd::mul_rows(simd::mat4_row(rhs, i), r0, r1, r2, r3));
+		}
+	#endif
+		return M;
+	}
+
+	template<>
+	inline Mat4T<float> transposed(const Mat4T<float>& arg)
+	{
+		__m128 r0 = simd::mat4_row(arg, 0);
+		__m128 r1 = simd::mat4_row(arg, 1);
+		__m128 r2 = simd::mat4_row(arg, 2);
+		__m128 r3 = simd::mat4_row(arg, 3);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		Mat4T<float> M;
+		_mm_storeu_ps(M.mat[0], r0);
+		_mm_storeu_ps(M.mat[1], r1);
+		_mm_storeu_ps(M.mat[2], r2);
+		_mm_storeu_ps(M.mat[3], r3);
+		return M;
+	}
+
+	/// Blockwise inversion using 2x2 sub-matrices.
+	/// Like the generic version, a singular matrix gives inf/nan.
+	template<>
+	inline Mat4T<float> inverted(const Mat4T<float>& m)
+	{
+		using namespace simd;
+
+		const __m128 r0 = mat4_row(m, 0);
+		const __m128 r1 = mat4_row(m, 1);
+		const __m128 r2 = mat4_row(m, 2);
+		const __m128 r3 = mat4_row(m, 3);
+
+		// The four 2x2 blocks:  | A  B |
+		//                       | C  D |
+		const __m128 A = _mm_movelh_ps(r0, r1);
+		const __m128 B = _mm_movehl_ps(r1, r0);
+		const __m128 C = _mm_movelh_ps(r2, r3);
+		const __m128 D = _mm_movehl_ps(r3, r2);
+
+		// (|A|, |B|, |C|, |D|)
+		const __m128 det_sub = _mm_sub_ps(
+			_mm_mul_ps(EMATH_SHUFFLE(r0, r2, 0, 2, 0, 2), EMATH_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+			_mm_mul_ps(EMATH_SHUFFLE(r0, r2, 1, 3, 1, 3), EMATH_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+		const __m128 det_A = EMATH_SWIZZLE(det_sub, 0, 0, 0, 0);
+		const __m128 det_B = EMATH_SWIZZLE(det_sub, 1, 1, 1, 1);
+		const __m128 det_C = EMATH_SWIZZLE(det_sub, 2, 2, 2, 2);
+		const __m128 det_D = EMATH_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+		const __m128 D_C = mat2_adj_mul(D, C);
+		const __m128 A_B = mat2_adj_mul(A, B);
+
+		// The adjugates of the blocks of the inverse:
+		__m128 X = _mm_sub_ps(_mm_mul_ps(det_D, A), mat2_mul(B, D_C));
+		__m128 W = _mm_sub_ps(_mm_mul_ps(det_A, D), mat2_mul(C, A_B));
+		__m128 Y = _mm_sub_ps(_mm_mul_ps(det_B, C), mat2_mul_adj(D, A_B));
+		__m128 Z = _mm_sub_ps(_mm_mul_ps(det_C, B), mat2_mul_adj(A, D_C));
+
+		// |M| = |A|*|D| + |B|*|C| - trace(A_B * D_C)
+		__m128 tr = _mm_mul_ps(A_B, EMATH_SWIZZLE(D_C, 0, 2, 1, 3));
+		tr = _mm_add_ps(tr, EMATH_SWIZZLE(tr, 2, 3, 0, 1));
+		tr = _mm_add_ps(tr, EMATH_SWIZZLE(tr, 1, 0, 3, 2));
+		const __m128 det_M = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_A, det_D), _mm_mul_ps(det_B, det_C)), tr);
+
+		const __m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_M);
+		X = _mm_mul_ps(X, inv_det);
+		Y = _mm_mul_ps(Y, inv_det);
+		Z = _mm_mul_ps(Z, inv_det);
+		W = _mm_mul_ps(W, inv_det);
+
+		// Undo the adjugates while storing:
+		Mat4T<float> M;
+		_mm_storeu_ps(M.mat[0], EMATH_SHUFFLE(X, Y, 3, 1, 3, 1));
+		_mm_storeu_ps(M.mat[1], EMATH_SHUFFLE(X, Y, 2, 0, 2, 0));
+		_mm_storeu_ps(M.mat[2], EMATH_SHUFFLE(Z, W, 3, 1, 3, 1));
+		_mm_storeu_ps(M.mat[3], EMATH_SHUFFLE(Z, W, 2, 0, 2, 0));
+		return M;
+	}
+
+	#undef EMATH_SHUFFLE
+	#undef EMATH_SWIZZLE
+
+	template<>
+	inline Vec4T<float> mul(const Mat4T<float>& m, const Vec4T<float>& p)
+	{
+		const __m128 v = _mm_loadu_ps(p.data());
+		Vec4f result;
+		_mm_storeu_ps(result.data(), simd::mul_rows(v,
+			simd::mat4_row(m, 0), simd::mat4_row(m, 1), simd::mat4_row(m, 2), simd::mat4_row(m, 3)));
+		return result;
+	}
+
+	/// Same as the generic version, i.e. multiplies with normal_transformer(),
+	/// but without building the inverse: the rows of the inverse-transpose
+	/// of the upper-left 3x3 are cross products of its rows.
+	template<>
+	inline Vec3T<float> mul_dir(const Mat4T<float>& m, const Vec3T<float>& dir)
+	{
+		using namespace simd;
+
+		const __m128 r0 = mat4_row(m, 0);
+		const __m128 r1 = mat4_row(m, 1);
+		const __m128 r2 = mat4_row(m, 2);
+
+		const __m128 c0 = cross3(r1, r2);
+		const float det = dot3(r0, c0);
+
+		if (std::abs(det) < 0.000001f) {
+			return Zero; // Same threshold and result as Mat3T::inverse
+		}
+
+		const __m128 c1 = cross3(r2, r0);
+		const __m128 c2 = cross3(r0, r1);
+
+		__m128 result = _mm_mul_ps(_mm_set1_ps(dir.x), c0);
+		result = madd(_mm_set1_ps(dir.y), c1, result);
+		result = madd(_mm_set1_ps(dir.z), c2, result);
+		result = _mm_div_ps(result, _mm_set1_ps(det));
+
+		alignas(16) float out[4];
+		_mm_store_ps(out, result);
+		return {out[0], out[1], out[2]};
+	}
+
+	template<>
+	inline Vec2T<float> mul_dir(const Mat4T<float>& m, const Vec2T<float>& dir)
+	{
+		return mul_dir(m, Vec3f(dir, 0)).xy;
+	}
+#endif // EMATH_SSE2
+
 	// ------------------------------------------------
 
 	using Mat4f = Mat4T<float>;
@@ -1,41 +1,200 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 #include <loguru.hpp>
 
+#include "allocator.hpp"
 #include "fwd.hpp"
+#include "matrix_expr.hpp"
+#include "matrix_view.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
 
 namespace emath {
 
+// ----------------------------------------------------------------------------
+// Transpose kernels, used by Matrix but usable on any row-major data.
+// Pitches are the distance between rows, in elements.
+// The work is done in square tiles that fit in L1, and for 4-byte types (float, int, ...)
+// each tile is transposed in SIMD_WIDTH x SIMD_WIDTH blocks in registers.
+
+const int TRANSPOSE_TILE = 32;
+
+/// dst(y, x) = src(x, y) for a width x height tile. src and dst must not overlap.
+template<typename T>
+void transpose_tile(const T* src, size_t src_pitch, T* dst, size_t dst_pitch, int width, int height)
+{
+	int y = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	if (sizeof(T) == sizeof(float) && std::is_trivially_copyable<T>::value) {
+		using namespace simd;
+		for (; y + WIDTH <= height; y += WIDTH) {
+			int x = 0;
+			for (; x + WIDTH <= width; x += WIDTH) {
+				floatv rows[WIDTH];
+				for (int r = 0; r < WIDTH; ++r) {
+					rows[r] = load(reinterpret_cast<const float*>(src + (y + r) * src_pitch + x));
+				}
+				transpose_square(rows);
+				for (int r = 0; r < WIDTH; ++r) {
+					store(reinterpret_cast<float*>(dst + (x + r) * dst_pitch + y), rows[r]);
+				}
+			}
+			for (; x < width; ++x) {
+				for (int r = 0; r < WIDTH; ++r) {
+					dst[x * dst_pitch + y + r] = src[(y + r) * src_pitch + x];
+				}
+			}
+		}
+	}
+#endif
+
+	for (; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			dst[x * dst_pitch + y] = src[y * src_pitch + x];
+		}
+	}
+}
+
+/// Swaps tile 'a' (width x height) with the transpose of tile 'b' (height x width) in the same matrix.
+/// If a == b the tile must be square, and is transposed in place.
+template<typename T>
+void transpose_swap_tiles(T* a, T* b, size_t pitch, int width, int height)
+{
+	const bool diagonal = (a == b);
+	DCHECK_F(!diagonal || width == height);
+
+	int full_w = 0; // Columns [0, full_w) of rows [0, full_h) are done with SIMD.
+	int full_h = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	if (sizeof(T) == sizeof(float) && std::is_trivially_copyable<T>::value) {
+		using namespace simd;
+		full_w = width  - width  % WIDTH;
+		full_h = height - height % WIDTH;
+		for (int y = 0; y < full_h; y += WIDTH) {
+			for (int x = (diagonal ? y : 0); x < full_w; x += WIDTH) {
+				floatv rows_a[WIDTH], rows_b[WIDTH];
+				for (int r = 0; r < WIDTH; ++r) {
+					rows_a[r] = load(reinterpret_cast<const float*>(a + (y + r) * pitch + x));
+					rows_b[r] = load(reinterpret_cast<const float*>(b + (x + r) * pitch + y));
+				}
+				transpose_square(rows_a);
+				transpose_square(rows_b);
+				for (int r = 0; r < WIDTH; ++r) {
+					store(reinterpret_cast<float*>(b + (x + r) * pitch + y), rows_a[r]);
+					store(reinterpret_cast<float*>(a + (y + r) * pitch + x), rows_b[r]);
+				}
+			}
+		}
+	}
+#endif
+
+	for (int y = 0; y < height; ++y) {
+		int x = (y < full_h ? full_w : 0);
+		if (diagonal) { x = std::max(x, y + 1); }
+		for (; x < width; ++x) {
+			std::swap(a[y * pitch + x], b[x * pitch + y]);
+		}
+	}
+}
+
+/// dst(y, x) = src(x, y), where src is width x height. src and dst must not overlap.
+/// With num_threads > 1, rows of tiles are split over that many threads.
+template<typename T>
+void transpose(const T* src, size_t src_pitch, T* dst, size_t dst_pitch,
+               int width, int height, unsigned num_threads = 1)
+{
+	const int num_tile_rows = (height + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+	parallel_for(size_t(num_tile_rows), num_threads, [&](size_t begin, size_t end) {
+		for (size_t tile_row = begin; tile_row < end; ++tile_row) {
+			const int ty = int(tile_row) * TRANSPOSE_TILE;
+			const int th = std::min(TRANSPOSE_TILE, height - ty);
+			for (int tx = 0; tx < width; tx += TRANSPOSE_TILE) {
+				const int tw = std::min(TRANSPOSE_TILE, width - tx);
+				transpose_tile(src + ty * src_pitch + tx, src_pitch, dst + tx * dst_pitch + ty, dst_pitch, tw, th);
+			}
+		}
+	});
+}
+
+/// In-place transpose of a size x size matrix.
 template<typename T>
+void transpose_square_in_place(T* data, size_t pitch, int size, unsigned num_threads = 1)
+{
+	// Work on pairs of tiles (i, j) with i <= j, numbered row by row:
+	const size_t num_tiles = size_t(size + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+	const size_t num_pairs = num_tiles * (num_tiles + 1) / 2;
+
+	parallel_for(num_pairs, num_threads, [&](size_t begin, size_t end) {
+		size_t i = 0, j = 0, pair = 0;
+		while (pair + (num_tiles - i) <= begin) {
+			pair += num_tiles - i;
+			i += 1;
+		}
+		j = i + (begin - pair);
+
+		for (size_t p = begin; p < end; ++p) {
+			const int y = int(i) * TRANSPOSE_TILE;
+			const int x = int(j) * TRANSPOSE_TILE;
+			transpose_swap_tiles(data + y * pitch + x, data + x * pitch + y, pitch,
+			                     std::min(TRANSPOSE_TILE, size - x), std::min(TRANSPOSE_TILE, size - y));
+			if (++j == num_tiles) {
+				i += 1;
+				j = i;
+			}
+		}
+	});
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ A 2D grid of values, stored row-major.
+
+ The storage comes from 'Allocator', which by default aligns the data to 64 bytes.
+ Plug in your own (e.g. an arena for per-frame scratch grids) as the second template argument.
+
+ Rows are normally tightly packed (pitch() == width()), but with_aligned_rows() pads
+ each row so that every row starts aligned. Functions that treat the matrix as one flat
+ array (operator[](int), begin(), end(), as_vec()) require tightly packed rows.
+ */
+template<typename T, typename Allocator>
 class Matrix
 {
 public:
 	typedef       T  value_type;
 	typedef const T* const_iterator;
 	typedef       T* iterator;
+	typedef Allocator allocator_type;
 
-	Matrix() : _width(0), _height(0) {}
+	Matrix() : _width(0), _height(0), _pitch(0) {}
 
-	Matrix(int width, int height)
-		: _width(width), _height(height), _data(width * height) {}
+	explicit Matrix(const Allocator& alloc) : _data(alloc), _width(0), _height(0), _pitch(0) {}
 
-	Matrix(int width, int height, T value)
-		: _width(width), _height(height), _data(width * height, value) {}
+	Matrix(int width, int height, const Allocator& alloc = Allocator())
+		: _data(size_t(width) * height, alloc), _width(width), _height(height), _pitch(width) {}
 
-	Matrix(int width, int height, std::vector<T> data)
-		: _width(width), _height(height), _data(data)
+	Matrix(int width, int height, T value, const Allocator& alloc = Allocator())
+		: _data(size_t(width) * height, value, alloc), _width(width), _height(height), _pitch(width) {}
+
+	Matrix(int width, int height, const std::vector<T>& data, const Allocator& alloc = Allocator())
+		: _data(data.begin(), data.end(), alloc), _width(width), _height(height), _pitch(width)
 	{
 		CHECK_EQ_F(width * height, _data.size());
 	}
 
-	Matrix(int width, int height, const T* data)
-		: _width(width), _height(height)
+	Matrix(int width, int height, const T* data, const Allocator& alloc = Allocator())
+		: _data(alloc), _width(width), _height(height), _pitch(width)
 	{
 		if (width * height > 0) {
 			CHECK_NOTNULL_F(data);
-			_data = std::vector<T>(data, data + width * height);
+			_data.assign(data, data + width * height);
 		}
 	}
 
@@ -44,9 +203,11 @@ public:
 		_height = rows.size();
 		if (rows.size() == 0) {
 			_width = 0;
+			_pitch = 0;
 			return;
 		}
 		_width = rows.begin()->size();
+		_pitch = _width;
 		_data.reserve(_width * _height);
 		for (const auto& row : rows) {
 			CHECK_EQ_F(row.size(), _width);
@@ -56,28 +217,94 @@ public:
 		}
 	}
 
+	/// Evaluates a lazy expression like a * 2.0f - b. See matrix_expr.hpp.
+	template<typename E, typename = typename std::enable_if<is_matrix_expr<E>::value>::type>
+	Matrix(const E& expr, const Allocator& alloc = Allocator())
+		: Matrix(expr.width(), expr.height(), alloc)
+	{
+		evaluate(view(), expr);
+	}
+
+	template<typename E, typename = typename std::enable_if<is_matrix_expr<E>::value>::type>
+	Matrix& operator=(const E& expr)
+	{
+		assign(expr);
+		return *this;
+	}
+
+	/// Evaluates a lazy expression into this matrix, with rows split over num_threads.
+	/// This matrix may be one of the operands (but not a shifted view of itself).
+	template<typename X>
+	void assign(const X& expr, unsigned num_threads = 1)
+	{
+		const auto& e = as_matrix_expr(expr);
+		if (e.width() == _width && e.height() == _height) {
+			evaluate(view(), e, num_threads);
+		} else {
+			Matrix result(get_allocator());
+			result._row_align = _row_align;
+			result.resize_discard(e.width(), e.height());
+			evaluate(result.view(), e, num_threads);
+			*this = std::move(result);
+		}
+	}
+
+	/// Each row is padded so that it starts on a multiple of 'row_alignment' bytes
+	/// (relative to data(), which is aligned by the default allocator).
+	/// 'row_alignment' must be a multiple of sizeof(T).
+	static Matrix with_aligned_rows(int width, int height, size_t row_alignment = 64,
+	                                const T& value = T{}, const Allocator& alloc = Allocator())
+	{
+		CHECK_F(row_alignment % sizeof(T) == 0, "row_alignment must be a multiple of the element size");
+		const int align = std::max(1, int(row_alignment / sizeof(T)));
+		Matrix m(alloc);
+		m._width  = width;
+		m._height = height;
+		m._row_align = align;
+		m._pitch  = int(m.aligned_pitch(width));
+		m._data.assign(size_t(m._pitch) * height, value);
+		return m;
+	}
+
 	// ------------------------------------------------
 
-	bool empty() const { return _data.empty(); }
+	bool empty() const { return _width == 0 || _height == 0; }
 	int width()  const { return _width;  } ///< The number of columns
 	int height() const { return _height; } ///< The number of rows
-	int size()   const { return static_cast<int>(_data.size()); }
+	int size()   const { return _width * _height; } ///< width() * height()
+	int pitch()  const { return _pitch;  } ///< Elements from the start of one row to the start of the next
+	bool is_contiguous() const { return _pitch == _width; } ///< No padding between rows
 
 	T*       data()       { return _data.data(); }
 	const T* data() const { return _data.data(); }
 
+	Allocator get_allocator() const { return _data.get_allocator(); }
+
 	// NOTE: you may NOT change the length of the returned vector, ONLY the contents!
-	std::vector<T>& as_vec() { return _data; }
-	const std::vector<T>& as_vec() const { return _data; }
+	// Includes the padding, if any.
+	// This used to be a std::vector<T>, before Matrix got the Allocator. Use to_vector() if you need one.
+	std::vector<T, Allocator>& as_vec() { return _data; }
+	const std::vector<T, Allocator>& as_vec() const { return _data; }
+
+	/// A copy of the elements, row by row, without any padding.
+	std::vector<T> to_vector() const
+	{
+		std::vector<T> result;
+		result.reserve(size_t(_width) * size_t(_height));
+		for (int y = 0; y < _height; ++y) {
+			result.insert(result.end(), row_ptr(y), row_ptr(y) + _width);
+		}
+		return result;
+	}
 
 	// ------------------------------------------------
 
-	const T* begin()  const { return data();          }
-	const T* cbegin() const { return data();          }
-	T*       begin()        { return data();          }
-	const T* end()    const { return data() + size(); }
-	const T* cend()   const { return data() + size(); }
-	T*       end()          { return data() + size(); }
+	const T* begin()  const { DCHECK_F(is_contiguous()); return data();          }
+	const T* cbegin() const { DCHECK_F(is_contiguous()); return data();          }
+	T*       begin()        { DCHECK_F(is_contiguous()); return data();          }
+	const T* end()    const { DCHECK_F(is_contiguous()); return data() + size(); }
+	const T* cend()   const { DCHECK_F(is_contiguous()); return data() + size(); }
+	T*       end()          { DCHECK_F(is_contiguous()); return data() + size(); }
 
 	// ------------------------------------------------
 
@@ -93,20 +320,20 @@ public:
 	T* row_ptr(int y)
 	{
 		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
-		return data() + _width * y;
+		return data() + size_t(_pitch) * y;
 	}
 
 	const T* row_ptr(int y) const
 	{
 		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
-		return data() + _width * y;
+		return data() + size_t(_pitch) * y;
 	}
 
 	T* pointer_to(int x, int y)
 	{
 		DCHECK_F(0 <= x && x < _width, "%d not in range [0, %d)", x, _width);
 		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
-		return data() + _width * y +   x;
+		return data() + size_t(_pitch) * y +   x;
 	}
 
 	/// (col, row)
@@ -116,7 +343,7 @@ public:
 	{
 		DCHECK_F(0 <= x && x < _width, "%d not in range [0, %d)", x, _width);
 		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
-		return _data[_width * y + x];
+		return _data[size_t(_pitch) * y + x];
 	}
 
 	// ------------------------------------------------
@@ -125,12 +352,14 @@ public:
 	const T& operator[](const Vec2i& v) const { return operator()(v.x, v.y); }
 
 	T& operator[](const int flat) {
+		DCHECK_F(is_contiguous());
 		DCHECK_GE_F(flat, 0);
 		DCHECK_LT_F(flat, size());
 		return _data[flat];
 	}
 
 	const T& operator[](const int flat) const {
+		DCHECK_F(is_contiguous());
 		DCHECK_GE_F(flat, 0);
 		DCHECK_LT_F(flat, size());
 		return _data[flat];
@@ -138,104 +367,177 @@ public:
 
 	// ------------------------------------------------
 
-	std::vector<float> column(int x) const
+	// ------------------------------------------------
+	// Views. These never copy, and are only valid as long as the matrix isn't resized.
+
+	MatrixView<T>      view()       { return MatrixView<T>(data(), _width, _height, _pitch); }
+	ConstMatrixView<T> view() const { return ConstMatrixView<T>(data(), _width, _height, _pitch); }
+
+	operator MatrixView<T>()            { return view(); }
+	operator ConstMatrixView<T>() const { return view(); }
+
+	/// The sub-rectangle [x, x + width) x [y, y + height).
+	MatrixView<T>      sub(int x, int y, int width, int height)       { return view().sub(x, y, width, height); }
+	ConstMatrixView<T> sub(int x, int y, int width, int height) const { return view().sub(x, y, width, height); }
+
+	// ------------------------------------------------
+
+	/// A copy of column x. See also view().column(x).
+	std::vector<T> column(int x) const
 	{
 		DCHECK_F(0 <= x && x < _width, "%d not in range [0, %d)", x, _width);
-		std::vector<float> column;
+		std::vector<T> column;
 		column.reserve(_height);
 		for (int y = 0; y < _height; ++y) {
-			column.push_back(_data[_width * y +   x]);
+			column.push_back(_data[size_t(_pitch) * y +   x]);
 		}
 		return column;
 	}
 
 	// ------------------------------------------------
 
-	// Keeps old values at the same place.
+	/// Keeps old values at the same place, and sets new ones to 'fill'.
+	/// Reuses the existing storage when it is big enough: shrinking never reallocates,
+	/// and neither does growing the height of a matrix with reserve()d room.
+	/// Rows are moved in bulk. With aligned rows, the new pitch is aligned the same way.
 	void resize(int new_w, int new_h, const T& fill = T{})
 	{
-		Matrix new_matrix(new_w, new_h);
+		CHECK_F(new_w >= 0 && new_h >= 0, "Bad size: %d x %d", new_w, new_h);
+
+		const size_t old_pitch = _pitch;
+		const size_t new_pitch = aligned_pitch(new_w);
+		const size_t old_size  = _data.size();
+		const size_t new_size  = new_pitch * new_h;
+		const int    keep_w    = std::min(_width,  new_w);
+		const int    keep_h    = std::min(_height, new_h);
+
+		if (new_pitch > old_pitch && _data.capacity() < new_size) {
+			// Must reallocate anyway, so build the new layout directly:
+			std::vector<T, Allocator> data(_data.get_allocator());
+			data.reserve(new_size);
+			for (int y = 0; y < keep_h; ++y) {
+				T* row = _data.data() + old_pitch * y;
+				data.insert(data.end(), std::make_move_iterator(row), std::make_move_iterator(row + keep_w));
+				data.resize(new_pitch * (y + 1), fill);
+			}
+			data.resize(new_size, fill);
+			_data.swap(data);
+		} else {
+			if (new_pitch < old_pitch) {
+				// Narrower: slide rows towards the front.
+				for (int y = 1; y < keep_h; ++y) {
+					T* row = _data.data() + old_pitch * y;
+					std::move(row, row + keep_w, _data.data() + new_pitch * y);
+				}
+			} else if (new_pitch > old_pitch) {
+				// Wider: make room, then slide rows towards the back, last row first.
+				_data.resize(std::max(old_size, new_size), fill);
+				for (int y = keep_h - 1; y > 0; --y) {
+					T* row = _data.data() + old_pitch * y;
+					std::move_backward(row, row + keep_w, _data.data() + new_pitch * y + keep_w);
+				}
+			}
 
-		for (int y = 0; y < new_h; ++y) {
-			for (int x = 0; x < new_w; ++x) {
-				if (x < _width && y < _height) {
-					new_matrix(x, y) = (*this)(x, y);
+			if (new_w > _width) {
+				for (int y = 0; y < keep_h; ++y) {
+					T* row = _data.data() + new_pitch * y;
+					std::fill(row + keep_w, row + new_w, fill);
 				}
 			}
+
+			// New rows that land in old storage. Anything past that is filled by resize below.
+			const size_t stale_end = std::min(std::max(old_size, new_pitch * keep_h), new_size);
+			std::fill(_data.data() + new_pitch * keep_h, _data.data() + stale_end, fill);
+
+			_data.resize(new_size, fill);
 		}
-		*this = std::move(new_matrix);
+
+		_width  = new_w;
+		_height = new_h;
+		_pitch  = int(new_pitch);
 	}
 
-	// ------------------------------------------------
+	/// Like resize, but the contents are unspecified afterwards.
+	/// Use when you are going to overwrite every element anyway.
+	void resize_discard(int new_w, int new_h)
+	{
+		CHECK_F(new_w >= 0 && new_h >= 0, "Bad size: %d x %d", new_w, new_h);
+		_pitch  = int(aligned_pitch(new_w));
+		_width  = new_w;
+		_height = new_h;
+		_data.resize(size_t(_pitch) * new_h);
+	}
 
-	template<typename X>
-	Matrix<X> cast() const
+	/// Make room for a width x height matrix, so that resizing up to that never reallocates.
+	void reserve(int width, int height)
 	{
-		auto m = Matrix<X>(_width, _height);
-		for (int i = 0; i < _data.size(); ++i) {
-			m[i] = static_cast<X>(_data[i]);
-		}
-		return m;
+		_data.reserve(aligned_pitch(width) * height);
 	}
 
-	Matrix<T> transpose() const
+	/// How many elements fit without reallocating, including row padding.
+	size_t capacity() const { return _data.capacity(); }
+
+	// ------------------------------------------------
+
+	/// The result uses the same allocator (rebound to X), and has no row padding.
+	template<typename X>
+	Matrix<X, typename std::allocator_traits<Allocator>::template rebind_alloc<X>> cast() const
 	{
-		auto m = Matrix<T>(_height, _width);
+		using XAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<X>;
+		auto m = Matrix<X, XAllocator>(_width, _height, XAllocator(_data.get_allocator()));
 		for (int y = 0; y < _height; ++y) {
+			const T* src = row_ptr(y);
+			X*       dst = m.row_ptr(y);
 			for (int x = 0; x < _width; ++x) {
-				m(y, x) = (*this)(x, y);
+				dst[x] = static_cast<X>(src[x]);
 			}
 		}
 		return m;
 	}
 
+	/// Tiled and vectorized, see emath::transpose. Optionally split over several threads.
+	Matrix transpose(unsigned num_threads = 1) const
+	{
+		auto m = Matrix(_height, _width, _data.get_allocator());
+		emath::transpose(data(), _pitch, m.data(), m.pitch(), _width, _height, num_threads);
+		return m;
+	}
+
+	/// Only for square matrices.
+	void transpose_in_place(unsigned num_threads = 1)
+	{
+		CHECK_EQ_F(_width, _height, "transpose_in_place only works for square matrices");
+		transpose_square_in_place(data(), _pitch, _width, num_threads);
+	}
+
 private:
-	std::vector<T> _data;
-	int            _width;
-	int            _height;
+	size_t aligned_pitch(int width) const
+	{
+		return size_t(width + _row_align - 1) / _row_align * _row_align;
+	}
+
+	std::vector<T, Allocator> _data;
+	int                       _width;
+	int                       _height;
+	int                       _pitch;
+	int                       _row_align = 1; // Row starts are aligned to this many elements.
 };
 
 // ----------------------------------------------------------------------------
 
-template<typename T>
-Matrix<T> operator*(const Matrix<T>& m, const T factor)
-{
-	Matrix<T> result(m.width(), m.height());
-	for (int i = 0; i < m.size(); ++i) {
-		result[i] = m[i] * factor;
-	}
-	return result;
-}
+// Elementwise +, -, *, / and map/reduce live in matrix_expr.hpp.
 
-template<typename T>
-Matrix<T> operator/(const Matrix<T>& m, const T factor)
-{
-	return m * (1 / factor);
-}
+template<typename T, typename A, typename X>
+void operator+=(Matrix<T, A>& m, const X& rhs) { m.assign(m + rhs); }
 
-template<typename T>
-void operator*=(Matrix<T>& m, const T factor)
-{
-	for (auto& v : m) {
-		v *= factor;
-	}
-}
+template<typename T, typename A, typename X>
+void operator-=(Matrix<T, A>& m, const X& rhs) { m.assign(m - rhs); }
 
-template<typename T>
-void operator/=(Matrix<T>& m, const T factor)
-{
-	m *= (1 / factor);
-}
+template<typename T, typename A, typename X>
+void operator*=(Matrix<T, A>& m, const X& rhs) { m.assign(m * rhs); }
 
-template<typename T>
-Matrix<T> operator-(const Matrix<T>& m)
-{
-	Matrix<T> result(m.width(), m.height());
-	for (int i = 0; i < m.size(); ++i) {
-		result[i] = -m[i];
-	}
-	return result;
-}
+template<typename T, typename A, typename X>
+void operator/=(Matrix<T, A>& m, const X& rhs) { m.assign(m / rhs); }
 
 // ----------------------------------------------------------------------------
 
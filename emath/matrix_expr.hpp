@@ -0,0 +1,575 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <loguru.hpp>
+
+#include "fwd.hpp"
+#include "matrix_view.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "vec2.hpp"
+
+namespace emath {
+
+/*
+ Lazy elementwise arithmetic on matrices.
+
+ +, -, *, / on a Matrix, MatrixView or scalar do not compute anything by themselves,
+ they build a small expression. The work happens when the expression is assigned to a
+ Matrix (or passed to evaluate() or a reduction), in one pass with no temporaries:
+
+	Matrixf cost = a * 2.0f - b;                 // One loop
+	cost.assign(a * 2.0f - b, num_threads);      // Same, with the rows split over threads
+	double total = sum(cost - a);                // No matrix is created for cost - a
+
+ Matrix * Matrix is elementwise, not a matrix product.
+ Float expressions of +, -, *, / are evaluated with SIMD.
+ map() and zip_map() apply your own function, and fuse with the rest too.
+
+ An expression refers to the matrices it was made from, so don't hold on to one
+ (e.g. in an 'auto' variable) longer than they live. For the same reason a temporary
+ Matrix can't be an operand: evaluate it into a variable first.
+
+ Matrix<int> * 2.5f is computed in float, not as * 2, and truncated toward zero when stored
+ (like static_cast<int>), so -1 * 2.5f stores -2.
+ Float and double matrices keep their own type, so Matrixf * 0.5 is float (and SIMD).
+ */
+
+/// Everything that is a lazy matrix expression derives from this.
+struct MatrixExpr {};
+
+template<typename E>
+using is_matrix_expr = std::is_base_of<MatrixExpr, E>;
+
+// ----------------------------------------------------------------------------
+// The elementwise operations. The vectorizable ones also work on simd::floatv.
+
+namespace matrix_op {
+
+#if EMATH_SIMD_WIDTH > 1
+	#define EMATH_MATRIX_OP_SIMD(expr) expr
+#else
+	#define EMATH_MATRIX_OP_SIMD(expr)
+#endif
+
+#define EMATH_MATRIX_BINARY_OP(Name, scalar_expr, simd_expr)                                      \
+	struct Name                                                                                   \
+	{                                                                                             \
+		static constexpr bool vectorizable = true;                                                \
+		template<typename T> T operator()(T a, T b) const { return scalar_expr; }                 \
+		EMATH_MATRIX_OP_SIMD(simd::floatv operator()(simd::floatv a, simd::floatv b) const { return simd_expr; }) \
+	};
+
+EMATH_MATRIX_BINARY_OP(Add, a + b,         simd::add(a, b))
+EMATH_MATRIX_BINARY_OP(Sub, a - b,         simd::sub(a, b))
+EMATH_MATRIX_BINARY_OP(Mul, a * b,         simd::mul(a, b))
+EMATH_MATRIX_BINARY_OP(Div, a / b,         simd::div(a, b))
+EMATH_MATRIX_BINARY_OP(Min, a < b ? a : b, simd::min(a, b))
+EMATH_MATRIX_BINARY_OP(Max, a > b ? a : b, simd::max(a, b))
+
+#undef EMATH_MATRIX_BINARY_OP
+
+struct Negate
+{
+	static constexpr bool vectorizable = true;
+	template<typename T> T operator()(T a) const { return -a; }
+	EMATH_MATRIX_OP_SIMD(simd::floatv operator()(simd::floatv a) const { return simd::mul(a, simd::set1(-1.0f)); })
+};
+
+/// The type to combine a T element with an S scalar in.
+template<typename T, typename S>
+using scalar_op_t = typename std::conditional<std::is_floating_point<T>::value,
+	T, typename std::common_type<T, S>::type>::type;
+
+/// op(x, s)
+template<typename Op, typename T>
+struct BindRight
+{
+	static constexpr bool vectorizable = Op::vectorizable;
+	Op op;
+	T  s;
+	T operator()(T x) const { return op(x, s); }
+	EMATH_MATRIX_OP_SIMD(simd::floatv operator()(simd::floatv x) const { return op(x, simd::set1(float(s))); })
+};
+
+/// op(s, x)
+template<typename Op, typename T>
+struct BindLeft
+{
+	static constexpr bool vectorizable = Op::vectorizable;
+	Op op;
+	T  s;
+	T operator()(T x) const { return op(s, x); }
+	EMATH_MATRIX_OP_SIMD(simd::floatv operator()(simd::floatv x) const { return op(simd::set1(float(s)), x); })
+};
+
+#undef EMATH_MATRIX_OP_SIMD
+
+/// False for anything without a 'vectorizable' flag, e.g. lambdas.
+template<typename Op, typename = void>
+struct is_vectorizable : std::false_type {};
+
+template<typename Op>
+struct is_vectorizable<Op, typename std::enable_if<Op::vectorizable>::type> : std::true_type {};
+
+} // namespace matrix_op
+
+// ----------------------------------------------------------------------------
+// Expression nodes. Each has width(), height() and row(y), which returns something
+// indexable with [x] (and with packet(x) for SIMD, if 'vectorizable').
+// (x, y) evaluates a single element.
+
+template<typename T>
+class MatrixLeaf : public MatrixExpr
+{
+public:
+	using value_type = T;
+	static constexpr bool vectorizable = std::is_same<T, float>::value && EMATH_SIMD_WIDTH > 1;
+
+	struct Row
+	{
+		const T* ptr;
+		T operator[](int x) const { return ptr[x]; }
+#if EMATH_SIMD_WIDTH > 1
+		simd::floatv packet(int x) const { return simd::load(ptr + x); }
+#endif
+	};
+
+	explicit MatrixLeaf(ConstMatrixView<T> view) : _view(view) {}
+
+	int width()  const { return _view.width();  }
+	int height() const { return _view.height(); }
+	Row row(int y) const { return Row{_view.row_ptr(y)}; }
+	value_type operator()(int x, int y) const { return row(y)[x]; }
+
+private:
+	ConstMatrixView<T> _view;
+};
+
+template<typename Op, typename A>
+class MatrixUnary : public MatrixExpr
+{
+public:
+	using value_type = typename std::decay<decltype(std::declval<const Op&>()(std::declval<typename A::value_type>()))>::type;
+	static constexpr bool vectorizable = A::vectorizable && matrix_op::is_vectorizable<Op>::value
+	                                     && std::is_same<value_type, float>::value;
+
+	struct Row
+	{
+		typename A::Row a;
+		const Op*       op;
+		value_type operator[](int x) const { return (*op)(a[x]); }
+#if EMATH_SIMD_WIDTH > 1
+		simd::floatv packet(int x) const { return (*op)(a.packet(x)); }
+#endif
+	};
+
+	MatrixUnary(const Op& op, const A& a) : _op(op), _a(a) {}
+
+	int width()  const { return _a.width();  }
+	int height() const { return _a.height(); }
+	Row row(int y) const { return Row{_a.row(y), &_op}; }
+	value_type operator()(int x, int y) const { return row(y)[x]; }
+
+private:
+	Op _op;
+	A  _a;
+};
+
+template<typename Op, typename A, typename B>
+class MatrixBinary : public MatrixExpr
+{
+public:
+	using value_type = typename std::decay<decltype(std::declval<const Op&>()(
+		std::declval<typename A::value_type>(), std::declval<typename B::value_type>()))>::type;
+	static constexpr bool vectorizable = A::vectorizable && B::vectorizable
+	                                     && matrix_op::is_vectorizable<Op>::value
+	                                     && std::is_same<value_type, float>::value;
+
+	struct Row
+	{
+		typename A::Row a;
+		typename B::Row b;
+		const Op*       op;
+		value_type operator[](int x) const { return (*op)(a[x], b[x]); }
+#if EMATH_SIMD_WIDTH > 1
+		simd::floatv packet(int x) const { return (*op)(a.packet(x), b.packet(x)); }
+#endif
+	};
+
+	MatrixBinary(const Op& op, const A& a, const B& b) : _op(op), _a(a), _b(b)
+	{
+		CHECK_F(a.width() == b.width() && a.height() == b.height(),
+		        "Matrix size mismatch: %dx%d vs %dx%d", a.width(), a.height(), b.width(), b.height());
+	}
+
+	int width()  const { return _a.width();  }
+	int height() const { return _a.height(); }
+	Row row(int y) const { return Row{_a.row(y), _b.row(y), &_op}; }
+	value_type operator()(int x, int y) const { return row(y)[x]; }
+
+private:
+	Op _op;
+	A  _a;
+	B  _b;
+};
+
+// ----------------------------------------------------------------------------
+// Matrix, MatrixView and expressions can all be operands.
+
+template<typename X, typename = void>
+struct to_matrix_expr {};
+
+template<typename E>
+struct to_matrix_expr<E, typename std::enable_if<is_matrix_expr<E>::value>::type>
+{
+	using type = E;
+	static const E& get(const E& e) { return e; }
+};
+
+template<typename T, typename A>
+struct to_matrix_expr<Matrix<T, A>>
+{
+	using type = MatrixLeaf<T>;
+	static type get(const Matrix<T, A>& m) { return type(m.view()); }
+};
+
+template<typename T>
+struct to_matrix_expr<MatrixView<T>>
+{
+	using type = MatrixLeaf<typename std::remove_const<T>::type>;
+	static type get(const MatrixView<T>& v) { return type(v); }
+};
+
+template<typename X>
+using matrix_expr_t = typename to_matrix_expr<X>::type;
+
+template<typename X>
+auto as_matrix_expr(const X& x) -> decltype(to_matrix_expr<X>::get(x)) { return to_matrix_expr<X>::get(x); }
+
+// ----------------------------------------------------------------------------
+
+#define EMATH_MATRIX_OPERATOR(OP, Op)                                                                      \
+	template<typename A, typename B>                                                                       \
+	typename std::enable_if<is_matrix_expr<matrix_expr_t<A>>::value && is_matrix_expr<matrix_expr_t<B>>::value, \
+		MatrixBinary<matrix_op::Op, matrix_expr_t<A>, matrix_expr_t<B>>>::type                             \
+	operator OP(const A& a, const B& b)                                                                    \
+	{                                                                                                      \
+		return {matrix_op::Op(), as_matrix_expr(a), as_matrix_expr(b)};                                    \
+	}                                                                                                      \
+                                                                                                           \
+	template<typename A, typename S>                                                                       \
+	typename std::enable_if<is_matrix_expr<matrix_expr_t<A>>::value && std::is_arithmetic<S>::value,       \
+		MatrixUnary<matrix_op::BindRight<matrix_op::Op, matrix_op::scalar_op_t<typename matrix_expr_t<A>::value_type, S>>, matrix_expr_t<A>>>::type \
+	operator OP(const A& a, S s)                                                                           \
+	{                                                                                                      \
+		using T = matrix_op::scalar_op_t<typename matrix_expr_t<A>::value_type, S>;                        \
+		return {{matrix_op::Op(), T(s)}, as_matrix_expr(a)};                                               \
+	}                                                                                                      \
+                                                                                                           \
+	template<typename S, typename B>                                                                       \
+	typename std::enable_if<std::is_arithmetic<S>::value && is_matrix_expr<matrix_expr_t<B>>::value,       \
+		MatrixUnary<matrix_op::BindLeft<matrix_op::Op, matrix_op::scalar_op_t<typename matrix_expr_t<B>::value_type, S>>, matrix_expr_t<B>>>::type \
+	operator OP(S s, const B& b)                                                                           \
+	{                                                                                                      \
+		using T = matrix_op::scalar_op_t<typename matrix_expr_t<B>::value_type, S>;                        \
+		return {{matrix_op::Op(), T(s)}, as_matrix_expr(b)};                                               \
+	}                                                                                                      \
+                                                                                                           \
+	/* The expression would refer to the temporary after it is gone: */                                    \
+	template<typename T, typename Al, typename B>                                                          \
+	void operator OP(Matrix<T, Al>&&, const B&) = delete;                                                  \
+	template<typename A, typename T, typename Al>                                                          \
+	void operator OP(const A&, Matrix<T, Al>&&) = delete;                                                  \
+	template<typename T, typename Al, typename U, typename Bl>                                             \
+	void operator OP(Matrix<T, Al>&&, Matrix<U, Bl>&&) = delete;
+
+EMATH_MATRIX_OPERATOR(+, Add)
+EMATH_MATRIX_OPERATOR(-, Sub)
+EMATH_MATRIX_OPERATOR(*, Mul)
+EMATH_MATRIX_OPERATOR(/, Div)
+
+#undef EMATH_MATRIX_OPERATOR
+
+template<typename A>
+typename std::enable_if<is_matrix_expr<matrix_expr_t<A>>::value, MatrixUnary<matrix_op::Negate, matrix_expr_t<A>>>::type
+operator-(const A& a)
+{
+	return {matrix_op::Negate(), as_matrix_expr(a)};
+}
+
+template<typename T, typename Al>
+void operator-(Matrix<T, Al>&&) = delete;
+
+/// Lazily applies fn to every element. Fuses with any surrounding arithmetic.
+template<typename A, typename Fn>
+MatrixUnary<Fn, matrix_expr_t<A>> map(const A& a, Fn fn)
+{
+	return {fn, as_matrix_expr(a)};
+}
+
+template<typename T, typename Al, typename Fn>
+void map(Matrix<T, Al>&&, Fn) = delete;
+
+/// Lazily computes fn(a(x, y), b(x, y)) for every element.
+template<typename A, typename B, typename Fn>
+MatrixBinary<Fn, matrix_expr_t<A>, matrix_expr_t<B>> zip_map(const A& a, const B& b, Fn fn)
+{
+	return {fn, as_matrix_expr(a), as_matrix_expr(b)};
+}
+
+template<typename T, typename Al, typename B, typename Fn>
+void zip_map(Matrix<T, Al>&&, const B&, Fn) = delete;
+template<typename A, typename T, typename Al, typename Fn>
+void zip_map(const A&, Matrix<T, Al>&&, Fn) = delete;
+template<typename T, typename Al, typename U, typename Bl, typename Fn>
+void zip_map(Matrix<T, Al>&&, Matrix<U, Bl>&&, Fn) = delete;
+
+// ----------------------------------------------------------------------------
+
+namespace matrix_expr_detail {
+
+template<typename Row, typename T>
+int evaluate_packets(const Row&, T*, int, std::false_type) { return 0; }
+
+/// Returns how many elements were done.
+template<typename Row, typename T>
+int evaluate_packets(const Row& row, T* out, int width, std::true_type)
+{
+	int x = 0;
+#if EMATH_SIMD_WIDTH > 1
+	for (; x + simd::WIDTH <= width; x += simd::WIDTH) {
+		simd::store(out + x, row.packet(x));
+	}
+#endif
+	return x;
+}
+
+template<typename Row, typename T, typename Op>
+int reduce_packets(const Row&, int, const Op&, T&, std::false_type) { return 0; }
+
+/// Folds the first whole packets into 'acc'. Returns how many elements were done, or 0.
+template<typename Row, typename T, typename Op>
+int reduce_packets(const Row& row, int width, const Op& op, T& acc, std::true_type)
+{
+	int x = 0;
+#if EMATH_SIMD_WIDTH > 1
+	if (width >= simd::WIDTH) {
+		simd::floatv acc_v = row.packet(0);
+		for (x = simd::WIDTH; x + simd::WIDTH <= width; x += simd::WIDTH) {
+			acc_v = op(acc_v, row.packet(x));
+		}
+		alignas(32) float lanes[simd::WIDTH];
+		simd::store(lanes, acc_v);
+		acc = lanes[0];
+		for (int i = 1; i < simd::WIDTH; ++i) {
+			acc = op(acc, lanes[i]);
+		}
+	}
+#endif
+	return x;
+}
+
+/// Folds a whole (non-empty) row.
+template<typename E, typename Op>
+typename E::value_type reduce_row(const E& e, int y, const Op& op)
+{
+	using T = typename E::value_type;
+	using vectorize = std::integral_constant<bool, E::vectorizable && matrix_op::is_vectorizable<Op>::value>;
+	const auto row = e.row(y);
+	const int width = e.width();
+	T acc = T();
+	int x = reduce_packets(row, width, op, acc, vectorize());
+	if (x == 0) {
+		acc = row[0];
+		x = 1;
+	}
+	for (; x < width; ++x) {
+		acc = op(acc, row[x]);
+	}
+	return acc;
+}
+
+/// Per-row folds, done in parallel. Combining them in order afterwards makes
+/// the result independent of the number of threads.
+template<typename E, typename Op>
+std::vector<typename E::value_type> reduce_rows(const E& e, const Op& op, unsigned num_threads)
+{
+	std::vector<typename E::value_type> rows(e.height());
+	if (e.width() > 0) {
+		parallel_for(size_t(e.height()), num_threads, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; ++y) {
+				rows[y] = reduce_row(e, int(y), op);
+			}
+		});
+	}
+	return rows;
+}
+
+/// What sum() adds up in and returns: double for floating point, int64_t for integers.
+template<typename T>
+using sum_t = typename std::conditional<std::is_floating_point<T>::value, double,
+	typename std::conditional<std::is_integral<T>::value, int64_t, T>::type>::type;
+
+template<typename E>
+sum_t<typename E::value_type> sum_row(const E& e, int y, std::false_type)
+{
+	using Acc = sum_t<typename E::value_type>;
+	const auto row = e.row(y);
+	Acc acc = Acc();
+	for (int x = 0; x < e.width(); ++x) {
+		acc += static_cast<Acc>(row[x]);
+	}
+	return acc;
+}
+
+/// Short runs of packets are added in float, then their lanes in double.
+template<typename E>
+double sum_row(const E& e, int y, std::true_type)
+{
+	const auto row = e.row(y);
+	const int width = e.width();
+	double acc = 0;
+	int x = 0;
+#if EMATH_SIMD_WIDTH > 1
+	alignas(32) float lanes[simd::WIDTH];
+	while (x + simd::WIDTH <= width) {
+		simd::floatv run = simd::zero();
+		for (int i = 0; i < 8 && x + simd::WIDTH <= width; ++i, x += simd::WIDTH) {
+			run = simd::add(run, row.packet(x));
+		}
+		simd::store(lanes, run);
+		for (float lane : lanes) { acc += lane; }
+	}
+#endif
+	for (; x < width; ++x) {
+		acc += row[x];
+	}
+	return acc;
+}
+
+template<typename E, typename Op>
+Vec2i arg_best(const E& e, const Op& op, unsigned num_threads)
+{
+	CHECK_F(e.width() > 0 && e.height() > 0, "Empty matrix has no extremum");
+	const auto rows = reduce_rows(e, op, num_threads);
+	int best_y = 0;
+	for (int y = 1; y < e.height(); ++y) {
+		// Strictly better, and not NaN:
+		if (rows[y] != rows[best_y] && op(rows[best_y], rows[y]) == rows[y]) { best_y = y; }
+	}
+	const auto row = e.row(best_y);
+	for (int x = 0; x < e.width(); ++x) {
+		if (row[x] == rows[best_y]) { return Vec2i(x, best_y); }
+	}
+	return Vec2i(0, best_y); // NaN
+}
+
+} // namespace matrix_expr_detail
+
+// ----------------------------------------------------------------------------
+
+/// dst = expr, one row at a time, with rows split over num_threads.
+/// dst may be one of the operands of expr, since every element only depends on its own position.
+template<typename T, typename X>
+void evaluate(MatrixView<T> dst, const X& expr, unsigned num_threads = 1)
+{
+	const auto& e = as_matrix_expr(expr);
+	using E = typename std::decay<decltype(e)>::type;
+	using vectorize = std::integral_constant<bool, E::vectorizable && std::is_same<T, float>::value>;
+	CHECK_F(dst.width() == e.width() && dst.height() == e.height(),
+	        "Matrix size mismatch: %dx%d vs %dx%d", dst.width(), dst.height(), e.width(), e.height());
+
+	parallel_for(size_t(dst.height()), num_threads, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y) {
+			const auto row = e.row(int(y));
+			T* out = dst.row_ptr(int(y));
+			int x = matrix_expr_detail::evaluate_packets(row, out, dst.width(), vectorize());
+			for (; x < dst.width(); ++x) {
+				out[x] = static_cast<T>(row[x]);
+			}
+		}
+	});
+}
+
+/// Folds all elements with op, which must be associative: op(op(a, b), c) == op(a, op(b, c)).
+/// Returns 'init' for an empty matrix.
+template<typename X, typename T, typename Op>
+T reduce(const X& x, T init, const Op& op, unsigned num_threads = 1)
+{
+	const auto& e = as_matrix_expr(x);
+	if (e.width() == 0) { return init; }
+	for (const auto& row_result : matrix_expr_detail::reduce_rows(e, op, num_threads)) {
+		init = op(init, row_result);
+	}
+	return init;
+}
+
+/// The sum of all elements, added up in double for floating point and in int64_t for integers,
+/// so e.g. a Matrix<uint8_t> doesn't wrap around.
+template<typename X>
+matrix_expr_detail::sum_t<typename matrix_expr_t<X>::value_type> sum(const X& x, unsigned num_threads = 1)
+{
+	const auto& e = as_matrix_expr(x);
+	using E   = typename std::decay<decltype(e)>::type;
+	using Acc = matrix_expr_detail::sum_t<typename E::value_type>;
+	using vectorize = std::integral_constant<bool, E::vectorizable>;
+
+	// Per-row sums in parallel, then added up in order, so the result doesn't depend on num_threads.
+	std::vector<Acc> rows(e.height());
+	parallel_for(size_t(e.height()), num_threads, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y) {
+			rows[y] = matrix_expr_detail::sum_row(e, int(y), vectorize());
+		}
+	});
+	Acc total = Acc();
+	for (const Acc& row_sum : rows) {
+		total += row_sum;
+	}
+	return total;
+}
+
+/// The smallest element. The matrix must not be empty.
+template<typename X>
+typename matrix_expr_t<X>::value_type min_value(const X& x, unsigned num_threads = 1)
+{
+	const auto& e = as_matrix_expr(x);
+	CHECK_F(e.width() > 0 && e.height() > 0, "Empty matrix has no min");
+	const auto rows = matrix_expr_detail::reduce_rows(e, matrix_op::Min(), num_threads);
+	auto result = rows[0];
+	for (const auto& v : rows) { result = matrix_op::Min()(result, v); }
+	return result;
+}
+
+/// The largest element. The matrix must not be empty.
+template<typename X>
+typename matrix_expr_t<X>::value_type max_value(const X& x, unsigned num_threads = 1)
+{
+	const auto& e = as_matrix_expr(x);
+	CHECK_F(e.width() > 0 && e.height() > 0, "Empty matrix has no max");
+	const auto rows = matrix_expr_detail::reduce_rows(e, matrix_op::Max(), num_threads);
+	auto result = rows[0];
+	for (const auto& v : rows) { result = matrix_op::Max()(result, v); }
+	return result;
+}
+
+/// (x, y) of the smallest element, the first one in row-major order if there are several.
+template<typename X>
+Vec2i argmin(const X& x, unsigned num_threads = 1)
+{
+	return matrix_expr_detail::arg_best(as_matrix_expr(x), matrix_op::Min(), num_threads);
+}
+
+/// (x, y) of the largest element, the first one in row-major order if there are several.
+template<typename X>
+Vec2i argmax(const X& x, unsigned num_threads = 1)
+{
+	return matrix_expr_detail::arg_best(as_matrix_expr(x), matrix_op::Max(), num_threads);
+}
+
+} // namespace emath
@@ -0,0 +1,321 @@
+#include "matrix_file.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace emath {
+
+namespace {
+
+const char MATRIX_FILE_MAGIC[8] = {'E', 'M', 'A', 'T', 'R', 'I', 'X', '\0'};
+
+uint32_t swapped_u32(uint32_t v)
+{
+	byte_swap_elements(&v, 1, sizeof(v));
+	return v;
+}
+
+uint64_t swapped_u64(uint64_t v)
+{
+	byte_swap_elements(&v, 1, sizeof(v));
+	return v;
+}
+
+/// Checks everything except the magic and endianness, which the caller handles.
+bool validate_header(const MatrixFileHeader& h, size_t file_size, const std::string& path)
+{
+	if (h.version == 0 || h.version > MATRIX_FILE_VERSION) {
+		LOG_F(ERROR, "'%s': unsupported matrix file version %u", path.c_str(), h.version);
+		return false;
+	}
+	const size_t size = element_size(MatrixElementType(h.element_type));
+	if (size == 0 || size != h.element_size) {
+		LOG_F(ERROR, "'%s': bad element type %u of size %u", path.c_str(), h.element_type, h.element_size);
+		return false;
+	}
+	// MappedMatrixFile::width(), height() and pitch() are ints:
+	const uint64_t max_int = uint64_t(std::numeric_limits<int>::max());
+	if (h.width > max_int || h.height > max_int || h.pitch > max_int) {
+		LOG_F(ERROR, "'%s': matrix too big: %ux%u, pitch %llu", path.c_str(), h.width, h.height,
+		      (unsigned long long)h.pitch);
+		return false;
+	}
+	if (h.pitch < h.width || h.data_offset < sizeof(MatrixFileHeader) || h.data_offset % size != 0) {
+		LOG_F(ERROR, "'%s': bad matrix file layout", path.c_str());
+		return false;
+	}
+	if (h.data_offset > file_size) {
+		LOG_F(ERROR, "'%s' is truncated: %zu bytes, data at %llu", path.c_str(), file_size,
+		      (unsigned long long)h.data_offset);
+		return false;
+	}
+	// The last row does not need its padding. At most 2^62 elements with the checks above, so this
+	// can't overflow, but the size in bytes could: compare in elements.
+	const uint64_t num_elements = (h.height == 0 ? 0 : h.pitch * (h.height - 1) + h.width);
+	if (num_elements > (file_size - h.data_offset) / size) {
+		LOG_F(ERROR, "'%s' is truncated: %zu bytes for a %ux%u matrix with pitch %llu", path.c_str(),
+		      file_size, h.width, h.height, (unsigned long long)h.pitch);
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+size_t element_size(MatrixElementType type)
+{
+	switch (type) {
+		case MatrixElementType::Int8:    return 1;
+		case MatrixElementType::UInt8:   return 1;
+		case MatrixElementType::Int16:   return 2;
+		case MatrixElementType::UInt16:  return 2;
+		case MatrixElementType::Int32:   return 4;
+		case MatrixElementType::UInt32:  return 4;
+		case MatrixElementType::Int64:   return 8;
+		case MatrixElementType::UInt64:  return 8;
+		case MatrixElementType::Float32: return 4;
+		case MatrixElementType::Float64: return 8;
+		default:                         return 0;
+	}
+}
+
+const char* element_type_name(MatrixElementType type)
+{
+	switch (type) {
+		case MatrixElementType::Int8:    return "int8";
+		case MatrixElementType::UInt8:   return "uint8";
+		case MatrixElementType::Int16:   return "int16";
+		case MatrixElementType::UInt16:  return "uint16";
+		case MatrixElementType::Int32:   return "int32";
+		case MatrixElementType::UInt32:  return "uint32";
+		case MatrixElementType::Int64:   return "int64";
+		case MatrixElementType::UInt64:  return "uint64";
+		case MatrixElementType::Float32: return "float32";
+		case MatrixElementType::Float64: return "float64";
+		default:                         return "unknown";
+	}
+}
+
+void byte_swap_elements(void* data, size_t count, size_t size)
+{
+	uint8_t* bytes = static_cast<uint8_t*>(data);
+	for (size_t i = 0; i < count; ++i, bytes += size) {
+		std::reverse(bytes, bytes + size);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+MatrixFileWriter::~MatrixFileWriter()
+{
+	close();
+}
+
+bool MatrixFileWriter::open(const std::string& path, int width, int height, MatrixElementType type, size_t row_alignment)
+{
+	close();
+
+	const size_t size = element_size(type);
+	CHECK_F(size != 0, "Unknown element type");
+	CHECK_F(width >= 0 && height >= 0, "Bad size: %d x %d", width, height);
+	CHECK_F(row_alignment % size == 0, "row_alignment must be a multiple of the element size");
+
+	const size_t align = std::max<size_t>(1, row_alignment / size);
+
+	_header = {};
+	std::memcpy(_header.magic, MATRIX_FILE_MAGIC, sizeof(_header.magic));
+	_header.version      = MATRIX_FILE_VERSION;
+	_header.endian       = MATRIX_FILE_ENDIAN;
+	_header.element_type = uint32_t(type);
+	_header.element_size = uint32_t(size);
+	_header.width        = uint32_t(width);
+	_header.height       = uint32_t(height);
+	_header.pitch        = (size_t(width) + align - 1) / align * align;
+	_header.data_offset  = sizeof(MatrixFileHeader);
+
+	_path         = path;
+	_rows_written = 0;
+	_ok           = true;
+	_file         = std::fopen(path.c_str(), "wb");
+	if (!_file) {
+		LOG_F(ERROR, "Failed to open '%s' for writing", path.c_str());
+		return false;
+	}
+	if (std::fwrite(&_header, sizeof(_header), 1, _file) != 1) {
+		LOG_F(ERROR, "Failed to write to '%s'", path.c_str());
+		_ok = false;
+	}
+	return _ok;
+}
+
+bool MatrixFileWriter::write_row(const void* row)
+{
+	CHECK_F(is_open(), "MatrixFileWriter is not open");
+	CHECK_F(_rows_written < height(), "Too many rows: the matrix has %d", height());
+	if (!_ok) { return false; }
+
+	const size_t size    = _header.element_size;
+	const size_t padding = (_header.pitch - _header.width) * size;
+	bool ok = (std::fwrite(row, size, _header.width, _file) == _header.width);
+	if (ok && padding > 0 && _rows_written + 1 < height()) {
+		static const uint8_t zeros[256] = {};
+		for (size_t left = padding; ok && left > 0; ) {
+			const size_t n = std::min(left, sizeof(zeros));
+			ok = (std::fwrite(zeros, 1, n, _file) == n);
+			left -= n;
+		}
+	}
+	if (!ok) {
+		LOG_F(ERROR, "Failed to write to '%s'", _path.c_str());
+		_ok = false;
+		return false;
+	}
+	_rows_written += 1;
+	return true;
+}
+
+bool MatrixFileWriter::close()
+{
+	if (!_file) { return _ok; }
+
+	if (_ok && _rows_written != height()) {
+		LOG_F(ERROR, "'%s': closed after %d of %d rows", _path.c_str(), _rows_written, height());
+		_ok = false;
+	}
+	if (std::fclose(_file) != 0) {
+		LOG_F(ERROR, "Failed to write to '%s'", _path.c_str());
+		_ok = false;
+	}
+	_file = nullptr;
+	return _ok;
+}
+
+// ----------------------------------------------------------------------------
+
+bool MappedMatrixFile::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		LOG_F(ERROR, "Failed to open '%s'", path.c_str());
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || size_t(file_size.QuadPart) < sizeof(MatrixFileHeader)) {
+		LOG_F(ERROR, "'%s' is not a matrix file", path.c_str());
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* mapped = (mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr);
+	if (!mapped) {
+		LOG_F(ERROR, "Failed to map '%s'", path.c_str());
+		if (mapping) { CloseHandle(mapping); }
+		CloseHandle(file);
+		return false;
+	}
+	_file_handle = file;
+	_map_handle  = mapping;
+	_size        = size_t(file_size.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		LOG_F(ERROR, "Failed to open '%s'", path.c_str());
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(MatrixFileHeader)) {
+		LOG_F(ERROR, "'%s' is not a matrix file", path.c_str());
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping keeps the file alive.
+	if (mapped == MAP_FAILED) {
+		LOG_F(ERROR, "Failed to map '%s'", path.c_str());
+		return false;
+	}
+	_size = size_t(st.st_size);
+#endif
+
+	_data = static_cast<const uint8_t*>(mapped);
+	std::memcpy(&_header, _data, sizeof(_header));
+
+	if (std::memcmp(_header.magic, MATRIX_FILE_MAGIC, sizeof(_header.magic)) != 0) {
+		LOG_F(ERROR, "'%s' is not a matrix file", path.c_str());
+		close();
+		return false;
+	}
+
+	_native_endian = (_header.endian == MATRIX_FILE_ENDIAN);
+	if (!_native_endian) {
+		if (_header.endian != swapped_u32(MATRIX_FILE_ENDIAN)) {
+			LOG_F(ERROR, "'%s' is not a matrix file", path.c_str());
+			close();
+			return false;
+		}
+		_header.version      = swapped_u32(_header.version);
+		_header.endian       = swapped_u32(_header.endian);
+		_header.element_type = swapped_u32(_header.element_type);
+		_header.element_size = swapped_u32(_header.element_size);
+		_header.width        = swapped_u32(_header.width);
+		_header.height       = swapped_u32(_header.height);
+		_header.pitch        = swapped_u64(_header.pitch);
+		_header.data_offset  = swapped_u64(_header.data_offset);
+	}
+
+	if (!validate_header(_header, _size, path)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedMatrixFile::close()
+{
+	if (!_data) { return; }
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle(static_cast<HANDLE>(_map_handle));
+	CloseHandle(static_cast<HANDLE>(_file_handle));
+	_map_handle  = nullptr;
+	_file_handle = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+	_data          = nullptr;
+	_size          = 0;
+	_header        = {};
+	_native_endian = true;
+}
+
+void MappedMatrixFile::swap(MappedMatrixFile& other) noexcept
+{
+	std::swap(_data,          other._data);
+	std::swap(_size,          other._size);
+	std::swap(_header,        other._header);
+	std::swap(_native_endian, other._native_endian);
+#ifdef _WIN32
+	std::swap(_file_handle,   other._file_handle);
+	std::swap(_map_handle,    other._map_handle);
+#endif
+}
+
+} // namespace emath
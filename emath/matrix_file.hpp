@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <loguru.hpp>
+
+#include "matrix.hpp"
+
+namespace emath {
+
+/*
+ A simple binary file format for Matrix, made to be memory mapped.
+
+ The file is a 64 byte MatrixFileHeader followed by the rows, 'pitch' elements apart,
+ in the byte order of the machine that wrote it. The data starts 64 bytes in, so when
+ mapped (page aligned) the first row is 64 byte aligned, and with a row_alignment of 64
+ all of them are.
+
+ Save with save_matrix() or, for grids too big to have in memory, MatrixFileWriter.
+ Load with MappedMatrixFile::view<T>() without copying anything, or copy with load_matrix().
+
+ I/O errors are logged and reported with a 'false' return.
+ */
+
+enum class MatrixElementType : uint32_t
+{
+	Unknown = 0,
+	Int8, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64,
+	Float32, Float64,
+};
+
+/// 0 for Unknown.
+size_t element_size(MatrixElementType type);
+
+const char* element_type_name(MatrixElementType type);
+
+template<typename T> struct matrix_element_type { static constexpr MatrixElementType value = MatrixElementType::Unknown; };
+template<> struct matrix_element_type<int8_t>   { static constexpr MatrixElementType value = MatrixElementType::Int8;    };
+template<> struct matrix_element_type<uint8_t>  { static constexpr MatrixElementType value = MatrixElementType::UInt8;   };
+template<> struct matrix_element_type<int16_t>  { static constexpr MatrixElementType value = MatrixElementType::Int16;   };
+template<> struct matrix_element_type<uint16_t> { static constexpr MatrixElementType value = MatrixElementType::UInt16;  };
+template<> struct matrix_element_type<int32_t>  { static constexpr MatrixElementType value = MatrixElementType::Int32;   };
+template<> struct matrix_element_type<uint32_t> { static constexpr MatrixElementType value = MatrixElementType::UInt32;  };
+template<> struct matrix_element_type<int64_t>  { static constexpr MatrixElementType value = MatrixElementType::Int64;   };
+template<> struct matrix_element_type<uint64_t> { static constexpr MatrixElementType value = MatrixElementType::UInt64;  };
+template<> struct matrix_element_type<float>    { static constexpr MatrixElementType value = MatrixElementType::Float32; };
+template<> struct matrix_element_type<double>   { static constexpr MatrixElementType value = MatrixElementType::Float64; };
+
+const uint32_t MATRIX_FILE_VERSION = 1;
+const uint32_t MATRIX_FILE_ENDIAN  = 0x01020304; // Reads as 0x04030201 on a machine of the other endianness.
+
+struct MatrixFileHeader
+{
+	char     magic[8];     // "EMATRIX\0"
+	uint32_t version;      // MATRIX_FILE_VERSION
+	uint32_t endian;       // MATRIX_FILE_ENDIAN, in the byte order of the elements
+	uint32_t element_type; // MatrixElementType
+	uint32_t element_size; // In bytes
+	uint32_t width;
+	uint32_t height;
+	uint64_t pitch;        // In elements, >= width
+	uint64_t data_offset;  // In bytes from the start of the file
+	uint8_t  reserved[16];
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "Pack");
+
+// ----------------------------------------------------------------------------
+
+/// Writes a matrix file one row at a time, top to bottom.
+class MatrixFileWriter
+{
+public:
+	MatrixFileWriter() = default;
+	~MatrixFileWriter(); ///< Calls close()
+	MatrixFileWriter(const MatrixFileWriter&) = delete;
+	MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+	/// Each row is padded with zeros so it starts at a multiple of 'row_alignment' bytes
+	/// (which must be a multiple of the element size). 0 means no padding.
+	bool open(const std::string& path, int width, int height, MatrixElementType type, size_t row_alignment = 0);
+
+	template<typename T>
+	bool open(const std::string& path, int width, int height, size_t row_alignment = 0)
+	{
+		static_assert(matrix_element_type<T>::value != MatrixElementType::Unknown, "Unsupported element type");
+		return open(path, width, height, matrix_element_type<T>::value, row_alignment);
+	}
+
+	/// 'row' must point to width() elements of the type given to open().
+	bool write_row(const void* row);
+
+	template<typename T>
+	bool write_row(const T* row)
+	{
+		DCHECK_F(matrix_element_type<T>::value == MatrixElementType(_header.element_type), "Wrong element type");
+		return write_row(static_cast<const void*>(row));
+	}
+
+	/// Returns false if anything went wrong, including not writing all rows.
+	bool close();
+
+	bool is_open()      const { return _file != nullptr; }
+	int  width()        const { return int(_header.width);  }
+	int  height()       const { return int(_header.height); }
+	int  rows_written() const { return _rows_written; }
+
+private:
+	std::FILE*       _file = nullptr;
+	std::string      _path;
+	MatrixFileHeader _header = {};
+	int              _rows_written = 0;
+	bool             _ok = true;
+};
+
+// ----------------------------------------------------------------------------
+
+/*
+ A matrix file mapped (read-only) into memory. Nothing is read until it is accessed,
+ so opening is near-instant no matter the size, and the OS can share and evict the pages.
+ The views from view() are only valid while this is open.
+ */
+class MappedMatrixFile
+{
+public:
+	MappedMatrixFile() = default;
+	~MappedMatrixFile() { close(); }
+	MappedMatrixFile(const MappedMatrixFile&) = delete;
+	MappedMatrixFile& operator=(const MappedMatrixFile&) = delete;
+	MappedMatrixFile(MappedMatrixFile&& other) noexcept { swap(other); }
+	MappedMatrixFile& operator=(MappedMatrixFile&& other) noexcept { close(); swap(other); return *this; }
+
+	/// Maps the file and validates the header.
+	bool open(const std::string& path);
+	void close();
+	void swap(MappedMatrixFile& other) noexcept;
+
+	bool is_open() const { return _data != nullptr; }
+
+	/// Always in native byte order, even if the file is not.
+	const MatrixFileHeader& header() const { return _header; }
+
+	int               width()        const { return int(_header.width);  }
+	int               height()       const { return int(_header.height); }
+	int               pitch()        const { return int(_header.pitch);  }
+	MatrixElementType element_type() const { return MatrixElementType(_header.element_type); }
+
+	/// False if the file was written on a machine of the other endianness,
+	/// in which case view() is not possible and you have to use load_matrix().
+	bool is_native_endian() const { return _native_endian; }
+
+	/// The raw bytes of the first row.
+	const void* data() const { return _data + _header.data_offset; }
+
+	/// Zero-copy view of the elements. T must match element_type().
+	template<typename T>
+	ConstMatrixView<T> view() const
+	{
+		CHECK_F(is_open(), "No file is mapped");
+		CHECK_F(matrix_element_type<T>::value == element_type(), "Matrix file has elements of type %s",
+		        element_type_name(element_type()));
+		CHECK_F(_native_endian, "Matrix file has the wrong endianness for a view; use load_matrix");
+		return ConstMatrixView<T>(static_cast<const T*>(data()), width(), height(), pitch());
+	}
+
+private:
+	const uint8_t*   _data          = nullptr;
+	size_t           _size          = 0;
+	MatrixFileHeader _header        = {};
+	bool             _native_endian = true;
+#ifdef _WIN32
+	void*            _file_handle   = nullptr;
+	void*            _map_handle    = nullptr;
+#endif
+};
+
+// ----------------------------------------------------------------------------
+
+/// Reverses the bytes of each of 'count' elements of 'size' bytes, in place.
+void byte_swap_elements(void* data, size_t count, size_t size);
+
+/// T may be const.
+template<typename T>
+bool save_matrix(const std::string& path, MatrixView<T> m, size_t row_alignment = 0)
+{
+	MatrixFileWriter writer;
+	if (!writer.open<typename std::remove_const<T>::type>(path, m.width(), m.height(), row_alignment)) { return false; }
+	for (int y = 0; y < m.height(); ++y) {
+		if (!writer.write_row(m.row_ptr(y))) { return false; }
+	}
+	return writer.close();
+}
+
+template<typename T, typename A>
+bool save_matrix(const std::string& path, const Matrix<T, A>& m, size_t row_alignment = 0)
+{
+	return save_matrix(path, m.view(), row_alignment);
+}
+
+/// Reads a whole file into 'out', fixing the byte order if needed.
+template<typename T, typename A>
+bool load_matrix(const std::string& path, Matrix<T, A>& out)
+{
+	MappedMatrixFile file;
+	if (!file.open(path)) { return false; }
+	if (file.element_type() != matrix_element_type<T>::value) {
+		LOG_F(ERROR, "'%s' has elements of type %s", path.c_str(), element_type_name(file.element_type()));
+		return false;
+	}
+
+	out.resize_discard(file.width(), file.height());
+	const uint8_t* src = static_cast<const uint8_t*>(file.data());
+	for (int y = 0; y < file.height(); ++y) {
+		std::memcpy(out.row_ptr(y), src + size_t(file.pitch()) * sizeof(T) * y, sizeof(T) * file.width());
+		if (!file.is_native_endian()) {
+			byte_swap_elements(out.row_ptr(y), file.width(), sizeof(T));
+		}
+	}
+	return true;
+}
+
+} // namespace emath
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <iterator>
+#include <type_traits>
+
+#include <loguru.hpp>
+
+#include "fwd.hpp"
+#include "vec2.hpp"
+
+namespace emath {
+
+/*
+ A non-owning view of a width x height grid of T, stored row-major with 'pitch'
+ elements from the start of one row to the start of the next.
+ Use MatrixView<const T> (ConstMatrixView<T>) for read-only access.
+
+ Get one from Matrix::view(), from a raw pointer (e.g. an mmapped image), or from sub().
+ Copying a view is cheap and never copies the elements.
+ The view does not keep the data alive!
+ */
+template<typename T>
+class MatrixView
+{
+public:
+	using value_type   = typename std::remove_const<T>::type;
+	using element_type = T;
+
+	// ------------------------------------------------
+	/// Iterates all elements row by row, skipping any padding between rows.
+	class iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = typename MatrixView::value_type;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = T*;
+		using reference         = T&;
+
+		iterator() = default;
+		iterator(T* ptr, int x, int y, int width, int height, int pitch)
+			: _ptr(ptr), _x(x), _y(y), _width(width), _height(height), _pitch(pitch) {}
+
+		T& operator*()  const { return *_ptr; }
+		T* operator->() const { return _ptr; }
+
+		iterator& operator++()
+		{
+			++_ptr;
+			// After the last row we stop at its end instead of stepping a whole pitch
+			// past it, which could be outside the storage.
+			if (++_x == _width && _y + 1 < _height) {
+				_x = 0;
+				++_y;
+				_ptr += _pitch - _width;
+			}
+			return *this;
+		}
+
+		iterator operator++(int) { iterator ret = *this; ++*this; return ret; }
+
+		bool operator==(const iterator& other) const { return _ptr == other._ptr; }
+		bool operator!=(const iterator& other) const { return _ptr != other._ptr; }
+
+	private:
+		T*  _ptr    = nullptr;
+		int _x      = 0;
+		int _y      = 0;
+		int _width  = 0;
+		int _height = 0;
+		int _pitch  = 0;
+	};
+
+	using const_iterator = iterator;
+
+	// ------------------------------------------------
+
+	MatrixView() : _data(nullptr), _width(0), _height(0), _pitch(0) {}
+
+	/// 'pitch' is in elements, and defaults to 'width' (tightly packed rows).
+	MatrixView(T* data, int width, int height, int pitch = -1)
+		: _data(data), _width(width), _height(height), _pitch(pitch < 0 ? width : pitch)
+	{
+		CHECK_GE_F(width, 0);
+		CHECK_GE_F(height, 0);
+		CHECK_GE_F(_pitch, _width);
+		CHECK_F(data != nullptr || width * height == 0);
+	}
+
+	/// MatrixView<T> -> MatrixView<const T>
+	template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+	MatrixView(const MatrixView<U>& other)
+		: _data(other.data()), _width(other.width()), _height(other.height()), _pitch(other.pitch()) {}
+
+	// ------------------------------------------------
+
+	bool empty()  const { return _width == 0 || _height == 0; }
+	int  width()  const { return _width;  } ///< The number of columns
+	int  height() const { return _height; } ///< The number of rows
+	int  size()   const { return _width * _height; }
+	int  pitch()  const { return _pitch;  } ///< Elements from the start of one row to the start of the next
+	bool is_contiguous() const { return _pitch == _width || _height <= 1; }
+
+	T* data() const { return _data; }
+
+	bool contains_coord(int x, int y) const
+	{
+		return 0 <= x && x < _width && 0 <= y && y < _height;
+	}
+
+	bool contains_coord(const Vec2i& c) const { return contains_coord(c.x, c.y); }
+
+	// ------------------------------------------------
+
+	T* row_ptr(int y) const
+	{
+		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
+		return _data + size_t(_pitch) * y;
+	}
+
+	T* pointer_to(int x, int y) const
+	{
+		DCHECK_F(0 <= x && x < _width, "%d not in range [0, %d)", x, _width);
+		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
+		return _data + size_t(_pitch) * y + x;
+	}
+
+	/// (col, row)
+	T& operator()(int x, int y) const { return *pointer_to(x, y); }
+
+	T& operator[](const Vec2i& v) const { return operator()(v.x, v.y); }
+
+	// ------------------------------------------------
+
+	iterator begin() const { return iterator(_data, 0, 0, _width, _height, _pitch); }
+
+	/// Just past the last element of the last row.
+	iterator end() const
+	{
+		if (empty()) { return begin(); }
+		return iterator(row_ptr(_height - 1) + _width, _width, _height - 1, _width, _height, _pitch);
+	}
+
+	// ------------------------------------------------
+
+	/// The sub-rectangle [x, x + width) x [y, y + height).
+	MatrixView sub(int x, int y, int width, int height) const
+	{
+		CHECK_F(0 <= x && 0 <= width  && x + width  <= _width,  "Bad sub-rect columns [%d, %d) of %d", x, x + width, _width);
+		CHECK_F(0 <= y && 0 <= height && y + height <= _height, "Bad sub-rect rows [%d, %d) of %d", y, y + height, _height);
+		if (width == 0 || height == 0) {
+			return MatrixView(_data, 0, 0, 0);
+		}
+		return MatrixView(_data + size_t(_pitch) * y + x, width, height, _pitch);
+	}
+
+	/// A single column, as a width 1 view.
+	MatrixView column(int x) const { return sub(x, 0, 1, _height); }
+
+	/// A single row, as a height 1 view.
+	MatrixView row(int y) const { return sub(0, y, _width, 1); }
+
+private:
+	T*  _data;
+	int _width;
+	int _height;
+	int _pitch;
+};
+
+template<typename T>
+using ConstMatrixView = MatrixView<const T>;
+
+} // namespace emath
@@ -0,0 +1,38 @@
+#include "morton.hpp"
+
+namespace emath {
+
+namespace {
+
+constexpr MortonTables make_morton_tables()
+{
+	MortonTables t{};
+	for (uint32_t v = 0; v < 256; ++v) {
+		for (uint32_t bit = 0; bit < 8; ++bit) {
+			if (v & (1u << bit)) {
+				t.spread_2[v] |= uint16_t(1u << (2 * bit));
+				t.spread_3[v] |= uint32_t(1u << (3 * bit));
+			}
+		}
+		for (uint32_t bit = 0; bit < 4; ++bit) {
+			if (v & (1u << (2 * bit))) {
+				t.compact_2[v] |= uint8_t(1u << bit);
+			}
+		}
+	}
+	for (uint32_t v = 0; v < 512; ++v) {
+		for (uint32_t bit = 0; bit < 3; ++bit) {
+			if (v & (1u << (3 * bit))) {
+				t.compact_3[v] |= uint8_t(1u << bit);
+			}
+		}
+	}
+	return t;
+}
+
+} // namespace
+
+// Built at compile time, so it is ready before any static initializers run.
+const MortonTables MORTON_TABLES = make_morton_tables();
+
+} // namespace emath
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+
+#include <loguru.hpp>
+
+#include "fwd.hpp"
+#include "simd.hpp" // EMATH_BMI2
+
+namespace emath {
+
+/*
+ Morton (Z-order) codes interleave the bits of the coordinates, with x in the lowest bit.
+ Points that are close in 2D/3D tend to be close in Morton order, which makes it a
+ good memory layout for grids that are read in neighborhoods (see TiledMatrix).
+
+ The BMI2 pdep/pext instructions are used when they are available (see simd.hpp).
+ Otherwise lookup tables are used, one byte at a time.
+ 2D codes take 32 bits per coordinate and 3D codes take 21.
+ */
+
+struct MortonTables
+{
+	uint16_t spread_2[256];  // Bit i to bit 2i
+	uint32_t spread_3[256];  // Bit i to bit 3i
+	uint8_t  compact_2[256]; // Bit 2i to bit i
+	uint8_t  compact_3[512]; // Bit 3i to bit i
+};
+
+extern const MortonTables MORTON_TABLES;
+
+const uint64_t MORTON_MASK_2 = 0x5555555555555555ull;
+const uint64_t MORTON_MASK_3 = 0x1249249249249249ull; // 21 bits
+
+/// Bit i of x goes to bit 2i.
+inline uint64_t morton_spread_2(uint32_t x)
+{
+#if EMATH_BMI2
+	return _pdep_u64(x, MORTON_MASK_2);
+#else
+	const uint16_t* t = MORTON_TABLES.spread_2;
+	return  uint64_t(t[ x        & 0xFF])
+	     | (uint64_t(t[(x >>  8) & 0xFF]) << 16)
+	     | (uint64_t(t[(x >> 16) & 0xFF]) << 32)
+	     | (uint64_t(t[(x >> 24) & 0xFF]) << 48);
+#endif
+}
+
+/// Bit 2i of code goes to bit i. The odd bits are ignored.
+inline uint32_t morton_compact_2(uint64_t code)
+{
+#if EMATH_BMI2
+	return uint32_t(_pext_u64(code, MORTON_MASK_2));
+#else
+	uint32_t x = 0;
+	for (int i = 0; i < 8; ++i) {
+		x |= uint32_t(MORTON_TABLES.compact_2[(code >> (8 * i)) & 0xFF]) << (4 * i);
+	}
+	return x;
+#endif
+}
+
+/// Bit i of the lowest 21 bits of x goes to bit 3i.
+inline uint64_t morton_spread_3(uint32_t x)
+{
+#if EMATH_BMI2
+	return _pdep_u64(x, MORTON_MASK_3);
+#else
+	x &= 0x1FFFFF;
+	const uint32_t* t = MORTON_TABLES.spread_3;
+	return  uint64_t(t[ x        & 0xFF])
+	     | (uint64_t(t[(x >>  8) & 0xFF]) << 24)
+	     | (uint64_t(t[(x >> 16)       ]) << 48);
+#endif
+}
+
+/// Bit 3i of code goes to bit i. The other bits are ignored.
+inline uint32_t morton_compact_3(uint64_t code)
+{
+#if EMATH_BMI2
+	return uint32_t(_pext_u64(code, MORTON_MASK_3));
+#else
+	uint32_t x = 0;
+	for (int i = 0; i < 7; ++i) {
+		x |= uint32_t(MORTON_TABLES.compact_3[(code >> (9 * i)) & 0x1FF]) << (3 * i);
+	}
+	return x;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+inline uint64_t morton_encode(uint32_t x, uint32_t y)
+{
+	return morton_spread_2(x) | (morton_spread_2(y) << 1);
+}
+
+/// Only the lowest 21 bits of each coordinate are used.
+inline uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z)
+{
+	return morton_spread_3(x) | (morton_spread_3(y) << 1) | (morton_spread_3(z) << 2);
+}
+
+/// The coordinates must not be negative.
+inline uint64_t morton_encode(const Vec2i& p)
+{
+	DCHECK_F(p.x >= 0 && p.y >= 0, "Negative coordinate: %d, %d", p.x, p.y);
+	return morton_encode(uint32_t(p.x), uint32_t(p.y));
+}
+
+/// The coordinates must be in [0, 2^21).
+inline uint64_t morton_encode(const Vec3i& p)
+{
+	DCHECK_F(0 <= p.x && p.x < (1 << 21) && 0 <= p.y && p.y < (1 << 21) && 0 <= p.z && p.z < (1 << 21),
+	         "Coordinate out of range: %d, %d, %d", p.x, p.y, p.z);
+	return morton_encode(uint32_t(p.x), uint32_t(p.y), uint32_t(p.z));
+}
+
+inline Vec2i morton_decode_2(uint64_t code)
+{
+	return Vec2i(int(morton_compact_2(code)), int(morton_compact_2(code >> 1)));
+}
+
+inline Vec3i morton_decode_3(uint64_t code)
+{
+	return Vec3i(int(morton_compact_3(code)), int(morton_compact_3(code >> 1)), int(morton_compact_3(code >> 2)));
+}
+
+} // namespace emath
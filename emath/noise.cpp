@@ -3,8 +3,13 @@
 #include "fwd.hpp" // vec2 etc
 #include "noise.hpp"
 //#include "vec4.hpp"
+#include <cmath>
 #include <vector>
 
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
 /*
  * A speed-improved simplex noise algorithm for 2D, 3D and 4D.
  *
@@ -35,10 +40,6 @@ namespace emath
 	using Grad3 = Vec3f;
 	using Grad4 = Vec4f;
 
-	const Grad2 grad2[] = {
-		Grad2( 1, 1 ), Grad2( -1, 1 ), Grad2( 1, -1 ), Grad2( -1, -1 )
-	};
-
 	const Grad3 grad3[] = {
 		Grad3( 1, 1, 0 ), Grad3( -1,  1, 0 ), Grad3( 1, -1,  0 ), Grad3( -1, -1,  0 ),
 		Grad3( 1, 0, 1 ), Grad3( -1,  0, 1 ), Grad3( 1,  0, -1 ), Grad3( -1,  0, -1 ),
@@ -160,19 +161,19 @@ namespace emath
 		if (t0<0) n0 = 0;
 		else {
 			t0 *= t0;
-			n0 = t0 * t0 * dot(grad2[gi0], x0, y0);  // (x,y) of grad3 used for 2D gradient
+			n0 = t0 * t0 * dot(grad3[gi0].xy, x0, y0);  // (x,y) of grad3 used for 2D gradient
 		}
 		float t1 = 0.5f - x1*x1-y1*y1;
 		if (t1<0) n1 = 0;
 		else {
 			t1 *= t1;
-			n1 = t1 * t1 * dot(grad2[gi1], x1, y1);
+			n1 = t1 * t1 * dot(grad3[gi1].xy, x1, y1);
 		}
 		float t2 = 0.5f - x2*x2-y2*y2;
 		if (t2<0) n2 = 0.0;
 		else {
 			t2 *= t2;
-			n2 = t2 * t2 * dot(grad2[gi2], x2, y2);
+			n2 = t2 * t2 * dot(grad3[gi2].xy, x2, y2);
 		}
 		// Add contributions from each corner to get the final noise value.
 		// The result is scaled to return values in the interval [-1,1].
@@ -446,4 +447,263 @@ namespace emath
 
 		return total / max_amplitude;
 	}
+	// ----------------------------------------------------------------
+	// Grid fills.
+	//
+	// The lattice hashing is done per lane with small byte tables (1 KiB in total,
+	// so they stay in L1), while all the float math is done on WIDTH samples at once.
+	// The float operations are done in the same order as in noise_2d/noise_3d above.
+
+	namespace {
+
+	struct NoiseTables
+	{
+		uint8_t perm[512];
+		uint8_t perm_mod12[512];
+		float   grad_x[12], grad_y[12], grad_z[12];
+
+		NoiseTables()
+		{
+			for (uint i = 0; i < 512; ++i) {
+				perm[i]       = uint8_t(emath::perm[i]);
+				perm_mod12[i] = uint8_t(emath::perm[i] % 12);
+			}
+			for (uint i = 0; i < 12; ++i) {
+				grad_x[i] = grad3[i].x;
+				grad_y[i] = grad3[i].y;
+				grad_z[i] = grad3[i].z;
+			}
+		}
+	};
+
+	const NoiseTables s_noise_tables;
+
+#if EMATH_SIMD_WIDTH > 1
+	using simd::floatv;
+	using simd::WIDTH;
+
+	/// Contribution from one simplex corner: max(t - |p|^2, 0)^4 * dot(grad, p)
+	inline floatv corner_2d(float t_start, floatv x, floatv y, const float* gx, const float* gy)
+	{
+		using namespace simd;
+		floatv t = sub(sub(set1(t_start), mul(x, x)), mul(y, y));
+		t = max(t, zero());
+		t = mul(t, t);
+		const floatv d = add(mul(load(gx), x), mul(load(gy), y));
+		return mul(mul(t, t), d);
+	}
+
+	inline floatv corner_3d(float t_start, floatv x, floatv y, floatv z, const float* gx, const float* gy, const float* gz)
+	{
+		using namespace simd;
+		floatv t = sub(sub(sub(set1(t_start), mul(x, x)), mul(y, y)), mul(z, z));
+		t = max(t, zero());
+		t = mul(t, t);
+		const floatv d = add(add(mul(load(gx), x), mul(load(gy), y)), mul(load(gz), z));
+		return mul(mul(t, t), d);
+	}
+
+	floatv noise_2d_simd(floatv xin, floatv yin)
+	{
+		using namespace simd;
+		const NoiseTables& tab = s_noise_tables;
+		const floatv one = set1(1.0f);
+
+		const floatv s  = mul(add(xin, yin), set1(F2));
+		const floatv fi = floor(add(xin, s));
+		const floatv fj = floor(add(yin, s));
+		const floatv t  = mul(add(fi, fj), set1(G2));
+		const floatv x0 = sub(xin, sub(fi, t));
+		const floatv y0 = sub(yin, sub(fj, t));
+
+		const floatv lower = cmp_gt(x0, y0);
+		const floatv i1 = bit_and(lower, one);
+		const floatv j1 = bit_andnot(lower, one);
+
+		const floatv x1 = add(sub(x0, i1), set1(G2));
+		const floatv y1 = add(sub(y0, j1), set1(G2));
+		const floatv x2 = add(sub(x0, one), set1(2 * G2));
+		const floatv y2 = add(sub(y0, one), set1(2 * G2));
+
+		alignas(32) float fi_l[WIDTH], fj_l[WIDTH];
+		store(fi_l, fi);
+		store(fj_l, fj);
+		const int lower_bits = movemask(lower);
+
+		alignas(32) float gx[3][WIDTH], gy[3][WIDTH];
+		for (int l = 0; l < WIDTH; ++l) {
+			const uint ii = uint(int(fi_l[l])) & 255;
+			const uint jj = uint(int(fj_l[l])) & 255;
+			const uint li1 = (lower_bits >> l) & 1;
+			const uint lj1 = 1 - li1;
+			const uint gi0 = tab.perm_mod12[ii +       tab.perm[jj      ]];
+			const uint gi1 = tab.perm_mod12[ii + li1 + tab.perm[jj + lj1]];
+			const uint gi2 = tab.perm_mod12[ii + 1   + tab.perm[jj + 1  ]];
+			gx[0][l] = tab.grad_x[gi0];  gy[0][l] = tab.grad_y[gi0];
+			gx[1][l] = tab.grad_x[gi1];  gy[1][l] = tab.grad_y[gi1];
+			gx[2][l] = tab.grad_x[gi2];  gy[2][l] = tab.grad_y[gi2];
+		}
+
+		const floatv n0 = corner_2d(0.5f, x0, y0, gx[0], gy[0]);
+		const floatv n1 = corner_2d(0.5f, x1, y1, gx[1], gy[1]);
+		const floatv n2 = corner_2d(0.5f, x2, y2, gx[2], gy[2]);
+		return mul(set1(70.0f), add(add(n0, n1), n2));
+	}
+
+	floatv noise_3d_simd(floatv xin, floatv yin, floatv zin)
+	{
+		using namespace simd;
+		const NoiseTables& tab = s_noise_tables;
+		const floatv one = set1(1.0f);
+		const floatv two = set1(2.0f);
+
+		const floatv s  = mul(add(add(xin, yin), zin), set1(F3));
+		const floatv fi = floor(add(xin, s));
+		const floatv fj = floor(add(yin, s));
+		const floatv fk = floor(add(zin, s));
+		const floatv t  = mul(add(add(fi, fj), fk), set1(G3));
+		const floatv x0 = sub(xin, sub(fi, t));
+		const floatv y0 = sub(yin, sub(fj, t));
+		const floatv z0 = sub(zin, sub(fk, t));
+
+		// Branch-free version of the simplex ordering in noise_3d:
+		const floatv xy = cmp_ge(x0, y0);
+		const floatv yz = cmp_ge(y0, z0);
+		const floatv xz = cmp_ge(x0, z0);
+		const floatv i1 = bit_and(bit_and(xy, xz), one);          // x is largest
+		const floatv j1 = bit_and(bit_andnot(xy, yz), one);       // y is largest
+		const floatv k1 = sub(sub(one, i1), j1);                   // z is largest
+		const floatv i2 = bit_and(bit_or(xy, bit_and(yz, xz)), one); // x is not smallest
+		const floatv j2 = sub(one, bit_and(bit_andnot(yz, xy), one)); // y is not smallest
+		const floatv k2 = sub(sub(two, i2), j2);                   // z is not smallest
+
+		const floatv x1 = add(sub(x0, i1), set1(G3));
+		const floatv y1 = add(sub(y0, j1), set1(G3));
+		const floatv z1 = add(sub(z0, k1), set1(G3));
+		const floatv x2 = add(sub(x0, i2), set1(2*G3));
+		const floatv y2 = add(sub(y0, j2), set1(2*G3));
+		const floatv z2 = add(sub(z0, k2), set1(2*G3));
+		const floatv x3 = add(sub(x0, one), set1(3*G3));
+		const floatv y3 = add(sub(y0, one), set1(3*G3));
+		const floatv z3 = add(sub(z0, one), set1(3*G3));
+
+		alignas(32) float fi_l[WIDTH], fj_l[WIDTH], fk_l[WIDTH];
+		alignas(32) float i1_l[WIDTH], j1_l[WIDTH], k1_l[WIDTH], i2_l[WIDTH], j2_l[WIDTH], k2_l[WIDTH];
+		store(fi_l, fi); store(fj_l, fj); store(fk_l, fk);
+		store(i1_l, i1); store(j1_l, j1); store(k1_l, k1);
+		store(i2_l, i2); store(j2_l, j2); store(k2_l, k2);
+
+		alignas(32) float gx[4][WIDTH], gy[4][WIDTH], gz[4][WIDTH];
+		for (int l = 0; l < WIDTH; ++l) {
+			const uint ii = uint(int(fi_l[l])) & 255;
+			const uint jj = uint(int(fj_l[l])) & 255;
+			const uint kk = uint(int(fk_l[l])) & 255;
+			const uint li1 = uint(i1_l[l]), lj1 = uint(j1_l[l]), lk1 = uint(k1_l[l]);
+			const uint li2 = uint(i2_l[l]), lj2 = uint(j2_l[l]), lk2 = uint(k2_l[l]);
+			const uint gi[4] = {
+				tab.perm_mod12[ii +       tab.perm[jj +       tab.perm[kk      ]]],
+				tab.perm_mod12[ii + li1 + tab.perm[jj + lj1 + tab.perm[kk + lk1]]],
+				tab.perm_mod12[ii + li2 + tab.perm[jj + lj2 + tab.perm[kk + lk2]]],
+				tab.perm_mod12[ii + 1   + tab.perm[jj + 1   + tab.perm[kk + 1  ]]],
+			};
+			for (int c = 0; c < 4; ++c) {
+				gx[c][l] = tab.grad_x[gi[c]];
+				gy[c][l] = tab.grad_y[gi[c]];
+				gz[c][l] = tab.grad_z[gi[c]];
+			}
+		}
+
+		const floatv n0 = corner_3d(0.6f, x0, y0, z0, gx[0], gy[0], gz[0]);
+		const floatv n1 = corner_3d(0.6f, x1, y1, z1, gx[1], gy[1], gz[1]);
+		const floatv n2 = corner_3d(0.6f, x2, y2, z2, gx[2], gy[2], gz[2]);
+		const floatv n3 = corner_3d(0.6f, x3, y3, z3, gx[3], gy[3], gz[3]);
+		return mul(set1(32.0f), add(add(add(n0, n1), n2), n3));
+	}
+#endif // EMATH_SIMD_WIDTH > 1
+
+	/// One row of octave noise: out[x] = octave_noise(origin_x + x * step_x, y, z)
+	template<int DIM>
+	void octave_noise_row(float* out, int width, float origin_x, float step_x, float y, float z,
+	                      unsigned octaves, float persistence)
+	{
+		int x = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+		using namespace simd;
+
+		alignas(32) float lane_index[WIDTH];
+		for (int l = 0; l < WIDTH; ++l) {
+			lane_index[l] = float(l);
+		}
+		const floatv lanes = load(lane_index);
+
+		for (; x + WIDTH <= width; x += WIDTH) {
+			const floatv px = add(set1(origin_x), mul(add(set1(float(x)), lanes), set1(step_x)));
+
+			floatv total = zero();
+			float frequency = 1;
+			float amplitude = 1;
+			float max_amplitude = 0;
+
+			for (unsigned i = 0; i < octaves; ++i) {
+				const floatv f = set1(frequency);
+				const floatv n = (DIM == 2
+					? noise_2d_simd(mul(px, f), set1(y * frequency))
+					: noise_3d_simd(mul(px, f), set1(y * frequency), set1(z * frequency)));
+				total = add(total, mul(n, set1(amplitude)));
+
+				frequency *= 2;
+				max_amplitude += amplitude;
+				amplitude *= persistence;
+			}
+
+			store(out + x, simd::div(total, set1(max_amplitude)));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			const float px = origin_x + float(x) * step_x;
+			out[x] = (DIM == 2
+				? octave_noise_2d(octaves, persistence, px, y)
+				: octave_noise_3d(octaves, persistence, px, y, z));
+		}
+	}
+
+	} // namespace
+
+	void fill_noise_2d(Matrixf& out, Vec2f origin, Vec2f step,
+	                   unsigned octaves, float persistence, unsigned num_threads)
+	{
+		parallel_for(size_t(out.height()), num_threads, [&](size_t y_begin, size_t y_end) {
+			for (size_t y = y_begin; y < y_end; ++y) {
+				const float py = origin.y + float(y) * step.y;
+				octave_noise_row<2>(out.row_ptr(int(y)), out.width(), origin.x, step.x, py, 0,
+				                    octaves, persistence);
+			}
+		});
+	}
+
+	void fill_noise_3d(std::vector<Matrixf>& layers, Vec3f origin, Vec3f step,
+	                   unsigned octaves, float persistence, unsigned num_threads)
+	{
+		if (layers.empty()) { return; }
+		const int width  = layers[0].width();
+		const int height = layers[0].height();
+		for (const auto& layer : layers) {
+			CHECK_F(layer.width() == width && layer.height() == height, "All layers must have the same size");
+		}
+
+		// Split over all rows of all layers:
+		const size_t num_rows = layers.size() * size_t(height);
+		parallel_for(num_rows, num_threads, [&](size_t row_begin, size_t row_end) {
+			for (size_t row = row_begin; row < row_end; ++row) {
+				const size_t z = row / size_t(height);
+				const size_t y = row % size_t(height);
+				const float py = origin.y + float(y) * step.y;
+				const float pz = origin.z + float(z) * step.z;
+				octave_noise_row<3>(layers[z].row_ptr(int(y)), width, origin.x, step.x, py, pz,
+				                    octaves, persistence);
+			}
+		});
+	}
 }
@@ -1,6 +1,8 @@
 // Created 2013-02-16.
 #pragma once
 
+#include <vector>
+
 #include "fwd.hpp" // vec4 etc
 
 namespace emath
@@ -28,6 +30,22 @@ namespace emath
 	float octave_noise_4d(unsigned octaves, float persistence,
 								 float x, float y, float z, float w);
 
+	// ----------------------------------------------------------------------
+	// Grid fills. These evaluate many samples at once using SIMD,
+	// and can split the rows over several threads.
+	// The results match octave_noise_2d/octave_noise_3d up to float rounding.
+
+	/// out(x, y) = octave_noise_2d(octaves, persistence, origin.x + x * step.x, origin.y + y * step.y)
+	/// Fills all of 'out' (which keeps its size).
+	void fill_noise_2d(Matrixf& out, Vec2f origin, Vec2f step,
+	                   unsigned octaves, float persistence, unsigned num_threads = 1);
+
+	/// Fills a slab of 3D noise, one matrix per z-layer:
+	/// layers[z](x, y) = octave_noise_3d(octaves, persistence, origin + (x, y, z) * step)
+	/// All layers must have the same size.
+	void fill_noise_3d(std::vector<Matrixf>& layers, Vec3f origin, Vec3f step,
+	                   unsigned octaves, float persistence, unsigned num_threads = 1);
+
 	// ----------------------------------------------------------------------
 	// 1d -> 2d, 3d, 4d:
 
@@ -0,0 +1,117 @@
+#include "parallel.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace emath {
+namespace parallel_detail {
+
+namespace {
+
+/// One run_tasks() call. Lives on the stack of the calling thread.
+struct Batch
+{
+	void (*task)(void*, size_t);
+	void*  context;
+	size_t num_tasks;
+	size_t next_index; // Next task to hand out
+	size_t num_done;
+};
+
+class WorkerPool
+{
+public:
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_work_cv.notify_all();
+		for (auto& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	void run(size_t num_tasks, void (*task)(void*, size_t), void* context)
+	{
+		Batch batch{task, context, num_tasks, 1, 0};
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_workers.size() + 1 < num_tasks) {
+			_workers.emplace_back([this]() { work(); });
+		}
+		_batches.push_back(&batch);
+		lock.unlock();
+		_work_cv.notify_all();
+
+		task(context, 0);
+
+		lock.lock();
+		batch.num_done += 1;
+		while (batch.num_done < batch.num_tasks) {
+			// Help out instead of just waiting. This is what makes nested calls safe.
+			if (!run_one(lock)) {
+				_done_cv.wait(lock);
+			}
+		}
+	}
+
+private:
+	/// Runs one queued task, if any. Called and returns with the lock held.
+	bool run_one(std::unique_lock<std::mutex>& lock)
+	{
+		if (_batches.empty()) { return false; }
+		Batch* batch = _batches.front();
+		const size_t index = batch->next_index++;
+		if (batch->next_index == batch->num_tasks) {
+			_batches.pop_front();
+		}
+
+		lock.unlock();
+		batch->task(batch->context, index);
+		lock.lock();
+
+		batch->num_done += 1;
+		if (batch->num_done == batch->num_tasks) {
+			_done_cv.notify_all(); // Still under the lock, so the batch is still alive.
+		}
+		return true;
+	}
+
+	void work()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (!_quit) {
+			if (!run_one(lock)) {
+				_work_cv.wait(lock);
+			}
+		}
+	}
+
+	std::mutex               _mutex;
+	std::condition_variable  _work_cv; // New batches, or quit
+	std::condition_variable  _done_cv; // A batch finished
+	std::deque<Batch*>       _batches; // With tasks left to hand out
+	std::vector<std::thread> _workers;
+	bool                     _quit = false;
+};
+
+} // namespace
+
+void run_tasks(size_t num_tasks, void (*task)(void* context, size_t index), void* context)
+{
+	if (num_tasks == 0) { return; }
+	if (num_tasks == 1) {
+		task(context, 0);
+		return;
+	}
+	static WorkerPool s_pool;
+	s_pool.run(num_tasks, task, context);
+}
+
+} // namespace parallel_detail
+} // namespace emath
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace emath {
+
+namespace parallel_detail {
+
+/// Runs task(context, i) for every i in [0, num_tasks) and returns when all are done.
+/// Task 0 runs on the calling thread, the rest on a pool of worker threads that is started
+/// on first use and kept until exit (it grows to the largest number of tasks asked for).
+/// While waiting, the calling thread runs queued tasks too, so nested calls can't deadlock.
+void run_tasks(size_t num_tasks, void (*task)(void* context, size_t index), void* context);
+
+} // namespace parallel_detail
+
+/*
+ Fork-join helper for the bulk kernels.
+ Calls fn(begin, end) on contiguous chunks of [0, n), one chunk per thread.
+ The calling thread does the first chunk itself, the others go to the shared worker pool,
+ so calling this every frame costs a few wakeups instead of creating threads.
+ num_threads <= 1 runs everything on the calling thread.
+ */
+template<typename Fn>
+void parallel_for(size_t n, unsigned num_threads, const Fn& fn)
+{
+	if (num_threads <= 1 || n <= 1) {
+		fn(size_t(0), n);
+		return;
+	}
+
+	num_threads = static_cast<unsigned>(std::min<size_t>(num_threads, n));
+
+	struct Chunks
+	{
+		const Fn* fn;
+		size_t    n;
+		size_t    chunk;
+	};
+	Chunks chunks{&fn, n, (n + num_threads - 1) / num_threads};
+	const size_t num_chunks = (n + chunks.chunk - 1) / chunks.chunk;
+
+	parallel_detail::run_tasks(num_chunks, [](void* context, size_t index) {
+		const Chunks& c = *static_cast<const Chunks*>(context);
+		const size_t begin = index * c.chunk;
+		(*c.fn)(begin, std::min(c.n, begin + c.chunk));
+	}, &chunks);
+}
+
+} // namespace emath
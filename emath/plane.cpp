@@ -4,18 +4,21 @@
 
 namespace emath
 {
-	Plane Plane::from_point_normal(const Vec3f& p, const Vec3f& n)
+	template<typename T>
+	PlaneT<T> PlaneT<T>::from_point_normal(const Vec3& p, const Vec3& n)
 	{
-		return Plane(n, -dot(p, n));
+		return PlaneT(n, -dot(p, n));
 	}
 
-	Plane Plane::from_points(const Vec3f& p1, const Vec3f& p2, const Vec3f& p3)
+	template<typename T>
+	PlaneT<T> PlaneT<T>::from_points(const Vec3& p1, const Vec3& p2, const Vec3& p3)
 	{
 		return from_point_normal(p1, cross(p1-p2, p3-p2));
 	}
 
 	// NOT TESTED in 'Voxels'
-	Vec3f Plane::plane_intersection(const Plane& a, const Plane& b, const Plane& c)
+	template<typename T>
+	Vec3T<T> PlaneT<T>::plane_intersection(const PlaneT& a, const PlaneT& b, const PlaneT& c)
 	{
 		/*
 		 Alternate homebrew solution (by emilk):
@@ -26,14 +29,14 @@ namespace emath
 		 Infact, it seems to be exactly what is going on below, only more verbose.
 		 */
 
-		Plane planes[3]	= {a,b,c};
-		Vec3f  normals[3];
+		PlaneT planes[3] = {a,b,c};
+		Vec3   normals[3];
 
 		for (int i=0; i<3; ++i) {
 			normals[i] = planes[i].normal();
 		}
 
-		float det =
+		T det =
 			+ normals[0].x * normals[1].y * normals[2].z
 			+ normals[0].y * normals[1].z * normals[2].x
 			+ normals[0].z * normals[1].x * normals[2].y
@@ -42,7 +45,7 @@ namespace emath
 			- normals[0].y * normals[1].x * normals[2].z
 			- normals[0].z * normals[1].y * normals[2].x;
 
-		Vec3f top =
+		Vec3 top =
 			cross(normals[1], normals[2]) * -planes[0].distance() +
 			cross(normals[2], normals[0]) * -planes[1].distance() +
 			cross(normals[0], normals[1]) * -planes[2].distance();
@@ -81,10 +84,14 @@ namespace emath
 	}
 #endif
 
-	void Plane::normalize()
+	template<typename T>
+	void PlaneT<T>::normalize()
 	{
-		auto inv_length = 1.0f / length(_normal);
+		auto inv_length = T(1) / length(_normal);
 		_normal *= inv_length;
 		_dist   *= inv_length;
 	}
+
+	template class PlaneT<float>;
+	template class PlaneT<double>;
 }
@@ -11,43 +11,61 @@
 
 namespace emath
 {
-	class Plane
+	/// T is float or double (Plane and Planed).
+	template<typename T>
+	class PlaneT
 	{
 	public:
-		Plane() : _normal(0,0,0), _dist(0) {}
+		using Vec3 = Vec3T<T>;
 
-		Plane(float a, float b, float c, float d) : _normal(a, b, c), _dist(d)
+		PlaneT() : _normal(0,0,0), _dist(0) {}
+
+		PlaneT(T a, T b, T c, T d) : _normal(a, b, c), _dist(d)
 		{
 			normalize();
 		}
 
-		Plane(const Vec3f& v, float d) : _normal(v), _dist(d)
+		PlaneT(const Vec3& v, T d) : _normal(v), _dist(d)
 		{
 			normalize();
 		}
 
-		explicit Plane(const Vec4f& v) : _normal(v.x, v.y, v.z), _dist(v.w)
+		explicit PlaneT(const Vec4T<T>& v) : _normal(v.x, v.y, v.z), _dist(v.w)
 		{
 			normalize();
 		}
 
+		/// Between float and double. Already normalized, so it is not done again.
+		template<typename F>
+		explicit PlaneT(const PlaneT<F>& p) : _normal(p.normal()), _dist(T(p.distance())) {}
+
 		// Created a plane of points x where Dot(x - point, normal) == 0
-		static Plane from_point_normal(const Vec3f& point, const Vec3f& normal);
-		static Plane from_points(const Vec3f& p1, const Vec3f& p2, const Vec3f& p3);
+		static PlaneT from_point_normal(const Vec3& point, const Vec3& normal);
+		static PlaneT from_points(const Vec3& p1, const Vec3& p2, const Vec3& p3);
 
 		// Returns the intersection point of three planes.
 		// NOT TESTED in 'Voxels'
-		static Vec3f plane_intersection(const Plane& a, const Plane& b, const Plane& c);
+		static Vec3 plane_intersection(const PlaneT& a, const PlaneT& b, const PlaneT& c);
 
-		const Vec3f& normal() const { return _normal; }
-		float distance() const { return _dist; }
+		const Vec3& normal() const { return _normal; }
+		T distance() const { return _dist; }
+
+		/// The same plane, in coordinates where 'origin' is at zero:
+		/// relative_to(o).distance(p - o) == distance(p).
+		PlaneT relative_to(const Vec3& origin) const
+		{
+			PlaneT result;
+			result._normal = _normal;
+			result._dist   = _dist + dot(_normal, origin);
+			return result;
+		}
 
 #if 0
 		void transform(const Mat4& transform);
 #endif
 
 		// Only works for normalized planes.
-		float distance(const Vec3f& p) const
+		T distance(const Vec3& p) const
 		{
 			return dot(p, _normal) + _dist;
 		}
@@ -56,10 +74,14 @@ namespace emath
 		void normalize();
 
 		// A point x is on the plane if dot(_normal, x) + _dist = 0.
-		Vec3f _normal;
-		float _dist;
+		Vec3 _normal;
+		T    _dist;
 	};
 
+	// Plane and Planed are declared in fwd.hpp and instantiated in plane.cpp.
+	extern template class PlaneT<float>;
+	extern template class PlaneT<double>;
+
 	// ---------------------------------------
 
 	struct plane_2d
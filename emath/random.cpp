@@ -2,6 +2,8 @@
 
 #include "random.hpp"
 
+#include <atomic>
+
 static unsigned random_seed()
 {
 #if DEBUG
@@ -13,42 +15,69 @@ static unsigned random_seed()
 
 namespace emath {
 
-unsigned Random::s_seed = random_seed();
-Random Random::s_random;
+static std::atomic<unsigned> s_seed{random_seed()};
+static std::atomic<uint64_t> s_master_seed{random_seed()};
+static std::atomic<unsigned> s_next_thread_index{0};
 
-Random::Random(const char* seed) : Random((unsigned)std::hash<const char*>()(seed))
+unsigned next_random_seed()
 {
+	return s_seed.fetch_add(1, std::memory_order_relaxed);
 }
 
-Vec2f Random::random_unit_circle()
+uint64_t master_random_seed()
 {
-	for (;;) {
-		Vec2f v = { random_interval(-1.0f, +1.0f), random_interval(-1.0f, +1.0f) };
-		if (length_sq(v) <= 1.0f) { return v; }
-	}
+	return s_master_seed.load(std::memory_order_relaxed);
 }
 
-inline float rgb_intensity(const Vec3f& v)
+void set_master_random_seed(uint64_t seed)
 {
-	return 0.3f*v.r + 0.59f*v.g + 0.11f*v.b;
+	s_master_seed.store(seed, std::memory_order_relaxed);
 }
 
-Vec3f Random::dark_rgb()
+uint64_t thread_random_seed(uint64_t master_seed, unsigned thread_index)
 {
-	for (;;) {
-		Vec3f rgb = { random_float(), random_float(), random_float() };
-		float intensity = rgb_intensity(rgb);
-		if (intensity < 0.3f) { return rgb; }
-	}
+	uint64_t z = master_seed + (uint64_t(thread_index) + 1) * 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+unsigned next_random_thread_index()
+{
+	return s_next_thread_index.fetch_add(1, std::memory_order_relaxed);
 }
 
-Vec3f Random::bright_rgb()
+static ZigguratTables make_ziggurat_tables()
 {
-	for (;;) {
-		Vec3f rgb = { random_float(), random_float(), random_float() };
-		float intensity = rgb_intensity(rgb);
-		if (intensity > 0.5f) { return rgb; }
+	// From "The Ziggurat Method for Generating Random Variables", Marsaglia & Tsang 2000.
+	const double m1 = 2147483648.0; // 2^31
+	const double vn = 9.91256303526217e-3; // Area of each layer.
+	double dn = 3.442619855899;
+	double tn = dn;
+
+	ZigguratTables zig;
+	const double q = vn / std::exp(-0.5 * dn * dn);
+	zig.kn[0]   = uint32_t((dn / q) * m1);
+	zig.kn[1]   = 0;
+	zig.wn[0]   = float(q / m1);
+	zig.wn[127] = float(dn / m1);
+	zig.fn[0]   = 1.0f;
+	zig.fn[127] = float(std::exp(-0.5 * dn * dn));
+
+	for (int i = 126; i >= 1; --i) {
+		dn = std::sqrt(-2.0 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+		zig.kn[i + 1] = uint32_t((dn / tn) * m1);
+		tn = dn;
+		zig.fn[i] = float(std::exp(-0.5 * dn * dn));
+		zig.wn[i] = float(dn / m1);
 	}
+	return zig;
+}
+
+const ZigguratTables& ziggurat_tables()
+{
+	static const ZigguratTables s_tables = make_ziggurat_tables();
+	return s_tables;
 }
 
 } // namespace emath
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <functional>
 #include <random>
 
+#include "fwd.hpp"
 #include "math.hpp" // floor_to_int
 #include "range.hpp"
 #include "vec2.hpp" // Convenience
@@ -10,21 +14,252 @@
 
 namespace emath {
 
-class Random
+// ----------------------------------------------------------------------------
+// Engines. These are small (16 bytes), need no heap, and are cheap to seed,
+// so it is fine to have one per particle or per thread.
+// Both satisfy UniformRandomBitGenerator, so they work with <random> too.
+
+/// PCG-XSH-RR with 64-bit state, see http://www.pcg-random.org
+/// Period 2^64. Each 'stream' is a separate, independent sequence.
+class Pcg32
+{
+public:
+	using result_type = uint32_t;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	explicit Pcg32(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+	{
+		_state = 0;
+		_inc = (stream << 1u) | 1u;
+		(*this)();
+		_state += seed;
+		(*this)();
+	}
+
+	result_type operator()()
+	{
+		const uint64_t old = _state;
+		_state = old * MULT + _inc;
+		const uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		const uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31u));
+	}
+
+	/// Skip ahead 'delta' steps in O(log(delta)).
+	void advance(uint64_t delta)
+	{
+		uint64_t cur_mult = MULT;
+		uint64_t cur_plus = _inc;
+		uint64_t acc_mult = 1;
+		uint64_t acc_plus = 0;
+		while (delta > 0) {
+			if (delta & 1) {
+				acc_mult *= cur_mult;
+				acc_plus = acc_plus * cur_mult + cur_plus;
+			}
+			cur_plus = (cur_mult + 1) * cur_plus;
+			cur_mult *= cur_mult;
+			delta /= 2;
+		}
+		_state = acc_mult * _state + acc_plus;
+	}
+
+	/// Skip ahead 2^48 steps, i.e. splits the period into 65536 non-overlapping sequences.
+	void jump() { advance(uint64_t(1) << 48); }
+
+	/// A generator on a different stream, seeded from this one.
+	Pcg32 split(uint64_t stream)
+	{
+		const uint64_t hi = (*this)();
+		const uint64_t lo = (*this)();
+		return Pcg32((hi << 32) | lo, stream);
+	}
+
+	friend bool operator==(const Pcg32& a, const Pcg32& b) { return a._state == b._state && a._inc == b._inc; }
+	friend bool operator!=(const Pcg32& a, const Pcg32& b) { return !(a == b); }
+
+private:
+	static constexpr uint64_t MULT = 6364136223846793005ULL;
+
+	uint64_t _state;
+	uint64_t _inc; // Always odd.
+};
+
+/// xoshiro128** by Blackman and Vigna, see http://prng.di.unimi.it
+/// Period 2^128 - 1. Slightly faster than Pcg32 on 32-bit hardware.
+/// We use the ** scrambler rather than + since Random relies on the low bits too.
+class Xoshiro128
 {
 public:
-	static Random& global() { return s_random; }
+	using result_type = uint32_t;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	/// The state is filled with splitmix64, so any seed (even 0) is fine.
+	explicit Xoshiro128(uint64_t seed = 0)
+	{
+		for (int i = 0; i < 4; i += 2) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			z = z ^ (z >> 31);
+			_s[i + 0] = uint32_t(z);
+			_s[i + 1] = uint32_t(z >> 32);
+		}
+	}
+
+	/// Continue from a state returned by state(). Must not be all zeros.
+	explicit Xoshiro128(const std::array<uint32_t, 4>& state)
+	{
+		for (int i = 0; i < 4; ++i) { _s[i] = state[i]; }
+	}
+
+	result_type operator()()
+	{
+		const uint32_t result = rotl(_s[1] * 5, 7) * 9;
+		const uint32_t t = _s[1] << 9;
+		_s[2] ^= _s[0];
+		_s[3] ^= _s[1];
+		_s[1] ^= _s[2];
+		_s[0] ^= _s[3];
+		_s[2] ^= t;
+		_s[3] = rotl(_s[3], 11);
+		return result;
+	}
+
+	/// Skip ahead 2^64 steps. Call repeatedly to get up to 2^64 non-overlapping sequences.
+	void jump()
+	{
+		static const uint32_t JUMP[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+		jump_with(JUMP);
+	}
+
+	/// Skip ahead 2^96 steps. Use to hand out starting points for jump().
+	void long_jump()
+	{
+		static const uint32_t LONG_JUMP[] = { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+		jump_with(LONG_JUMP);
+	}
+
+	std::array<uint32_t, 4> state() const { return {{ _s[0], _s[1], _s[2], _s[3] }}; }
+
+	friend bool operator==(const Xoshiro128& a, const Xoshiro128& b)
+	{
+		return a._s[0] == b._s[0] && a._s[1] == b._s[1] && a._s[2] == b._s[2] && a._s[3] == b._s[3];
+	}
+	friend bool operator!=(const Xoshiro128& a, const Xoshiro128& b) { return !(a == b); }
+
+private:
+	static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+	void jump_with(const uint32_t poly[4])
+	{
+		uint32_t s[4] = { 0, 0, 0, 0 };
+		for (int i = 0; i < 4; ++i) {
+			for (int b = 0; b < 32; ++b) {
+				if (poly[i] & (uint32_t(1) << b)) {
+					s[0] ^= _s[0];
+					s[1] ^= _s[1];
+					s[2] ^= _s[2];
+					s[3] ^= _s[3];
+				}
+				(*this)();
+			}
+		}
+		_s[0] = s[0];
+		_s[1] = s[1];
+		_s[2] = s[2];
+		_s[3] = s[3];
+	}
+
+	uint32_t _s[4];
+};
+
+/// Lookup tables for the ziggurat method (Marsaglia & Tsang 2000), 128 layers.
+struct ZigguratTables
+{
+	uint32_t kn[128];
+	float    wn[128];
+	float    fn[128];
+};
+const ZigguratTables& ziggurat_tables();
+
+/// Used for seeding default-constructed RandomT:s. Thread-safe.
+unsigned next_random_seed();
+
+/// The seed that all RandomT::thread_local_instance():s are derived from.
+/// Set it before spawning your threads to make a parallel simulation reproducible.
+uint64_t master_random_seed();
+void set_master_random_seed(uint64_t seed);
+
+/// Mixes the master seed with a thread index (splitmix64), so that nearby indices give unrelated seeds.
+uint64_t thread_random_seed(uint64_t master_seed, unsigned thread_index);
+
+/// 0, 1, 2, ... in order of first call. Thread-safe.
+unsigned next_random_thread_index();
+
+// ----------------------------------------------------------------------------
+
+/// Engine must produce 32 random bits per call, like Pcg32, Xoshiro128 or std::mt19937.
+/// The default (emath::Random) is RandomT<Pcg32>.
+template<typename Engine>
+class RandomT
+{
+public:
+	static_assert(Engine::min() == 0 && Engine::max() == 0xFFFFFFFFu, "Engine must produce 32 bits");
+
+	/// A single shared instance. NOT thread-safe: use thread_local_instance() from worker threads.
+	static RandomT& global()
+	{
+		static RandomT s_random;
+		return s_random;
+	}
+
+	/// One instance per thread, seeded with thread_random_seed(master_random_seed(), index).
+	/// The index is handed out in order of first use, which depends on thread scheduling.
+	/// For fully reproducible results, call seed_thread_local_instance() first in each worker.
+	static RandomT& thread_local_instance()
+	{
+		thread_local RandomT s_random(thread_random_seed(master_random_seed(), next_random_thread_index()));
+		return s_random;
+	}
+
+	/// Re-seed the calling thread's thread_local_instance() from the master seed and your own index,
+	/// e.g. the worker index in your job system.
+	static void seed_thread_local_instance(unsigned thread_index)
+	{
+		thread_local_instance() = RandomT(thread_random_seed(master_random_seed(), thread_index));
+	}
 
 	// ------------------------------------------------
 
-	Random() : _rand(s_seed++) {}
-	explicit Random(size_t seed) : _rand(seed) {}
-	explicit Random(const char* seed); // Will hash 'seed'
+	RandomT() : _rand(next_random_seed()) {}
+	explicit RandomT(uint64_t seed) : _rand(seed) {}
+	explicit RandomT(const char* seed) : RandomT((unsigned)std::hash<const char*>()(seed)) {} // Will hash 'seed'
+	explicit RandomT(const Engine& engine) : _rand(engine) {}
+
+	Engine& engine() { return _rand; }
+	const Engine& engine() const { return _rand; }
+
+	/// Skip ahead a long way in the sequence (see Engine::jump). Only for engines that support it.
+	/// To give N threads non-overlapping sequences: copy, jump, copy, jump, ...
+	void jump() { _rand.jump(); }
 
 	/// [0,1)
 	inline float random_float()
 	{
-		return _rand() / (_rand.max() + 1.0f);
+		// Only 24 bits fit in the mantissa. Dividing all 32 bits by 2^32 could round up to 1.
+		return float(uint32_t(_rand()) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/// out[i] = random_float()
+	void fill_floats(float* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = float(uint32_t(_rand()) >> 8) * (1.0f / 16777216.0f);
+		}
 	}
 
 	/// [0,max)
@@ -74,11 +309,23 @@ public:
 	// Gaussian distribution with mean=0 and variance=1
 	float random_normal()
 	{
-		return _normal(_rand);
+		const ZigguratTables& zig = ziggurat_tables();
+		const int32_t hz = int32_t(uint32_t(_rand()));
+		const uint32_t iz = uint32_t(hz) & 127;
+		if (abs_u32(hz) < zig.kn[iz]) {
+			return float(hz) * zig.wn[iz]; // ~99% of the time
+		}
+		return normal_tail(hz, iz);
 	}
 
 	/// Returns random point with norm() <= 1.
-	Vec2f random_unit_circle();
+	Vec2f random_unit_circle()
+	{
+		for (;;) {
+			Vec2f v = { random_interval(-1.0f, +1.0f), random_interval(-1.0f, +1.0f) };
+			if (length_sq(v) <= 1.0f) { return v; }
+		}
+	}
 
 	inline Vec2f random_normal_vec2()
 	{
@@ -104,7 +351,7 @@ public:
 
 	inline bool random_bool()
 	{
-		return (_rand() & 1)!=0;
+		return (uint32_t(_rand()) >> 31) != 0;
 	}
 
 	template<class List>
@@ -115,20 +362,73 @@ public:
 	}
 
 	// Colors:
-	Vec3f dark_rgb();
+	Vec3f dark_rgb()
+	{
+		for (;;) {
+			Vec3f rgb = { random_float(), random_float(), random_float() };
+			if (rgb_intensity(rgb) < 0.3f) { return rgb; }
+		}
+	}
+
 	Vec4f dark_rgba()   { return {dark_rgb(),   1.0f}; }
-	Vec3f bright_rgb();
+
+	Vec3f bright_rgb()
+	{
+		for (;;) {
+			Vec3f rgb = { random_float(), random_float(), random_float() };
+			if (rgb_intensity(rgb) > 0.5f) { return rgb; }
+		}
+	}
+
 	Vec4f bright_rgba() { return {bright_rgb(), 1.0f}; }
 
 private:
-	using MyRNG  = std::mt19937;
-	using Normal = std::normal_distribution<float>;
+	static uint32_t abs_u32(int32_t x) { return x < 0 ? 0u - uint32_t(x) : uint32_t(x); }
 
-	MyRNG  _rand;
-	Normal _normal;
+	static float rgb_intensity(const Vec3f& v)
+	{
+		return 0.3f*v.r + 0.59f*v.g + 0.11f*v.b;
+	}
+
+	/// (0,1), never zero so we can take the log of it.
+	float random_float_open()
+	{
+		return (float(uint32_t(_rand()) >> 8) + 0.5f) * (1.0f / 16777216.0f);
+	}
 
-	static unsigned s_seed;
-	static Random s_random;
+	/// The slow path of random_normal: the base strip, or the wedges between the boxes.
+	float normal_tail(int32_t hz, uint32_t iz)
+	{
+		const ZigguratTables& zig = ziggurat_tables();
+		const float r = 3.442620f; // Start of the right tail.
+
+		for (;;) {
+			const float x = float(hz) * zig.wn[iz];
+			if (iz == 0) {
+				float tx, ty;
+				do {
+					tx = -std::log(random_float_open()) / r;
+					ty = -std::log(random_float_open());
+				} while (ty + ty < tx * tx);
+				return hz > 0 ? r + tx : -r - tx;
+			}
+			if (zig.fn[iz] + random_float_open() * (zig.fn[iz - 1] - zig.fn[iz]) < std::exp(-0.5f * x * x)) {
+				return x;
+			}
+
+			hz = int32_t(uint32_t(_rand()));
+			iz = uint32_t(hz) & 127;
+			if (abs_u32(hz) < zig.kn[iz]) {
+				return float(hz) * zig.wn[iz];
+			}
+		}
+	}
+
+	Engine _rand;
 };
 
+/// The old default, with 2.5 kB of state.
+using RandomMT       = RandomT<std::mt19937>;
+using RandomXoshiro  = RandomT<Xoshiro128>;
+
 } // namespace emath
@@ -0,0 +1,173 @@
+#pragma once
+
+/*
+ Compile-time detection of the SIMD instruction sets used by the batch kernels.
+ Everything vectorized in emath also has a scalar path, so this only decides
+ which path gets compiled in.
+
+ Define EMATH_NO_SIMD to force the scalar paths (e.g. for debugging).
+
+ EMATH_BMI2 (pdep/pext, used by morton.hpp) is only used on x86-64. These instructions are
+ very slow on AMD CPUs before Zen 3, so you can define EMATH_NO_BMI2 to avoid them there.
+ */
+
+#if !defined(EMATH_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define EMATH_SSE2 1
+	#endif
+	#if defined(__AVX__)
+		#define EMATH_AVX 1
+	#endif
+	#if defined(__FMA__)
+		#define EMATH_FMA 1
+	#endif
+	#if (defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))) && (defined(__x86_64__) || defined(_M_X64)) && !defined(EMATH_NO_BMI2)
+		#define EMATH_BMI2 1
+	#endif
+#endif
+
+#ifndef EMATH_SSE2
+	#define EMATH_SSE2 0
+#endif
+#ifndef EMATH_AVX
+	#define EMATH_AVX 0
+#endif
+#ifndef EMATH_FMA
+	#define EMATH_FMA 0
+#endif
+#ifndef EMATH_BMI2
+	#define EMATH_BMI2 0
+#endif
+
+#if EMATH_SSE2 || EMATH_AVX || EMATH_BMI2
+	#include <cstdint>
+	#include <cstring>
+	#include <immintrin.h>
+#endif
+
+#if EMATH_AVX
+	#define EMATH_SIMD_WIDTH 8
+#elif EMATH_SSE2
+	#define EMATH_SIMD_WIDTH 4
+#else
+	#define EMATH_SIMD_WIDTH 1
+#endif
+
+namespace emath {
+namespace simd {
+
+// ----------------------------------------------------------------------------
+// A thin wrapper over the widest available float vector, so that kernels can
+// be written once for both SSE (4 lanes) and AVX (8 lanes).
+
+constexpr int WIDTH = EMATH_SIMD_WIDTH;
+
+#if EMATH_AVX
+	using floatv = __m256;
+
+	inline floatv load(const float* p)           { return _mm256_loadu_ps(p); }
+	inline void   store(float* p, floatv v)      { _mm256_storeu_ps(p, v); }
+	inline floatv set1(float f)                  { return _mm256_set1_ps(f); }
+	inline floatv zero()                         { return _mm256_setzero_ps(); }
+	inline floatv add(floatv a, floatv b)        { return _mm256_add_ps(a, b); }
+	inline floatv sub(floatv a, floatv b)        { return _mm256_sub_ps(a, b); }
+	inline floatv mul(floatv a, floatv b)        { return _mm256_mul_ps(a, b); }
+	inline floatv div(floatv a, floatv b)        { return _mm256_div_ps(a, b); }
+	inline floatv min(floatv a, floatv b)        { return _mm256_min_ps(a, b); }
+	inline floatv max(floatv a, floatv b)        { return _mm256_max_ps(a, b); }
+	inline floatv cmp_lt(floatv a, floatv b)     { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline floatv cmp_le(floatv a, floatv b)     { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline floatv cmp_gt(floatv a, floatv b)     { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	inline floatv cmp_ge(floatv a, floatv b)     { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline floatv bit_or(floatv a, floatv b)     { return _mm256_or_ps(a, b); }
+	inline floatv bit_and(floatv a, floatv b)    { return _mm256_and_ps(a, b); }
+	inline floatv bit_andnot(floatv a, floatv b) { return _mm256_andnot_ps(a, b); } ///< ~a & b
+	inline int    movemask(floatv v)             { return _mm256_movemask_ps(v); }
+	inline floatv floor(floatv v)                { return _mm256_floor_ps(v); }
+	inline floatv sqrt(floatv v)                 { return _mm256_sqrt_ps(v); }
+	inline floatv select(floatv mask, floatv a, floatv b) { return _mm256_blendv_ps(b, a, mask); } ///< mask ? a : b
+
+	/// Transposes the 8x8 matrix whose rows are rows[0..7], in registers.
+	inline void transpose_square(floatv rows[8])
+	{
+		const __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+		const __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+		const __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+		const __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+		const __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+		const __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+		const __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+		const __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+		const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+		rows[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+		rows[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+		rows[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+		rows[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+		rows[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+		rows[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+		rows[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+		rows[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+	}
+#elif EMATH_SSE2
+	using floatv = __m128;
+
+	inline floatv load(const float* p)           { return _mm_loadu_ps(p); }
+	inline void   store(float* p, floatv v)      { _mm_storeu_ps(p, v); }
+	inline floatv set1(float f)                  { return _mm_set1_ps(f); }
+	inline floatv zero()                         { return _mm_setzero_ps(); }
+	inline floatv add(floatv a, floatv b)        { return _mm_add_ps(a, b); }
+	inline floatv sub(floatv a, floatv b)        { return _mm_sub_ps(a, b); }
+	inline floatv mul(floatv a, floatv b)        { return _mm_mul_ps(a, b); }
+	inline floatv div(floatv a, floatv b)        { return _mm_div_ps(a, b); }
+	inline floatv min(floatv a, floatv b)        { return _mm_min_ps(a, b); }
+	inline floatv max(floatv a, floatv b)        { return _mm_max_ps(a, b); }
+	inline floatv cmp_lt(floatv a, floatv b)     { return _mm_cmplt_ps(a, b); }
+	inline floatv cmp_le(floatv a, floatv b)     { return _mm_cmple_ps(a, b); }
+	inline floatv cmp_gt(floatv a, floatv b)     { return _mm_cmpgt_ps(a, b); }
+	inline floatv cmp_ge(floatv a, floatv b)     { return _mm_cmpge_ps(a, b); }
+	inline floatv bit_or(floatv a, floatv b)     { return _mm_or_ps(a, b); }
+	inline floatv bit_and(floatv a, floatv b)    { return _mm_and_ps(a, b); }
+	inline floatv bit_andnot(floatv a, floatv b) { return _mm_andnot_ps(a, b); } ///< ~a & b
+	inline int    movemask(floatv v)             { return _mm_movemask_ps(v); }
+	inline floatv sqrt(floatv v)                 { return _mm_sqrt_ps(v); }
+	inline floatv select(floatv mask, floatv a, floatv b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); } ///< mask ? a : b
+
+	/// Transposes the 4x4 matrix whose rows are rows[0..3], in registers.
+	inline void transpose_square(floatv rows[4])
+	{
+		_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+	}
+
+	/// SSE2 has no floor: truncate, then step down where that rounded up. Valid for |v| < 2^31.
+	inline floatv floor(floatv v)
+	{
+		const floatv t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+		return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+	}
+#endif
+
+#if EMATH_SIMD_WIDTH > 1
+	/// Clears the sign bit.
+	inline floatv abs(floatv v) { return bit_andnot(set1(-0.0f), v); }
+
+	/// Lane i is all ones if bit i is set, else zero.
+	inline floatv mask_from_bits(unsigned bits)
+	{
+		alignas(32) float lanes[WIDTH];
+		for (int i = 0; i < WIDTH; ++i) {
+			const uint32_t pattern = ((bits >> i) & 1) ? 0xFFFFFFFFu : 0u;
+			std::memcpy(&lanes[i], &pattern, sizeof(float));
+		}
+		return load(lanes);
+	}
+#endif
+
+} // namespace simd
+} // namespace emath
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <loguru.hpp>
+
+#include "aabb.hpp"
+#include "aabb3.hpp"
+#include "hash.hpp"
+#include "vec2.hpp"
+#include "vec3.hpp"
+
+namespace emath {
+
+template<int DIM> struct SpatialHashTraits;
+template<> struct SpatialHashTraits<2> { using V = Vec2f; using Cell = Vec2i; using AABB = AABB2f; };
+template<> struct SpatialHashTraits<3> { using V = Vec3f; using Cell = Vec3i; using AABB = AABB3f; };
+
+/*
+ A uniform grid over an unbounded 2D or 3D world, for finding the entities near a point.
+ Only the cells that have something in them take up memory.
+
+ Entities are points, identified by an index of your choosing. Each cell keeps its entities
+ (index and position) in a flat array, and the cells are found via an open addressing hash
+ table keyed on the integer cell coordinate.
+
+ Pick a cell size around the typical query radius: much smaller and the queries visit many
+ cells, much bigger and they test many entities that are too far away.
+
+ The positions passed to remove() and move() must be the ones the entity was last given.
+ */
+template<int DIM>
+class SpatialHash
+{
+public:
+	using V     = typename SpatialHashTraits<DIM>::V;
+	using Cell  = typename SpatialHashTraits<DIM>::Cell;
+	using AABB  = typename SpatialHashTraits<DIM>::AABB;
+	using Index = uint32_t;
+
+	struct Entry
+	{
+		Index id;
+		V     pos;
+	};
+
+	explicit SpatialHash(float cell_size = 1) : _cell_size(cell_size), _inv_cell_size(1 / cell_size)
+	{
+		CHECK_F(cell_size > 0, "Bad cell size: %f", cell_size);
+	}
+
+	float cell_size() const { return _cell_size; }
+
+	Cell cell_of(const V& pos) const
+	{
+		Cell c;
+		for (int d = 0; d < DIM; ++d) {
+			c[d] = cell_coord(pos[d]);
+		}
+		return c;
+	}
+
+	// ------------------------------------------------
+
+	void insert(Index id, const V& pos)
+	{
+		for (int d = 0; d < DIM; ++d) {
+			DCHECK_F(std::isfinite(pos[d]), "Bad position");
+		}
+		_cells[find_or_add_cell(cell_of(pos))].push_back(Entry{id, pos});
+		_num_entities += 1;
+	}
+
+	/// Returns false if there was no such entity at that position.
+	bool remove(Index id, const V& pos)
+	{
+		const size_t b = find_bucket(cell_of(pos));
+		if (b == NOT_FOUND) { return false; }
+		std::vector<Entry>& entries = _cells[_buckets[b].cell];
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (entries[i].id == id) {
+				entries[i] = entries.back();
+				entries.pop_back();
+				_num_entities -= 1;
+				if (entries.empty()) {
+					erase_bucket(b);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Cheap when the entity stays in the same cell.
+	void move(Index id, const V& old_pos, const V& new_pos)
+	{
+		const Cell old_cell = cell_of(old_pos);
+		if (old_cell == cell_of(new_pos)) {
+			const size_t b = find_bucket(old_cell);
+			if (b != NOT_FOUND) {
+				for (Entry& e : _cells[_buckets[b].cell]) {
+					if (e.id == id) {
+						e.pos = new_pos;
+						return;
+					}
+				}
+			}
+			CHECK_F(false, "No entity %u at the old position", id);
+		} else {
+			CHECK_F(remove(id, old_pos), "No entity %u at the old position", id);
+			insert(id, new_pos);
+		}
+	}
+
+	/// Removes everything, but keeps the memory.
+	void clear()
+	{
+		for (Bucket& b : _buckets) {
+			if (b.cell != EMPTY) {
+				_cells[b.cell].clear();
+				_free_cells.push_back(b.cell);
+				b.cell = EMPTY;
+			}
+		}
+		_num_cells    = 0;
+		_num_entities = 0;
+	}
+
+	/// Number of entities.
+	size_t size()      const { return _num_entities; }
+	bool   empty()     const { return _num_entities == 0; }
+	size_t num_cells() const { return _num_cells; }
+
+	/// The entities in the given cell, or nullptr if there are none.
+	const Entry* cell_entries(const Cell& c, size_t* out_count) const
+	{
+		const size_t b = find_bucket(c);
+		if (b == NOT_FOUND) {
+			*out_count = 0;
+			return nullptr;
+		}
+		const std::vector<Entry>& entries = _cells[_buckets[b].cell];
+		*out_count = entries.size();
+		return entries.data();
+	}
+
+	// ------------------------------------------------
+	// Queries. These append to 'out', in no particular order.
+
+	/// Every entity at most 'radius' away from 'center'.
+	void query_radius(const V& center, float radius, std::vector<Index>* out) const
+	{
+		CHECK_NOTNULL_F(out);
+		const float radius_sq = radius * radius;
+		for_each_in(AABB::from_center_size(center, V(2 * radius)), [&](const Entry& e) {
+			if (distance_sq(e.pos, center) <= radius_sq) {
+				out->push_back(e.id);
+			}
+		});
+	}
+
+	/// Every entity inside the box (edges included).
+	void query_aabb(const AABB& box, std::vector<Index>* out) const
+	{
+		CHECK_NOTNULL_F(out);
+		for_each_in(box, [&](const Entry& e) {
+			if (box.contains(e.pos)) {
+				out->push_back(e.id);
+			}
+		});
+	}
+
+	/// Calls fun(const Entry&) for every entity in the cells the box touches,
+	/// which includes some entities outside of the box.
+	template<typename Fun>
+	void for_each_in(const AABB& box, const Fun& fun) const
+	{
+		if (_num_cells == 0) { return; }
+
+		const Cell lo = cell_of(box.min());
+		const Cell hi = cell_of(box.max());
+		double num_query_cells = 1;
+		for (int d = 0; d < DIM; ++d) {
+			if (hi[d] < lo[d]) { return; }
+			num_query_cells *= double(hi[d]) - double(lo[d]) + 1;
+		}
+
+		if (num_query_cells > double(_buckets.size())) {
+			// Cheaper to go through all the cells we have:
+			for (const Bucket& b : _buckets) {
+				if (b.cell != EMPTY && is_in_range(b.key, lo, hi)) {
+					for (const Entry& e : _cells[b.cell]) { fun(e); }
+				}
+			}
+			return;
+		}
+
+		Cell c = lo;
+		for (;;) {
+			const size_t b = find_bucket(c);
+			if (b != NOT_FOUND) {
+				for (const Entry& e : _cells[_buckets[b].cell]) { fun(e); }
+			}
+			// Next cell, x fastest:
+			int d = 0;
+			for (; d < DIM; ++d) {
+				if (c[d] < hi[d]) { c[d] += 1; break; }
+				c[d] = lo[d];
+			}
+			if (d == DIM) { break; }
+		}
+	}
+
+private:
+	static constexpr uint32_t EMPTY     = ~uint32_t(0);
+	static constexpr size_t   NOT_FOUND = ~size_t(0);
+
+	struct Bucket
+	{
+		Cell     key;
+		uint32_t cell = EMPTY; // Into _cells
+	};
+
+	int cell_coord(float f) const
+	{
+		// Clamped so that huge query boxes don't overflow the int:
+		const float c = std::floor(f * _inv_cell_size);
+		return int(std::max(-1e9f, std::min(c, 1e9f)));
+	}
+
+	static bool is_in_range(const Cell& c, const Cell& lo, const Cell& hi)
+	{
+		for (int d = 0; d < DIM; ++d) {
+			if (c[d] < lo[d] || hi[d] < c[d]) { return false; }
+		}
+		return true;
+	}
+
+	size_t home_bucket(const Cell& key) const { return size_t(hash_cell(key)) & (_buckets.size() - 1); }
+
+	size_t find_bucket(const Cell& key) const
+	{
+		if (_buckets.empty()) { return NOT_FOUND; }
+		const size_t mask = _buckets.size() - 1;
+		for (size_t i = home_bucket(key); ; i = (i + 1) & mask) {
+			if (_buckets[i].cell == EMPTY) { return NOT_FOUND; }
+			if (_buckets[i].key == key)    { return i; }
+		}
+	}
+
+	uint32_t find_or_add_cell(const Cell& key)
+	{
+		// At most half full, so the probe sequences stay short:
+		if (2 * (_num_cells + 1) > _buckets.size()) {
+			rehash(std::max<size_t>(16, 2 * _buckets.size()));
+		}
+
+		const size_t mask = _buckets.size() - 1;
+		size_t i = home_bucket(key);
+		for (; _buckets[i].cell != EMPTY; i = (i + 1) & mask) {
+			if (_buckets[i].key == key) { return _buckets[i].cell; }
+		}
+
+		// Reuse the memory of a cell that was emptied:
+		uint32_t cell;
+		if (_free_cells.empty()) {
+			cell = uint32_t(_cells.size());
+			_cells.emplace_back();
+		} else {
+			cell = _free_cells.back();
+			_free_cells.pop_back();
+		}
+		_buckets[i].key  = key;
+		_buckets[i].cell = cell;
+		_num_cells += 1;
+		return cell;
+	}
+
+	/// Linear probing without tombstones: move later entries of the probe sequence back into the hole.
+	void erase_bucket(size_t hole)
+	{
+		_free_cells.push_back(_buckets[hole].cell);
+		_num_cells -= 1;
+
+		const size_t mask = _buckets.size() - 1;
+		for (size_t i = (hole + 1) & mask; _buckets[i].cell != EMPTY; i = (i + 1) & mask) {
+			// Can the entry at i move to the hole without ending up before its home?
+			const size_t home = home_bucket(_buckets[i].key);
+			if (((i - home) & mask) >= ((i - hole) & mask)) {
+				_buckets[hole] = _buckets[i];
+				hole = i;
+			}
+		}
+		_buckets[hole].cell = EMPTY;
+	}
+
+	void rehash(size_t num_buckets)
+	{
+		DCHECK_F(is_power_of_two(num_buckets));
+		std::vector<Bucket> old(num_buckets);
+		old.swap(_buckets);
+		const size_t mask = num_buckets - 1;
+		for (const Bucket& b : old) {
+			if (b.cell == EMPTY) { continue; }
+			size_t i = home_bucket(b.key);
+			while (_buckets[i].cell != EMPTY) { i = (i + 1) & mask; }
+			_buckets[i] = b;
+		}
+	}
+
+	float                           _cell_size;
+	float                           _inv_cell_size;
+	std::vector<Bucket>             _buckets;    // Power-of-two many.
+	std::vector<std::vector<Entry>> _cells;      // Indexed by Bucket::cell.
+	std::vector<uint32_t>           _free_cells; // Empty cells whose memory can be reused.
+	size_t                          _num_cells    = 0;
+	size_t                          _num_entities = 0;
+};
+
+using SpatialHash2 = SpatialHash<2>;
+using SpatialHash3 = SpatialHash<3>;
+
+} // namespace emath
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include <loguru.hpp>
+
+#include "matrix.hpp"
+
+namespace emath {
+
+/*
+ Sum of any axis-aligned rectangle of a matrix in O(1), after an O(width * height) build.
+ Also known as an integral image.
+
+ Sums are accumulated in double for floating point input, and in int64_t for integers,
+ so they don't lose precision (or overflow) over big matrices.
+
+ Rectangles are given as (x, y, width, height), like Matrix::sub().
+ */
+template<typename T>
+class SummedAreaTable
+{
+public:
+	using accumulator_type = typename std::conditional<std::is_floating_point<T>::value, double, int64_t>::type;
+	using Acc = accumulator_type;
+
+	SummedAreaTable() = default;
+	explicit SummedAreaTable(ConstMatrixView<T> m) { build(m); }
+
+	void build(ConstMatrixView<T> m)
+	{
+		// One extra row and column of zeros in front, so no lookup needs a special case.
+		_table.resize_discard(m.width() + 1, m.height() + 1);
+		std::fill(_table.row_ptr(0), _table.row_ptr(0) + _table.width(), Acc(0));
+		for (int y = 0; y < m.height(); ++y) {
+			const T*   src   = m.row_ptr(y);
+			const Acc* above = _table.row_ptr(y);
+			Acc*       out   = _table.row_ptr(y + 1);
+			Acc row_sum = 0;
+			out[0] = 0;
+			for (int x = 0; x < m.width(); ++x) {
+				row_sum += src[x];
+				out[x + 1] = above[x + 1] + row_sum;
+			}
+		}
+	}
+
+	int width()  const { return std::max(0, _table.width()  - 1); }
+	int height() const { return std::max(0, _table.height() - 1); }
+
+	/// Sum of the rectangle [x, x + w) x [y, y + h), which must be inside the matrix.
+	Acc sum(int x, int y, int w, int h) const
+	{
+		DCHECK_F(0 <= x && 0 <= w && x + w <= width(),  "Bad columns [%d, %d) of %d", x, x + w, width());
+		DCHECK_F(0 <= y && 0 <= h && y + h <= height(), "Bad rows [%d, %d) of %d", y, y + h, height());
+		return _table(x + w, y + h) - _table(x, y + h) - _table(x + w, y) + _table(x, y);
+	}
+
+	/// Sum of the part of the rectangle that is inside the matrix.
+	/// If 'out_count' is given, it is set to the number of elements that were summed.
+	Acc sum_clamped(int x, int y, int w, int h, int* out_count = nullptr) const
+	{
+		const int x0 = std::max(x, 0), x1 = std::min(x + w, width());
+		const int y0 = std::max(y, 0), y1 = std::min(y + h, height());
+		if (x1 <= x0 || y1 <= y0) {
+			if (out_count) { *out_count = 0; }
+			return 0;
+		}
+		if (out_count) { *out_count = (x1 - x0) * (y1 - y0); }
+		return sum(x0, y0, x1 - x0, y1 - y0);
+	}
+
+	/// Average over the part of the rectangle that is inside the matrix, or 0 if none of it is.
+	double mean_clamped(int x, int y, int w, int h) const
+	{
+		int count;
+		const Acc s = sum_clamped(x, y, w, h, &count);
+		return count > 0 ? double(s) / count : 0.0;
+	}
+
+	/// Sum of the whole matrix.
+	Acc total() const { return sum(0, 0, width(), height()); }
+
+	/// The raw table, (width + 1) x (height + 1): table(x, y) is the sum of [0, x) x [0, y).
+	const Matrix<Acc>& table() const { return _table; }
+
+private:
+	Matrix<Acc> _table;
+};
+
+} // namespace emath
@@ -0,0 +1,215 @@
+#include "sweep_and_prune.hpp"
+
+#include <algorithm>
+#include <loguru.hpp>
+
+#include "simd.hpp"
+
+namespace emath {
+
+namespace {
+
+/// Ends go before begins at the same x, so boxes that only touch are not reported.
+inline bool endpoint_less(float a_value, uint32_t a_data, float b_value, uint32_t b_data)
+{
+	return a_value < b_value || (a_value == b_value && (a_data & 1) < (b_data & 1));
+}
+
+} // namespace
+
+void SweepAndPrune::ActiveSet::clear()
+{
+	min_x.clear();
+	max_x.clear();
+	min_y.clear();
+	max_y.clear();
+	handle.clear();
+}
+
+void SweepAndPrune::ActiveSet::push_back(const AABB2f& box, Handle h)
+{
+	min_x.push_back(box.min().x);
+	max_x.push_back(box.max().x);
+	min_y.push_back(box.min().y);
+	max_y.push_back(box.max().y);
+	handle.push_back(h);
+}
+
+void SweepAndPrune::ActiveSet::swap_remove(size_t index)
+{
+	min_x[index]  = min_x.back();  min_x.pop_back();
+	max_x[index]  = max_x.back();  max_x.pop_back();
+	min_y[index]  = min_y.back();  min_y.pop_back();
+	max_y[index]  = max_y.back();  max_y.pop_back();
+	handle[index] = handle.back(); handle.pop_back();
+}
+
+// ----------------------------------------------------------------------------
+
+SweepAndPrune::Handle SweepAndPrune::add(const AABB2f& box)
+{
+	DCHECK_F(box.min().x == box.min().x && box.max().x == box.max().x, "NaN box");
+
+	Handle h;
+	if (_free.empty()) {
+		CHECK_F(_slots.size() < (INVALID_HANDLE >> 1), "Too many boxes");
+		h = Handle(_slots.size());
+		_slots.emplace_back();
+	} else {
+		h = _free.back();
+		_free.pop_back();
+	}
+	_slots[h].box          = box;
+	_slots[h].active_index = INVALID_HANDLE;
+	_slots[h].alive        = true;
+
+	_endpoints.push_back(Endpoint{box.min().x, (h << 1) | 1});
+	_endpoints.push_back(Endpoint{box.max().x, (h << 1)});
+	_num_unsorted += 2;
+	_num_boxes += 1;
+	return h;
+}
+
+void SweepAndPrune::remove(Handle h)
+{
+	CHECK_F(is_valid(h), "Bad handle: %u", h);
+	_slots[h].alive = false;
+	_removed.push_back(h);
+	_num_boxes -= 1;
+}
+
+void SweepAndPrune::update(Handle h, const AABB2f& box)
+{
+	DCHECK_F(is_valid(h), "Bad handle: %u", h);
+	DCHECK_F(box.min().x == box.min().x && box.max().x == box.max().x, "NaN box");
+	_slots[h].box = box;
+	_moved = true;
+}
+
+void SweepAndPrune::clear()
+{
+	_slots.clear();
+	_endpoints.clear();
+	_free.clear();
+	_removed.clear();
+	_num_boxes    = 0;
+	_num_unsorted = 0;
+	_moved        = false;
+}
+
+void SweepAndPrune::sort_endpoints()
+{
+	if (!_removed.empty()) {
+		_endpoints.erase(std::remove_if(_endpoints.begin(), _endpoints.end(), [this](const Endpoint& e) {
+			return !_slots[e.data >> 1].alive;
+		}), _endpoints.end());
+		_free.insert(_free.end(), _removed.begin(), _removed.end());
+		_removed.clear();
+		_num_unsorted = std::min(_num_unsorted, _endpoints.size());
+	}
+
+	if (_moved) {
+		for (Endpoint& e : _endpoints) {
+			const AABB2f& box = _slots[e.data >> 1].box;
+			e.value = (e.data & 1) ? box.min().x : box.max().x;
+		}
+	}
+
+	_last_num_moves = 0;
+
+	// Inserting many new boxes one by one would be O(n) each, so sort from scratch instead:
+	if (_num_unsorted > 64 && _num_unsorted * 8 > _endpoints.size()) {
+		std::sort(_endpoints.begin(), _endpoints.end(), [](const Endpoint& a, const Endpoint& b) {
+			return endpoint_less(a.value, a.data, b.value, b.data);
+		});
+		_last_num_moves = _endpoints.size();
+	} else if (_moved || _num_unsorted > 0) {
+		Endpoint* e = _endpoints.data();
+		const size_t n = _endpoints.size();
+		const size_t begin = _moved ? 1 : n - _num_unsorted;
+		for (size_t i = std::max<size_t>(begin, 1); i < n; ++i) {
+			const Endpoint key = e[i];
+			size_t j = i;
+			while (j > 0 && endpoint_less(key.value, key.data, e[j - 1].value, e[j - 1].data)) {
+				e[j] = e[j - 1];
+				--j;
+			}
+			e[j] = key;
+			_last_num_moves += i - j;
+		}
+	}
+
+	_num_unsorted = 0;
+	_moved = false;
+}
+
+/// Adds a pair for every active box that overlaps 'box' (as in AABB2f::intersects).
+/// The x test only matters for boxes with min.x >= max.x; the sweep takes care of the rest.
+void SweepAndPrune::find_overlaps(const AABB2f& box, Handle h, std::vector<Pair>* out) const
+{
+	const size_t n = _active.size();
+	size_t i = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+
+	const floatv a_min_x = set1(box.min().x), a_max_x = set1(box.max().x);
+	const floatv a_min_y = set1(box.min().y), a_max_y = set1(box.max().y);
+
+	// Overlaps are rare, so test WIDTH boxes at once and only look closer at the hits:
+	for (; i + WIDTH <= n; i += WIDTH) {
+		floatv miss =         cmp_le(a_max_x, load(&_active.min_x[i]));
+		miss = bit_or(miss,   cmp_le(load(&_active.max_x[i]), a_min_x));
+		miss = bit_or(miss,   cmp_le(a_max_y, load(&_active.min_y[i])));
+		miss = bit_or(miss,   cmp_le(load(&_active.max_y[i]), a_min_y));
+		unsigned hits = ~unsigned(movemask(miss)) & ((1u << WIDTH) - 1);
+		for (; hits != 0; hits &= hits - 1) {
+			int lane = 0;
+			while (((hits >> lane) & 1) == 0) { ++lane; }
+			const Handle other = _active.handle[i + lane];
+			out->push_back(h < other ? Pair{h, other} : Pair{other, h});
+		}
+	}
+#endif
+
+	for (; i < n; ++i) {
+		if (box.max().x <= _active.min_x[i] || _active.max_x[i] <= box.min().x ||
+		    box.max().y <= _active.min_y[i] || _active.max_y[i] <= box.min().y) {
+			continue;
+		}
+		const Handle other = _active.handle[i];
+		out->push_back(h < other ? Pair{h, other} : Pair{other, h});
+	}
+}
+
+void SweepAndPrune::find_pairs(std::vector<Pair>* out)
+{
+	CHECK_NOTNULL_F(out);
+	out->clear();
+	sort_endpoints();
+
+	// Sweep along x, keeping the boxes we are inside of in _active.
+	// Every box is tested against the ones that are active when it begins.
+	_active.clear();
+	for (const Endpoint& e : _endpoints) {
+		const Handle h = e.data >> 1;
+		Slot& slot = _slots[h];
+		if (e.data & 1) {
+			find_overlaps(slot.box, h, out);
+			// An empty (or inverted) box has already passed its end, so it can't overlap anything later.
+			if (slot.box.min().x < slot.box.max().x) {
+				slot.active_index = uint32_t(_active.size());
+				_active.push_back(slot.box, h);
+			}
+		} else if (slot.active_index != INVALID_HANDLE) {
+			const uint32_t index = slot.active_index;
+			_active.swap_remove(index);
+			if (index < _active.size()) {
+				_slots[_active.handle[index]].active_index = index;
+			}
+			slot.active_index = INVALID_HANDLE;
+		}
+	}
+}
+
+} // namespace emath
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aabb.hpp"
+
+namespace emath {
+
+/*
+ Broadphase for many moving boxes: finds all pairs that overlap (as in AABB2f::intersects)
+ without testing every pair against every other.
+
+ The begin and end x of every box are kept in one sorted array. Boxes move little from one
+ frame to the next, so the array stays almost sorted, and re-sorting it with an insertion sort
+ is close to O(n). The overlapping pairs are then found in one sweep over the array.
+
+ Boxes are referred to by handles, which stay the same until the box is removed.
+ Handles of removed boxes are reused, but only after the next find_pairs().
+
+ Usage:
+	SweepAndPrune sap;
+	auto h = sap.add(box);
+	std::vector<SweepAndPrune::Pair> pairs;
+	for (each frame) {
+		sap.update(h, moved_box);
+		sap.find_pairs(&pairs);
+	}
+ */
+class SweepAndPrune
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle INVALID_HANDLE = ~Handle(0);
+
+	/// Two overlapping boxes, with a < b.
+	struct Pair
+	{
+		Handle a, b;
+	};
+
+	SweepAndPrune() = default;
+
+	Handle add(const AABB2f& box);
+	void   remove(Handle h);
+	void   update(Handle h, const AABB2f& box);
+
+	/// Removes all boxes. Handles start over from zero.
+	void clear();
+
+	bool          is_valid(Handle h) const { return h < _slots.size() && _slots[h].alive; }
+	const AABB2f& bounds(Handle h)   const { return _slots[h].box; }
+
+	/// Number of boxes.
+	size_t size()  const { return _num_boxes; }
+	bool   empty() const { return _num_boxes == 0; }
+
+	/// Clears 'out' and fills it with every pair of overlapping boxes, in no particular order.
+	/// Pass the same vector every frame to reuse its memory.
+	void find_pairs(std::vector<Pair>* out);
+
+	/// How many endpoints the insertion sort in the last find_pairs() moved.
+	/// A big number means the boxes moved a lot.
+	size_t last_num_moves() const { return _last_num_moves; }
+
+private:
+	struct Slot
+	{
+		AABB2f   box;
+		uint32_t active_index; // Into _active during the sweep, or INVALID_HANDLE.
+		bool     alive;
+	};
+
+	/// data is (handle << 1) | 1 for the min x of the box, (handle << 1) for the max x.
+	struct Endpoint
+	{
+		float    value;
+		uint32_t data;
+	};
+
+	/// The boxes we are inside of during the sweep, in SoA form so they can be tested in SIMD.
+	struct ActiveSet
+	{
+		std::vector<float>  min_x, max_x, min_y, max_y;
+		std::vector<Handle> handle;
+
+		size_t size() const { return handle.size(); }
+		void clear();
+		void push_back(const AABB2f& box, Handle h);
+		void swap_remove(size_t index);
+	};
+
+	void sort_endpoints();
+	void find_overlaps(const AABB2f& box, Handle h, std::vector<Pair>* out) const;
+
+	std::vector<Slot>      _slots;
+	std::vector<Endpoint>  _endpoints;       // Sorted by value, except for any added since the last find_pairs().
+	std::vector<Handle>    _free;            // Can be reused right away.
+	std::vector<Handle>    _removed;         // Reusable after their endpoints are gone.
+	ActiveSet              _active;
+	size_t                 _num_boxes      = 0;
+	size_t                 _num_unsorted   = 0; // Endpoints added at the end since the last sort.
+	bool                   _moved          = false;
+	size_t                 _last_num_moves = 0;
+};
+
+} // namespace emath
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <loguru.hpp>
+
+#include "allocator.hpp"
+#include "matrix.hpp"
+#include "morton.hpp"
+
+namespace emath {
+
+/*
+ A width x height grid with the same element access as Matrix, but a different memory layout.
+ The grid is split into TILE x TILE tiles (TILE = 1 << TILE_BITS) stored one after the other,
+ row by row, and within a tile the elements are in Morton (Z) order.
+
+ Any small neighborhood then spans only a few cache lines, in any direction. In a
+ row-major Matrix, neighbors above and below are a whole row apart. This helps with
+ stencils, and with random or 2D-local accesses such as random walks. For plain sweeps,
+ row by row or column by column, Matrix is faster: the prefetcher handles its fixed stride.
+
+ The tiles at the right and bottom edges are padded to full size.
+ Convert to and from Matrix with the constructor and to_matrix() / copy_to().
+ */
+template<typename T, int TILE_BITS = 3>
+class TiledMatrix
+{
+	static_assert(1 <= TILE_BITS && TILE_BITS <= 4, "Tiles are 2x2 to 16x16");
+
+public:
+	typedef T value_type;
+
+	static constexpr int TILE      = 1 << TILE_BITS;
+	static constexpr int TILE_SIZE = TILE * TILE; // Elements per tile
+
+	TiledMatrix() = default;
+
+	TiledMatrix(int width, int height, const T& value = T{})
+	{
+		resize_discard(width, height);
+		std::fill(_data.begin(), _data.end(), value);
+	}
+
+	explicit TiledMatrix(ConstMatrixView<T> m)
+	{
+		resize_discard(m.width(), m.height());
+		for (int y = 0; y < m.height(); ++y) {
+			const T* row = m.row_ptr(y);
+			for (int x = 0; x < m.width(); ++x) {
+				_data[index(x, y)] = row[x];
+			}
+		}
+	}
+
+	// ------------------------------------------------
+
+	bool empty() const { return _width == 0 || _height == 0; }
+	int width()  const { return _width;  } ///< The number of columns
+	int height() const { return _height; } ///< The number of rows
+	int size()   const { return _width * _height; } ///< width() * height()
+
+	int tiles_x() const { return _tiles_x; }
+	int tiles_y() const { return _tiles_y; }
+
+	/// All tiles, padding included: tiles_x() * tiles_y() * TILE_SIZE elements.
+	T*       data()       { return _data.data(); }
+	const T* data() const { return _data.data(); }
+
+	/// The first element of the tile with top-left corner (tx * TILE, ty * TILE).
+	T*       tile_ptr(int tx, int ty)       { return data() + size_t(ty * _tiles_x + tx) * TILE_SIZE; }
+	const T* tile_ptr(int tx, int ty) const { return data() + size_t(ty * _tiles_x + tx) * TILE_SIZE; }
+
+	bool contains_coord(int x, int y) const
+	{
+		return 0 <= x && x < _width && 0 <= y && y < _height;
+	}
+
+	bool contains_coord(const Vec2i& c) const { return contains_coord(c.x, c.y); }
+
+	/// Where (x, y) is in data().
+	/// The x and y parts of the index don't share any bits, so they are looked up separately and added.
+	size_t index(int x, int y) const
+	{
+		DCHECK_F(0 <= x && x < _width, "%d not in range [0, %d)", x, _width);
+		DCHECK_F(0 <= y && y < _height, "%d not in range [0, %d)", y, _height);
+		return size_t(_x_offsets[x]) + _y_offsets[y];
+	}
+
+	// ------------------------------------------------
+
+	/// (col, row)
+	T&       operator()(int x, int y)       { return _data[index(x, y)]; }
+	const T& operator()(int x, int y) const { return _data[index(x, y)]; }
+
+	T&       operator[](const Vec2i& v)       { return _data[index(v.x, v.y)]; }
+	const T& operator[](const Vec2i& v) const { return _data[index(v.x, v.y)]; }
+
+	T* pointer_to(int x, int y) { return &_data[index(x, y)]; }
+
+	// ------------------------------------------------
+
+	/// The contents are unspecified afterwards.
+	void resize_discard(int new_w, int new_h)
+	{
+		CHECK_F(new_w >= 0 && new_h >= 0, "Bad size: %d x %d", new_w, new_h);
+		_width   = new_w;
+		_height  = new_h;
+		_tiles_x = (new_w + TILE - 1) >> TILE_BITS;
+		_tiles_y = (new_h + TILE - 1) >> TILE_BITS;
+		const size_t num_elements = size_t(_tiles_x) * _tiles_y * TILE_SIZE;
+		CHECK_F(num_elements <= UINT32_MAX, "Too big: %d x %d", new_w, new_h);
+		_data.resize(num_elements);
+
+		_x_offsets.resize(new_w);
+		for (int x = 0; x < new_w; ++x) {
+			_x_offsets[x] = uint32_t((x >> TILE_BITS) * TILE_SIZE) | uint32_t(morton_spread_2(x & (TILE - 1)));
+		}
+		_y_offsets.resize(new_h);
+		for (int y = 0; y < new_h; ++y) {
+			_y_offsets[y] = uint32_t(size_t(y >> TILE_BITS) * _tiles_x * TILE_SIZE) | uint32_t(morton_spread_2(y & (TILE - 1)) << 1);
+		}
+	}
+
+	void fill(const T& value) { std::fill(_data.begin(), _data.end(), value); }
+
+	/// Back to row-major. 'dst' must be the same size.
+	void copy_to(MatrixView<T> dst) const
+	{
+		CHECK_F(dst.width() == _width && dst.height() == _height, "Size mismatch");
+		for (int y = 0; y < _height; ++y) {
+			T* row = dst.row_ptr(y);
+			for (int x = 0; x < _width; ++x) {
+				row[x] = _data[index(x, y)];
+			}
+		}
+	}
+
+	Matrix<T> to_matrix() const
+	{
+		Matrix<T> m(_width, _height);
+		copy_to(m.view());
+		return m;
+	}
+
+private:
+	std::vector<T, AlignedAllocator<T, 64>> _data;
+	std::vector<uint32_t> _x_offsets; // Tile column and Morton bits of x, for each x
+	std::vector<uint32_t> _y_offsets; // Tile row and Morton bits of y, for each y
+	int _width   = 0;
+	int _height  = 0;
+	int _tiles_x = 0;
+	int _tiles_y = 0;
+};
+
+} // namespace emath
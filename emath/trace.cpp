@@ -4,6 +4,7 @@
 
 #include "capsule.hpp"
 #include "circle.hpp"
+#include "simd.hpp"
 
 namespace emath {
 namespace trace {
@@ -43,11 +44,24 @@ bool ray_circle(info& ti, const Circle& c)
 
 #if 1
 
-	if (sign * sqr(a + ti.t    ) < sign * under_sq) {
-		return false; // Too far away
-	}
-	if (sign * sqr(a + ti.min_t) > sign * under_sq) {
-		return false; // Too close (i.e. behind us)
+	// The roots are at -a -/+ sqrt(under_sq). Comparing squares only tells us if a t is
+	// between the roots or not, so we also need the side of the midpoint (-a) it is on.
+	const float t_rel     = a + ti.t;
+	const float min_t_rel = a + ti.min_t;
+	if (entering) {
+		if (t_rel < 0 && sqr(t_rel) > under_sq) {
+			return false; // Too far away
+		}
+		if (min_t_rel >= 0 || sqr(min_t_rel) < under_sq) {
+			return false; // Too close (i.e. behind us)
+		}
+	} else {
+		if (t_rel < 0 || sqr(t_rel) < under_sq) {
+			return false; // Too far away
+		}
+		if (min_t_rel > 0 && sqr(min_t_rel) > under_sq) {
+			return false; // Too close (i.e. behind us)
+		}
 	}
 
 	// Find the root of interest:
@@ -127,7 +141,7 @@ bool ray_capsule(info& ti, const CapsuleBaked& cap)
 	const auto& N = cap.N;
 
 	// Transform ray to local capsule coords:
-	Vec2f R = ray.o - cap.p0;
+	Vec2f R = ray.o - cap.p[0];
 	Vec2f p = {dot(A, R    ),  dot(N, R    )};
 	Vec2f d = {dot(A, ray.d),  dot(N, ray.d)};
 
@@ -365,7 +379,7 @@ bool ray_circle_ccd(info& ti, const Circle& c_0, const Circle& c_1)
 	 */
 	float x = solve_X2_X_C(a, b, c, [=](float x0, float x1){ return sign*std::max(sign*x0, sign*x1); });
 
-	if (isfinite(x) && ti.min_t < x && x < ti.t) {
+	if (std::isfinite(x) && ti.min_t < x && x < ti.t) {
 		ti.t = x;
 		ti.normal_dir = (c0 + cd*x - ti.ray.at(x)); // The sign here is impossible to get right
 
@@ -379,5 +393,261 @@ bool ray_circle_ccd(info& ti, const Circle& c_0, const Circle& c_1)
 	}
 }
 
+//------------------------------------------------------------------------------
+// Ray packets.
+// The SIMD code below mirrors the entering path of the scalar functions above operation
+// by operation, so that each lane gets bit-identical results. Keep them in sync!
+
+info_packet::info_packet(const Ray* rays, int num_rays, float max_t, float min_t_)
+{
+	assert(0 <= num_rays && num_rays <= SIZE);
+	assert(0 <= min_t_);
+	for (int i = 0; i < num_rays; ++i) {
+		ox[i]    = rays[i].o.x;
+		oy[i]    = rays[i].o.y;
+		dx[i]    = rays[i].d.x;
+		dy[i]    = rays[i].d.y;
+		t[i]     = max_t;
+		min_t[i] = min_t_;
+		active  |= 1u << i;
+	}
+}
+
+void info_packet::set(int lane, const info& ti)
+{
+	assert(0 <= lane && lane < SIZE);
+	assert(ti.entering() && !ti.leaving());
+	ti.sanity_check();
+	ox[lane]    = ti.ray.o.x;
+	oy[lane]    = ti.ray.o.y;
+	dx[lane]    = ti.ray.d.x;
+	dy[lane]    = ti.ray.d.y;
+	t[lane]     = ti.t;
+	min_t[lane] = ti.min_t;
+	nx[lane]    = ti.normal_dir.x;
+	ny[lane]    = ti.normal_dir.y;
+	active     |= 1u << lane;
+}
+
+info info_packet::get(int lane) const
+{
+	assert(0 <= lane && lane < SIZE);
+	info ti(Ray{{ox[lane], oy[lane]}, {dx[lane], dy[lane]}}, t[lane]);
+	ti.min_t = min_t[lane];
+	ti.normal_dir = {nx[lane], ny[lane]};
+	return ti;
+}
+
+#if EMATH_SIMD_WIDTH > 1
+
+namespace {
+
+using namespace simd;
+
+struct Lanes
+{
+	floatv ox, oy, dx, dy, t, min_t, nx, ny;
+};
+
+Lanes load_lanes(const info_packet& tp, int i)
+{
+	return { load(tp.ox + i), load(tp.oy + i), load(tp.dx + i), load(tp.dy + i),
+	         load(tp.t + i), load(tp.min_t + i), load(tp.nx + i), load(tp.ny + i) };
+}
+
+void store_lanes(info_packet& tp, int i, const Lanes& l)
+{
+	store(tp.t + i, l.t);
+	store(tp.nx + i, l.nx);
+	store(tp.ny + i, l.ny);
+}
+
+/// Lanes that pass 'mask' and not 'reject'. Phrased like this so NaN:s behave like in the scalar code.
+inline floatv unless(floatv reject, floatv mask) { return bit_andnot(reject, mask); }
+
+/// ray_circle for the lanes in 'mask'. Returns the lanes that hit.
+floatv ray_circle_lanes(Lanes& l, floatv mask, const Circle& c)
+{
+	const floatv Rx = sub(l.ox, set1(c.p.x));
+	const floatv Ry = sub(l.oy, set1(c.p.y));
+	const floatv incl = add(mul(l.dx, Rx), mul(l.dy, Ry));
+
+	mask = unless(cmp_gt(incl, zero()), mask); // Not heading towards us
+	if (movemask(mask) == 0) { return mask; }
+
+	const floatv d2inv = div(set1(1.0f), add(mul(l.dx, l.dx), mul(l.dy, l.dy)));
+	const floatv a = mul(incl, d2inv);
+	const floatv b = mul(sub(add(mul(Rx, Rx), mul(Ry, Ry)), set1(sqr(c.rad))), d2inv);
+	const floatv under_sq = sub(mul(a, a), b);
+
+	mask = unless(cmp_le(under_sq, zero()), mask);
+
+	const floatv t_rel     = add(a, l.t);
+	const floatv min_t_rel = add(a, l.min_t);
+	mask = unless(bit_and(cmp_lt(t_rel, zero()), cmp_gt(mul(t_rel, t_rel), under_sq)), mask);
+	mask = unless(bit_or(cmp_ge(min_t_rel, zero()), cmp_lt(mul(min_t_rel, min_t_rel), under_sq)), mask);
+	if (movemask(mask) == 0) { return mask; }
+
+	const floatv x = sub(zero(), add(a, simd::sqrt(under_sq))); // -a - sqrt(under_sq)
+	mask = unless(cmp_le(x, l.min_t), mask);
+	mask = unless(cmp_gt(x, l.t), mask);
+
+	l.t  = select(mask, x, l.t);
+	l.nx = select(mask, add(mul(l.dx, x), Rx), l.nx);
+	l.ny = select(mask, add(mul(l.dy, x), Ry), l.ny);
+	return mask;
+}
+
+floatv ray_capsule_lanes(Lanes& l, floatv mask, const CapsuleBaked& cap)
+{
+	if (cap.is_circle()) {
+		return ray_circle_lanes(l, mask, cap.circle());
+	}
+
+	// Transform ray to local capsule coords:
+	const floatv Rx = sub(l.ox, set1(cap.p[0].x));
+	const floatv Ry = sub(l.oy, set1(cap.p[0].y));
+	const floatv px = add(mul(set1(cap.A.x), Rx),   mul(set1(cap.A.y), Ry));
+	const floatv py = add(mul(set1(cap.N.x), Rx),   mul(set1(cap.N.y), Ry));
+	const floatv dx = add(mul(set1(cap.A.x), l.dx), mul(set1(cap.A.y), l.dy));
+	const floatv dy = add(mul(set1(cap.N.x), l.dx), mul(set1(cap.N.y), l.dy));
+
+	const floatv parallel = bit_and(cmp_le(simd::abs(dy), set1(EPSf)), mask);
+	const floatv crossing = unless(parallel, mask);
+
+	const floatv t_min  = div(sub(set1(-cap.rad), py), dy);
+	const floatv t_max  = div(sub(set1(+cap.rad), py), dy);
+	const floatv t_test = simd::min(t_max, t_min); // Same as std::min(t_min, t_max), also for -0
+	const floatv s = add(px, mul(t_test, dx));
+
+	const floatv before = cmp_lt(s, zero());
+	const floatv after  = unless(before, cmp_lt(set1(cap.length), s));
+	const floatv side   = unless(bit_or(before, after), crossing);
+	const floatv side_hit = bit_and(side, bit_and(cmp_le(l.min_t, t_test), cmp_lt(t_test, l.t)));
+
+	const floatv flip = cmp_lt(dy, zero());
+	l.t  = select(side_hit, t_test, l.t);
+	l.nx = select(side_hit, select(flip, set1(cap.N.x), set1(-cap.N.x)), l.nx);
+	l.ny = select(side_hit, select(flip, set1(cap.N.y), set1(-cap.N.y)), l.ny);
+
+	// Rays parallel to the capsule are tested against both end circles, in order:
+	floatv hit = side_hit;
+	hit = bit_or(hit, ray_circle_lanes(l, bit_or(parallel, bit_and(crossing, before)), cap.circle_0()));
+	hit = bit_or(hit, ray_circle_lanes(l, bit_or(parallel, bit_and(crossing, after)),  cap.circle_1()));
+	return hit;
+}
+
+floatv rayAABB_lanes(Lanes& l, floatv mask, const AABB2f& aabb)
+{
+	const Vec2f center = aabb.center();
+	const Vec2f hs = aabb.size()/2; // half size
+
+	const floatv p[2] = { sub(l.ox, set1(center.x)), sub(l.oy, set1(center.y)) };
+	const floatv d[2] = { l.dx, l.dy };
+
+	floatv hit = zero();
+
+	for (int a=0; a<2; ++a)
+	{
+		const floatv t_min = div(sub(set1(-hs[a]), p[a]), d[a]);
+		const floatv t_max = div(sub(set1(+hs[a]), p[a]), d[a]);
+
+		// First hit:
+		{
+			floatv ok = bit_and(mask, bit_and(cmp_lt(l.min_t, t_min), cmp_lt(t_min, l.t)));
+			const floatv other = add(p[1-a], mul(t_min, d[1-a]));
+			ok = bit_and(ok, cmp_le(simd::abs(other), set1(hs[1-a])));
+			ok = bit_and(ok, cmp_gt(d[a], zero()));
+			l.t  = select(ok, t_min, l.t);
+			l.nx = select(ok, a == 0 ? set1(-1.0f) : zero(), l.nx);
+			l.ny = select(ok, a == 1 ? set1(-1.0f) : zero(), l.ny);
+			hit = bit_or(hit, ok);
+		}
+
+		// Second hit:
+		{
+			floatv ok = bit_and(mask, bit_and(cmp_lt(l.min_t, t_max), cmp_lt(t_max, l.t)));
+			const floatv other = add(p[1-a], mul(t_max, d[1-a]));
+			ok = bit_and(ok, cmp_le(simd::abs(other), set1(hs[1-a])));
+			ok = bit_and(ok, cmp_lt(d[a], zero()));
+			l.t  = select(ok, t_max, l.t);
+			l.nx = select(ok, a == 0 ? set1(+1.0f) : zero(), l.nx);
+			l.ny = select(ok, a == 1 ? set1(+1.0f) : zero(), l.ny);
+			hit = bit_or(hit, ok);
+		}
+	}
+
+	return hit;
+}
+
+template<typename Fun>
+unsigned trace_packet(info_packet& tp, const Fun& fun)
+{
+	unsigned hits = 0;
+	for (int i = 0; i < info_packet::SIZE; i += WIDTH) {
+		const unsigned active = (tp.active >> i) & ((1u << WIDTH) - 1);
+		if (active == 0) { continue; }
+		Lanes l = load_lanes(tp, i);
+		const unsigned lane_hits = unsigned(movemask(fun(l, mask_from_bits(active))));
+		if (lane_hits != 0) {
+			store_lanes(tp, i, l);
+			hits |= lane_hits << i;
+		}
+	}
+	return hits;
+}
+
+} // namespace
+
+unsigned ray_circle(info_packet& tp, const Circle& c)
+{
+	return trace_packet(tp, [&](Lanes& l, floatv mask) { return ray_circle_lanes(l, mask, c); });
+}
+
+unsigned ray_capsule(info_packet& tp, const CapsuleBaked& cap)
+{
+	return trace_packet(tp, [&](Lanes& l, floatv mask) { return ray_capsule_lanes(l, mask, cap); });
+}
+
+unsigned rayAABB(info_packet& tp, const AABB2f& aabb)
+{
+	return trace_packet(tp, [&](Lanes& l, floatv mask) { return rayAABB_lanes(l, mask, aabb); });
+}
+
+#else // EMATH_SIMD_WIDTH == 1
+
+template<typename Shape, typename Fun>
+unsigned trace_packet(info_packet& tp, const Shape& shape, const Fun& fun)
+{
+	unsigned hits = 0;
+	for (int i = 0; i < info_packet::SIZE; ++i) {
+		if (tp.active & (1u << i)) {
+			info ti = tp.get(i);
+			if (fun(ti, shape)) {
+				tp.set(i, ti);
+				hits |= 1u << i;
+			}
+		}
+	}
+	return hits;
+}
+
+unsigned ray_circle(info_packet& tp, const Circle& c)
+{
+	return trace_packet(tp, c, [](info& ti, const Circle& c) { return ray_circle(ti, c); });
+}
+
+unsigned ray_capsule(info_packet& tp, const CapsuleBaked& cap)
+{
+	return trace_packet(tp, cap, [](info& ti, const CapsuleBaked& c) { return ray_capsule(ti, c); });
+}
+
+unsigned rayAABB(info_packet& tp, const AABB2f& aabb)
+{
+	return trace_packet(tp, aabb, [](info& ti, const AABB2f& b) { return rayAABB(ti, b); });
+}
+
+#endif // EMATH_SIMD_WIDTH
+
 } // namespace trace
 } // namespace emath
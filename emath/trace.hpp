@@ -53,5 +53,38 @@ bool rayAABB(info& ti, const AABB2f& aabb);
  */
 bool ray_circle_ccd(info& ti, const Circle& c_0, const Circle& c_1);
 
+// ------------------------------------------------
+// Ray packets
+
+/* Eight rays traced together, stored SoA.
+   Lane i behaves exactly like an info with COLLIDE_ENTERING, ray {o[i], d[i]}, t[i] and min_t[i].
+   Lanes not set in 'active' are never changed.
+ */
+struct info_packet {
+	static constexpr int SIZE = 8;
+
+	float ox[SIZE] = {}, oy[SIZE] = {}; // Ray origins
+	float dx[SIZE] = {}, dy[SIZE] = {}; // Ray directions
+	float t[SIZE] = {};
+	float min_t[SIZE] = {};             // MUST be non-negative!
+	float nx[SIZE] = {}, ny[SIZE] = {}; // normal_dir
+	unsigned active = 0;                // Bit i set = lane i is in use.
+
+	info_packet() = default;
+
+	// Up to SIZE rays, all with the same max_t and min_t.
+	info_packet(const Ray* rays, int num_rays, float max_t, float min_t = 0);
+
+	void set(int lane, const info& ti); // ti must be COLLIDE_ENTERING.
+	info get(int lane) const;
+};
+
+/* Same as the scalar versions, for each active lane.
+   Returns a bit mask of the lanes that hit.
+ */
+unsigned ray_circle(info_packet& tp, const Circle& c);
+unsigned ray_capsule(info_packet& tp, const CapsuleBaked& c);
+unsigned rayAABB(info_packet& tp, const AABB2f& aabb);
+
 } // namespace trace
 } // namespace emath
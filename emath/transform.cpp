@@ -0,0 +1,221 @@
+#include "transform.hpp"
+
+#include "mat3.hpp"
+#include "mat4.hpp"
+#include "simd.hpp"
+#include "vec3.hpp"
+
+namespace emath {
+
+namespace {
+
+enum class Op { Point, Project, Dir };
+
+/// c[i][j] is the weight of input component i in output component j.
+/// Input component DIM is the implicit 1, output component DIM is w.
+template<int DIM>
+struct Coeffs
+{
+	float c[DIM + 1][DIM + 1];
+};
+
+template<int DIM, class Mat>
+Coeffs<DIM> point_coeffs(const Mat& m)
+{
+	Coeffs<DIM> k;
+	for (int i = 0; i <= DIM; ++i) {
+		for (int j = 0; j <= DIM; ++j) {
+			k.c[i][j] = m.mat[i][j];
+		}
+	}
+	return k;
+}
+
+/// The inverse-transpose of the upper-left 3x3, like Mat4T::normal_transformer().
+Coeffs<3> dir_coeffs(const Mat4f& m)
+{
+	const Vec3f r0(m.mat[0][0], m.mat[0][1], m.mat[0][2]);
+	const Vec3f r1(m.mat[1][0], m.mat[1][1], m.mat[1][2]);
+	const Vec3f r2(m.mat[2][0], m.mat[2][1], m.mat[2][2]);
+	Vec3f rows[3] = { cross(r1, r2), cross(r2, r0), cross(r0, r1) };
+	const float det = dot(r0, rows[0]);
+	const float inv_det = (std::abs(det) < 0.000001f ? 0.0f : 1.0f / det);
+
+	Coeffs<3> k = {};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			k.c[i][j] = rows[i][j] * inv_det;
+		}
+	}
+	return k;
+}
+
+/// The inverse-transpose of the upper-left 2x2, like mul_dir(Mat3T, Vec2T).
+Coeffs<2> dir_coeffs(const Mat3f& m)
+{
+	const float det = m.M(0,0) * m.M(1,1) - m.M(0,1) * m.M(1,0);
+	const float inv_det = (std::abs(det) < 0.000001f ? 0.0f : 1.0f / det);
+
+	Coeffs<2> k = {};
+	k.c[0][0] = +m.M(1,1) * inv_det;
+	k.c[0][1] = -m.M(1,0) * inv_det;
+	k.c[1][0] = -m.M(0,1) * inv_det;
+	k.c[1][1] = +m.M(0,0) * inv_det;
+	return k;
+}
+
+template<int DIM, Op op>
+inline void transform_one(const Coeffs<DIM>& k, const float* in, float* out)
+{
+	constexpr int NOut = (op == Op::Project ? DIM + 1 : DIM);
+	float result[DIM + 1];
+	for (int j = 0; j < NOut; ++j) {
+		float acc = in[0] * k.c[0][j];
+		for (int i = 1; i < DIM; ++i) {
+			acc = acc + in[i] * k.c[i][j];
+		}
+		if (op != Op::Dir) {
+			acc = acc + k.c[DIM][j];
+		}
+		result[j] = acc;
+	}
+	for (int j = 0; j < DIM; ++j) {
+		out[j] = (op == Op::Project ? result[j] / result[DIM] : result[j]);
+	}
+}
+
+template<int DIM, Op op>
+void transform_strided(const Coeffs<DIM>& k, const void* in_void, size_t in_stride,
+                       void* out_void, size_t out_stride, size_t n)
+{
+	const char* in  = static_cast<const char*>(in_void);
+	char*       out = static_cast<char*>(out_void);
+
+	size_t i = 0;
+
+#if EMATH_SIMD_WIDTH > 1
+	using namespace simd;
+	constexpr int NOut = (op == Op::Project ? DIM + 1 : DIM);
+
+	floatv kv[DIM + 1][DIM + 1];
+	for (int r = 0; r <= DIM; ++r) {
+		for (int c = 0; c <= DIM; ++c) {
+			kv[r][c] = set1(k.c[r][c]);
+		}
+	}
+
+	for (; i + WIDTH <= n; i += WIDTH) {
+		// Gather the block into SoA form. We read the whole block before writing
+		// anything back, which is what makes in-place operation safe.
+		alignas(32) float lanes[DIM][WIDTH];
+		for (int l = 0; l < WIDTH; ++l) {
+			const float* p = reinterpret_cast<const float*>(in + (i + l) * in_stride);
+			for (int d = 0; d < DIM; ++d) {
+				lanes[d][l] = p[d];
+			}
+		}
+
+		floatv v[DIM];
+		for (int d = 0; d < DIM; ++d) {
+			v[d] = load(lanes[d]);
+		}
+
+		floatv result[DIM + 1];
+		for (int j = 0; j < NOut; ++j) {
+			floatv acc = mul(v[0], kv[0][j]);
+			for (int d = 1; d < DIM; ++d) {
+				acc = add(acc, mul(v[d], kv[d][j]));
+			}
+			if (op != Op::Dir) {
+				acc = add(acc, kv[DIM][j]);
+			}
+			result[j] = acc;
+		}
+
+		for (int d = 0; d < DIM; ++d) {
+			store(lanes[d], op == Op::Project ? simd::div(result[d], result[DIM]) : result[d]);
+		}
+
+		for (int l = 0; l < WIDTH; ++l) {
+			float* p = reinterpret_cast<float*>(out + (i + l) * out_stride);
+			for (int d = 0; d < DIM; ++d) {
+				p[d] = lanes[d][l];
+			}
+		}
+	}
+#endif
+
+	for (; i < n; ++i) {
+		transform_one<DIM, op>(k,
+			reinterpret_cast<const float*>(in + i * in_stride),
+			reinterpret_cast<float*>(out + i * out_stride));
+	}
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+
+void transform_points(const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n)
+{
+	transform_points_strided(m, in, sizeof(Vec3f), out, sizeof(Vec3f), n);
+}
+
+void project_points(const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n)
+{
+	project_points_strided(m, in, sizeof(Vec3f), out, sizeof(Vec3f), n);
+}
+
+void transform_dirs(const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n)
+{
+	transform_dirs_strided(m, in, sizeof(Vec3f), out, sizeof(Vec3f), n);
+}
+
+void transform_points(const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n)
+{
+	transform_points_strided(m, in, sizeof(Vec2f), out, sizeof(Vec2f), n);
+}
+
+void project_points(const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n)
+{
+	project_points_strided(m, in, sizeof(Vec2f), out, sizeof(Vec2f), n);
+}
+
+void transform_dirs(const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n)
+{
+	transform_dirs_strided(m, in, sizeof(Vec2f), out, sizeof(Vec2f), n);
+}
+
+// ----------------------------------------------------------------------------
+
+void transform_points_strided(const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<3, Op::Point>(point_coeffs<3>(m), in, in_stride, out, out_stride, n);
+}
+
+void project_points_strided(const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<3, Op::Project>(point_coeffs<3>(m), in, in_stride, out, out_stride, n);
+}
+
+void transform_dirs_strided(const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<3, Op::Dir>(dir_coeffs(m), in, in_stride, out, out_stride, n);
+}
+
+void transform_points_strided(const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<2, Op::Point>(point_coeffs<2>(m), in, in_stride, out, out_stride, n);
+}
+
+void project_points_strided(const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<2, Op::Project>(point_coeffs<2>(m), in, in_stride, out, out_stride, n);
+}
+
+void transform_dirs_strided(const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n)
+{
+	transform_strided<2, Op::Dir>(dir_coeffs(m), in, in_stride, out, out_stride, n);
+}
+
+} // namespace emath
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "fwd.hpp"
+
+namespace emath {
+
+/*
+ Bulk versions of mul_pos / mul_dir for transforming many points at once.
+ These are vectorized internally (see simd.hpp), so prefer them over
+ calling mul_pos in a loop for anything larger than a handful of points.
+
+ transform_points: affine transform, i.e. mul_pos for a matrix without a projective part.
+ project_points:   full homogeneous transform with perspective divide, i.e. exactly mul_pos.
+ transform_dirs:   same as mul_dir (transforms with the inverse-transpose, no translation).
+                   If the matrix is singular the result is zero.
+
+ 'in' and 'out' may be the same array (in-place), but must not otherwise overlap.
+ */
+
+void transform_points(const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n);
+void project_points  (const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n);
+void transform_dirs  (const Mat4f& m, const Vec3f* in, Vec3f* out, size_t n);
+
+void transform_points(const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n);
+void project_points  (const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n);
+void transform_dirs  (const Mat3f& m, const Vec2f* in, Vec2f* out, size_t n);
+
+// In-place:
+inline void transform_points(const Mat4f& m, Vec3f* points, size_t n) { transform_points(m, points, points, n); }
+inline void project_points  (const Mat4f& m, Vec3f* points, size_t n) { project_points  (m, points, points, n); }
+inline void transform_dirs  (const Mat4f& m, Vec3f* dirs,   size_t n) { transform_dirs  (m, dirs,   dirs,   n); }
+
+inline void transform_points(const Mat3f& m, Vec2f* points, size_t n) { transform_points(m, points, points, n); }
+inline void project_points  (const Mat3f& m, Vec2f* points, size_t n) { project_points  (m, points, points, n); }
+inline void transform_dirs  (const Mat3f& m, Vec2f* dirs,   size_t n) { transform_dirs  (m, dirs,   dirs,   n); }
+
+// ------------------------------------------------
+// Strided versions, for interleaved vertex buffers.
+// 'in' and 'out' point to the first element, and the strides are in bytes.
+// Each element is 2 (Mat3f) or 3 (Mat4f) consecutive floats.
+// For in-place use, pass the same pointer and stride for in and out.
+
+void transform_points_strided(const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+void project_points_strided  (const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+void transform_dirs_strided  (const Mat4f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+
+void transform_points_strided(const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+void project_points_strided  (const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+void transform_dirs_strided  (const Mat3f& m, const void* in, size_t in_stride, void* out, size_t out_stride, size_t n);
+
+} // namespace emath
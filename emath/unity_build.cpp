@@ -1,9 +1,19 @@
+#include "aabb3.cpp"
+#include "bounds.cpp"
+#include "bvh.cpp"
 #include "capsule.cpp"
 #include "direction.cpp"
+#include "filter.cpp"
 #include "frustum.cpp"
+#include "frustum_set.cpp"
 #include "intersect.cpp"
 #include "math.cpp"
+#include "matrix_file.cpp"
+#include "morton.cpp"
 #include "noise.cpp"
+#include "parallel.cpp"
 #include "plane.cpp"
 #include "random.cpp"
+#include "sweep_and_prune.cpp"
 #include "trace.cpp"
+#include "transform.cpp"
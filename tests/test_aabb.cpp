@@ -0,0 +1,161 @@
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/aabb.hpp>
+#include <emath/aabb3.hpp>
+
+using namespace emath;
+
+TEST(AABB, FromPoints)
+{
+	std::mt19937 rng(6);
+	std::uniform_real_distribution<float> dist(-1000, 1000);
+
+	for (size_t n : {1, 2, 7, 8, 33, 10000}) {
+		std::vector<Vec2f> points2(n);
+		std::vector<Vec3f> points3(n);
+		AABB2f expected2 = AABB2f::nothing();
+		AABB3f expected3 = AABB3f::nothing();
+		for (size_t i = 0; i < n; ++i) {
+			points2[i] = {dist(rng), dist(rng)};
+			points3[i] = {dist(rng), dist(rng), dist(rng)};
+			expected2.include(points2[i]);
+			expected3.include(points3[i]);
+		}
+
+		for (unsigned threads : {1, 4}) {
+			const AABB2f box2 = AABB2f::from_points(points2.data(), n, threads);
+			EXPECT_EQ(box2.min(), expected2.min());
+			EXPECT_EQ(box2.max(), expected2.max());
+
+			const AABB3f box3 = AABB3f::from_points(points3.data(), n, threads);
+			EXPECT_EQ(box3.min(), expected3.min());
+			EXPECT_EQ(box3.max(), expected3.max());
+		}
+	}
+}
+
+TEST(AABB, FromPointsStrided)
+{
+	struct Particle { float mass; Vec3f pos; int id; };
+	std::vector<Particle> particles = {
+		{1, {1, 2, 3}, 0},
+		{2, {-4, 5, 0}, 1},
+		{3, {2, -7, 9}, 2},
+	};
+	const AABB3f box = AABB3f::from_points_strided(&particles[0].pos, sizeof(Particle), particles.size());
+	EXPECT_EQ(box.min(), Vec3f(-4, -7, 0));
+	EXPECT_EQ(box.max(), Vec3f(2, 5, 9));
+}
+
+TEST(AABB3, RayInFacePlane)
+{
+	// Axis-aligned rays along a face count as hits, whichever face it is:
+	const AABB3f box = AABB3f::from_min_max({0, 0, 0}, {1, 1, 1});
+	const Vec3f dir(0, 1, 0);
+	for (const Vec3f& origin : {Vec3f(1, -1, 0.5f), Vec3f(0, -1, 0.5f), Vec3f(0.5f, -1, 1), Vec3f(0.5f, -1, 0), Vec3f(1, -1, 1)}) {
+		float t = -1;
+		EXPECT_TRUE(box.intersects_ray(SlabRay3f(origin, dir), 0, 10, &t)) << origin.x << ", " << origin.z;
+		EXPECT_EQ(t, 1) << origin.x << ", " << origin.z;
+	}
+	EXPECT_FALSE(box.intersects_ray(SlabRay3f({1.001f, -1, 0.5f}, dir), 0, 10));
+	EXPECT_FALSE(box.intersects_ray(SlabRay3f({0.5f, -1, 1}, dir), 0, 0.5f)) << "t_max before the box";
+	EXPECT_FALSE(box.intersects_ray(SlabRay3f({0.5f, -1, 1}, -dir), 0, 10)) << "Pointing away";
+}
+
+TEST(AABB3, RayBoxesMatchesIntersectsRay)
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> pos(-100, 100), ext(0.5f, 20), unit(-1, 1);
+	std::uniform_int_distribution<int> grid(-50, 50);
+
+	for (size_t n : {1, 7, 13, 64, 65, 200, 1003}) { // Across the 64-box blocks, and not multiples of 8
+		std::vector<AABB3f> boxes(n);
+		for (size_t i = 0; i < n; ++i) {
+			if (i % 3 == 0) {
+				// On an integer grid, so axis-aligned rays from grid points go along faces:
+				const Vec3f min(float(grid(rng)), float(grid(rng)), float(grid(rng)));
+				boxes[i] = AABB3f::from_min_size(min, {float(1 + i % 5), 1, float(1 + i % 2)});
+			} else {
+				boxes[i] = AABB3f::from_center_size({pos(rng), pos(rng), pos(rng)}, {ext(rng), ext(rng), ext(rng)});
+			}
+		}
+		if (n > 10) { boxes[n - 1] = boxes[n / 2]; } // A tie
+		std::vector<float> min_x(n), min_y(n), min_z(n), max_x(n), max_y(n), max_z(n);
+		for (size_t i = 0; i < n; ++i) {
+			min_x[i] = boxes[i].min().x; min_y[i] = boxes[i].min().y; min_z[i] = boxes[i].min().z;
+			max_x[i] = boxes[i].max().x; max_y[i] = boxes[i].max().y; max_z[i] = boxes[i].max().z;
+		}
+
+		for (int r = 0; r < 50; ++r) {
+			Vec3f origin, dir;
+			if (r % 2 == 0) {
+				origin = {float(grid(rng)), float(grid(rng)), float(grid(rng))};
+				dir = Vec3f(0);
+				dir[r / 2 % 3] = (r % 4 == 0 ? 1.0f : -1.0f);
+				if (r % 6 == 0) { dir[(r / 2 + 1) % 3] = 0.5f; } // One zero component
+			} else {
+				origin = {pos(rng), pos(rng), pos(rng)};
+				dir = {unit(rng), unit(rng), unit(rng)};
+			}
+			const SlabRay3f ray(origin, dir);
+			const float t_min = (r % 5 == 0 ? 2.0f : 0.0f), t_max = 300;
+
+			std::vector<uint8_t> hits_soa((n + 7) / 8), hits_aos((n + 7) / 8);
+			std::vector<float> t_soa(n), t_aos(n);
+			ray_boxes(ray, t_min, t_max, min_x.data(), min_y.data(), min_z.data(),
+			          max_x.data(), max_y.data(), max_z.data(), n, hits_soa.data(), t_soa.data());
+			ray_boxes(ray, t_min, t_max, boxes.data(), n, hits_aos.data(), t_aos.data());
+
+			long  expected_closest = -1;
+			float expected_t = t_max;
+			for (size_t i = 0; i < n; ++i) {
+				float t;
+				const bool hit = boxes[i].intersects_ray(ray, t_min, t_max, &t);
+				EXPECT_EQ(bool((hits_soa[i / 8] >> (i % 8)) & 1), hit) << n << " " << i;
+				EXPECT_EQ(bool((hits_aos[i / 8] >> (i % 8)) & 1), hit) << n << " " << i;
+				if (hit) {
+					EXPECT_EQ(t_soa[i], t) << n << " " << i;
+					EXPECT_EQ(t_aos[i], t) << n << " " << i;
+					if (expected_closest < 0 || t < expected_t) {
+						expected_closest = long(i);
+						expected_t = t;
+					}
+				}
+			}
+
+			float closest_t = -1;
+			EXPECT_EQ(ray_closest_box(ray, t_min, t_max, boxes.data(), n, &closest_t), expected_closest) << n;
+			if (expected_closest >= 0) { EXPECT_EQ(closest_t, expected_t) << n; }
+		}
+	}
+}
+
+TEST(AABB3, DistanceTo)
+{
+	const AABB3f box = AABB3f::from_min_max({0, 0, 0}, {2, 4, 6});
+	EXPECT_EQ(box.distance_to({1, 1, 3}), -1);
+	EXPECT_EQ(box.distance_to({1, 2, 3}), -1);
+	EXPECT_EQ(box.distance_to({2, 2, 3}), 0);
+	EXPECT_EQ(box.distance_to({5, 2, 3}), 3);
+	EXPECT_EQ(box.distance_to({5, 8, 3}), 5);
+}
+
+TEST(AABB3, Transform)
+{
+	const AABB3f box = AABB3f::from_min_max({0, 0, 0}, {1, 2, 3});
+	const AABB3f moved = transform(Mat4f::translate({10, 20, 30}), box);
+	EXPECT_EQ(moved.min(), Vec3f(10, 20, 30));
+	EXPECT_EQ(moved.max(), Vec3f(11, 22, 33));
+
+	// Rotated 90 degrees around z: x -> y, y -> -x.
+	const AABB3f rotated = transform(Mat4f::rotate_z(PI<float> / 2), box);
+	EXPECT_NEAR(rotated.min().x, -2, 1e-5f);
+	EXPECT_NEAR(rotated.max().x,  0, 1e-5f);
+	EXPECT_NEAR(rotated.min().y,  0, 1e-5f);
+	EXPECT_NEAR(rotated.max().y,  1, 1e-5f);
+	EXPECT_NEAR(rotated.min().z,  0, 1e-5f);
+	EXPECT_NEAR(rotated.max().z,  3, 1e-5f);
+}
@@ -0,0 +1,159 @@
+// BVH2::closest_hit must give the same answers as tracing every shape.
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/bvh.hpp>
+
+using namespace emath;
+
+namespace {
+
+struct Scene
+{
+	std::vector<Circle>       circles;
+	std::vector<CapsuleBaked> capsules;
+	std::vector<AABB2f>       aabbs;
+};
+
+Scene random_scene(std::mt19937& rng, int num_circles, int num_capsules, int num_aabbs)
+{
+	std::uniform_real_distribution<float> pos(-50, 50);
+	std::uniform_real_distribution<float> size(0.1f, 4);
+	Scene scene;
+	for (int i = 0; i < num_circles; ++i) {
+		scene.circles.push_back(Circle{{pos(rng), pos(rng)}, size(rng)});
+	}
+	for (int i = 0; i < num_capsules; ++i) {
+		const Vec2f p0(pos(rng), pos(rng));
+		const Vec2f p1 = p0 + Vec2f(2 * size(rng) - 4, 2 * size(rng) - 4);
+		scene.capsules.push_back(CapsuleBaked(Capsule(p0, p1, 0.5f * size(rng))));
+	}
+	for (int i = 0; i < num_aabbs; ++i) {
+		scene.aabbs.push_back(AABB2f::from_min_size({pos(rng), pos(rng)}, {size(rng), size(rng)}));
+	}
+	return scene;
+}
+
+/// The reference: every shape, in order.
+bool linear_closest_hit(const BVH2& bvh, trace::info& ti, BVH2::Primitive* out_hit)
+{
+	bool did_hit = false;
+	for (uint32_t i = 0; i < bvh.circles().size(); ++i) {
+		if (trace::ray_circle(ti, bvh.circles()[i])) { did_hit = true; *out_hit = {BVH2::Shape::Circle, i}; }
+	}
+	for (uint32_t i = 0; i < bvh.capsules().size(); ++i) {
+		if (trace::ray_capsule(ti, bvh.capsules()[i])) { did_hit = true; *out_hit = {BVH2::Shape::Capsule, i}; }
+	}
+	for (uint32_t i = 0; i < bvh.aabbs().size(); ++i) {
+		if (trace::rayAABB(ti, bvh.aabbs()[i])) { did_hit = true; *out_hit = {BVH2::Shape::AABB, i}; }
+	}
+	return did_hit;
+}
+
+/// Returns the number of rays that hit something.
+int expect_matches_linear(const BVH2& bvh, std::mt19937& rng, int num_rays)
+{
+	std::uniform_real_distribution<float> pos(-70, 70);
+	int num_hits = 0;
+	for (int i = 0; i < num_rays; ++i) {
+		const Ray ray{{pos(rng), pos(rng)}, {pos(rng), pos(rng)}};
+		const float max_t = i % 2 == 0 ? 1.0f : 100.0f;
+
+		trace::info expected(ray, max_t);
+		trace::info actual(ray, max_t);
+		if (i % 3 == 0) {
+			expected.min_t = actual.min_t = 0.2f;
+		}
+		BVH2::Primitive expected_prim{}, actual_prim{};
+		const bool hit = linear_closest_hit(bvh, expected, &expected_prim);
+		EXPECT_EQ(bvh.closest_hit(actual, &actual_prim), hit) << "ray " << i;
+		if (hit) {
+			num_hits += 1;
+			EXPECT_EQ(actual.t, expected.t) << "ray " << i;
+			EXPECT_EQ(actual.normal_dir.x, expected.normal_dir.x) << "ray " << i;
+			EXPECT_EQ(actual.normal_dir.y, expected.normal_dir.y) << "ray " << i;
+			EXPECT_EQ(actual_prim.shape, expected_prim.shape) << "ray " << i;
+			EXPECT_EQ(actual_prim.index, expected_prim.index) << "ray " << i;
+		} else {
+			EXPECT_EQ(actual.t, max_t);
+		}
+	}
+	return num_hits;
+}
+
+} // namespace
+
+TEST(BVH, ClosestHitMatchesLinearScan)
+{
+	std::mt19937 rng(0);
+	for (int n : {1, 3, 20, 300}) {
+		Scene scene = random_scene(rng, n, n / 2 + 1, n);
+		BVH2 bvh;
+		bvh.build(scene.circles, scene.capsules, scene.aabbs);
+		const int num_hits = expect_matches_linear(bvh, rng, 2000);
+		if (n >= 20) {
+			EXPECT_GT(num_hits, 200);
+			EXPECT_LT(num_hits, 2000);
+		}
+	}
+}
+
+TEST(BVH, OnlyOneKindOfShape)
+{
+	std::mt19937 rng(1);
+	BVH2 bvh;
+	Scene scene = random_scene(rng, 50, 0, 0);
+	bvh.build(scene.circles, {}, {});
+	expect_matches_linear(bvh, rng, 500);
+	scene = random_scene(rng, 0, 50, 0);
+	bvh.build({}, scene.capsules, {});
+	expect_matches_linear(bvh, rng, 500);
+	scene = random_scene(rng, 0, 0, 50);
+	bvh.build({}, {}, scene.aabbs);
+	expect_matches_linear(bvh, rng, 500);
+}
+
+TEST(BVH, ClosestHitAfterRefit)
+{
+	std::mt19937 rng(2);
+	Scene scene = random_scene(rng, 200, 100, 200);
+	BVH2 bvh;
+	bvh.build(scene.circles, scene.capsules, scene.aabbs);
+
+	for (const float step : {0.5f, 5.0f, 60.0f}) {
+		std::uniform_real_distribution<float> offset(-step, step);
+		for (Circle& c : bvh.circles()) {
+			c.p += Vec2f(offset(rng), offset(rng));
+		}
+		for (CapsuleBaked& c : bvh.capsules()) {
+			const Vec2f o(offset(rng), offset(rng));
+			c = CapsuleBaked(Capsule(c.p0() + o, c.p1() + o, c.rad));
+		}
+		for (AABB2f& b : bvh.aabbs()) {
+			const Vec2f o(offset(rng), offset(rng));
+			b = AABB2f::from_min_max(b.min() + o, b.max() + o);
+		}
+		bvh.refit();
+
+		AABB2f everything = AABB2f::nothing();
+		for (const Circle& c : bvh.circles()) { everything.include(AABB2f::from_center_size(c.p, Vec2f(2 * c.rad))); }
+		for (const AABB2f& b : bvh.aabbs())   { everything.include(b); }
+		EXPECT_TRUE(bvh.bounds().contains(everything));
+
+		EXPECT_GT(expect_matches_linear(bvh, rng, 2000), 200);
+	}
+}
+
+TEST(BVH, Empty)
+{
+	BVH2 bvh;
+	trace::info ti(Ray{{0, 0}, {1, 0}}, 10);
+	EXPECT_FALSE(bvh.closest_hit(ti));
+	bvh.build({}, {}, {});
+	EXPECT_TRUE(bvh.empty());
+	EXPECT_FALSE(bvh.closest_hit(ti));
+	EXPECT_EQ(ti.t, 10);
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <random>
+#include <type_traits>
+
+#include <gtest/gtest.h>
+
+#include <emath/filter.hpp>
+#include <emath/matrix.hpp>
+#include <emath/summed_area_table.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<typename T>
+Matrix<T> random_matrix(int width, int height, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> dist(-1000, 1000);
+	Matrix<T> m(width, height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			m(x, y) = T(dist(rng)) / T(std::is_floating_point<T>::value ? 100 : 1);
+		}
+	}
+	return m;
+}
+
+/// Sum and count of the part of [x, x + w) x [y, y + h) that is inside m.
+template<typename T>
+double brute_sum(const Matrix<T>& m, int x, int y, int w, int h, int* out_count)
+{
+	double sum = 0;
+	int count = 0;
+	for (int yy = std::max(y, 0); yy < std::min(y + h, m.height()); ++yy) {
+		for (int xx = std::max(x, 0); xx < std::min(x + w, m.width()); ++xx) {
+			sum += m(xx, yy);
+			count += 1;
+		}
+	}
+	*out_count = count;
+	return sum;
+}
+
+double brute_box_mean(const Matrixf& m, int x, int y, int rx, int ry)
+{
+	int count;
+	const double sum = brute_sum(m, x - rx, y - ry, 2 * rx + 1, 2 * ry + 1, &count);
+	return sum / count;
+}
+
+} // namespace
+
+TEST(SummedAreaTable, MatchesBruteForce)
+{
+	std::mt19937 rng(1);
+	for (int size : {1, 2, 5, 17}) {
+		const Matrix<int> m = random_matrix<int>(size, size + 3, rng);
+		const SummedAreaTable<int> sat(m);
+		ASSERT_EQ(sat.width(), m.width());
+		ASSERT_EQ(sat.height(), m.height());
+		int count;
+		EXPECT_EQ(sat.total(), int64_t(brute_sum(m, 0, 0, m.width(), m.height(), &count)));
+
+		std::uniform_int_distribution<int> pos(-5, size + 5), ext(0, size + 8);
+		for (int i = 0; i < 500; ++i) {
+			const int x = pos(rng), y = pos(rng), w = ext(rng), h = ext(rng);
+			int expected_count;
+			const double expected = brute_sum(m, x, y, w, h, &expected_count);
+
+			int clamped_count = -1;
+			EXPECT_EQ(sat.sum_clamped(x, y, w, h, &clamped_count), int64_t(expected)) << x << " " << y << " " << w << " " << h;
+			EXPECT_EQ(clamped_count, expected_count);
+			EXPECT_DOUBLE_EQ(sat.mean_clamped(x, y, w, h), expected_count > 0 ? expected / expected_count : 0.0);
+
+			if (0 <= x && 0 <= y && x + w <= m.width() && y + h <= m.height()) {
+				EXPECT_EQ(sat.sum(x, y, w, h), int64_t(expected));
+			}
+		}
+	}
+}
+
+TEST(SummedAreaTable, SubView)
+{
+	std::mt19937 rng(2);
+	const Matrixd m = random_matrix<double>(20, 10, rng);
+	const SummedAreaTable<double> sat(m.sub(3, 2, 11, 6));
+	int count;
+	EXPECT_NEAR(sat.total(),         brute_sum(m, 3, 2, 11, 6, &count), 1e-9);
+	EXPECT_NEAR(sat.sum(1, 1, 4, 3), brute_sum(m, 4, 3, 4, 3, &count),  1e-9);
+}
+
+TEST(Filter, BoxBlurMatchesBruteForce)
+{
+	std::mt19937 rng(3);
+	struct Case { int width, height, rx, ry; };
+	const Case cases[] = {
+		{1, 1, 0, 0}, {1, 1, 3, 3}, {9, 7, 0, 0}, {9, 7, 1, 2}, {9, 7, 4, 3},
+		{9, 7, 9, 7}, {9, 7, 20, 1}, {9, 7, 1, 20}, {40, 33, 5, 6}, {3, 50, 2, 8},
+	};
+	for (const Case& c : cases) {
+		const Matrixf src = random_matrix<float>(c.width, c.height, rng);
+		for (unsigned threads : {1u, 4u}) {
+			Matrixf dst(c.width, c.height);
+			box_blur(src, dst, c.rx, c.ry, threads);
+			Matrixf in_place = src;
+			box_blur(in_place, in_place, c.rx, c.ry, threads);
+
+			for (int y = 0; y < c.height; ++y) {
+				for (int x = 0; x < c.width; ++x) {
+					const double expected = brute_box_mean(src, x, y, c.rx, c.ry);
+					ASSERT_NEAR(dst(x, y), expected, 1e-4) << c.width << "x" << c.height << " r=" << c.rx << "," << c.ry
+						<< " threads=" << threads << " at " << x << ", " << y;
+					ASSERT_EQ(in_place(x, y), dst(x, y)) << "src == dst";
+				}
+			}
+		}
+	}
+}
+
+TEST(Filter, BoxBlurMatchesMeanClamped)
+{
+	std::mt19937 rng(4);
+	const Matrixf src = random_matrix<float>(30, 20, rng);
+	const SummedAreaTable<float> sat(src);
+	const int r = 3;
+	const Matrixf single = box_blur(src, r, 1);
+	const Matrixf threaded = box_blur(src, r, 3);
+	for (int y = 0; y < src.height(); ++y) {
+		for (int x = 0; x < src.width(); ++x) {
+			const double mean = sat.mean_clamped(x - r, y - r, 2 * r + 1, 2 * r + 1);
+			EXPECT_NEAR(single(x, y), mean, 1e-4) << x << ", " << y;
+			EXPECT_NEAR(threaded(x, y), single(x, y), 1e-5) << x << ", " << y;
+		}
+	}
+}
+
+TEST(Filter, GaussianBlur)
+{
+	std::mt19937 rng(5);
+	const Matrixf src = random_matrix<float>(25, 18, rng);
+
+	// Three boxes of width 1:
+	const Matrixf same = gaussian_blur(src, 0.0f);
+	for (int y = 0; y < src.height(); ++y) {
+		for (int x = 0; x < src.width(); ++x) {
+			EXPECT_EQ(same(x, y), src(x, y)) << x << ", " << y;
+		}
+	}
+
+	// Spreads an impulse symmetrically, keeps the mass away from the edges, and is the same on more threads:
+	Matrixf impulse(41, 41, 0.0f);
+	impulse(20, 20) = 1;
+	const Matrixf blurred = gaussian_blur(impulse, 3.0f);
+	const Matrixf threaded = gaussian_blur(impulse, 3.0f, 4);
+	double total = 0;
+	for (int y = 0; y < 41; ++y) {
+		for (int x = 0; x < 41; ++x) {
+			total += blurred(x, y);
+			EXPECT_NEAR(blurred(x, y), blurred(40 - x, y), 1e-7f);
+			EXPECT_NEAR(blurred(x, y), blurred(y, x), 1e-7f);
+			EXPECT_NEAR(threaded(x, y), blurred(x, y), 1e-7f);
+		}
+	}
+	EXPECT_NEAR(total, 1.0, 1e-5);
+	EXPECT_LT(blurred(20, 20), 0.1f);
+	EXPECT_GT(blurred(20, 20), blurred(23, 20));
+	EXPECT_GT(blurred(23, 20), blurred(26, 20));
+
+	// In place:
+	Matrixf in_place = impulse;
+	gaussian_blur(in_place, in_place, 3.0f);
+	for (int y = 0; y < 41; ++y) {
+		for (int x = 0; x < 41; ++x) {
+			EXPECT_EQ(in_place(x, y), blurred(x, y)) << x << ", " << y;
+		}
+	}
+}
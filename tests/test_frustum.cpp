@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/frustum.hpp>
+#include <emath/frustum_set.hpp>
+#include <emath/mat4.hpp>
+#include <emath/vec3.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// Camera at the origin looking down -Z, near 1, far 100.
+Frustum test_frustum()
+{
+	return Frustum::from_matrix(Mat4f::perspective(90, 1, 1, 100) * Mat4f::look_at({0, 0, 0}, {0, 0, -1}, {0, 1, 0}));
+}
+
+/// Largest distance between corresponding corners, relative to the far distance.
+double max_corner_error(const Frustum& f, const Frustumd& reference, double far_dist)
+{
+	double max_error = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		const Vec3f& p = f.point(i);
+		max_error = std::max(max_error, length(Vec3d(p.x, p.y, p.z) - reference.point(i)) / far_dist);
+	}
+	return max_error;
+}
+
+Frustum random_frustum(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> dist(-1, 1);
+	const Vec3f eye(20 * dist(rng), 20 * dist(rng), 20 * dist(rng));
+	const Vec3f dir(dist(rng), dist(rng), dist(rng));
+	const float fov    = 40 + 60 * std::abs(dist(rng));
+	const float aspect = 1 + std::abs(dist(rng));
+	const float far    = 50 + 100 * std::abs(dist(rng));
+	return Frustum::from_matrix(Mat4f::perspective(fov, aspect, 0.5f, far) * Mat4f::look_at(eye, eye + dir, {0, 1, 0}));
+}
+
+struct Objects
+{
+	std::vector<Vec3f> centers;
+	std::vector<Vec3f> extents;
+	std::vector<float> radii;
+};
+
+Objects random_objects(std::mt19937& rng, size_t n)
+{
+	std::uniform_real_distribution<float> pos(-150, 150), size(0.1f, 20);
+	Objects objects;
+	for (size_t i = 0; i < n; ++i) {
+		objects.centers.push_back({pos(rng), pos(rng), pos(rng)});
+		objects.extents.push_back({size(rng), size(rng), size(rng)});
+		objects.radii.push_back(size(rng));
+	}
+	return objects;
+}
+
+} // namespace
+
+TEST(Frustum, TestSphere)
+{
+	const Frustum f = test_frustum();
+	EXPECT_EQ(f.test_sphere({0, 0, -50}, 1),   IntersectResult::Inside);
+	EXPECT_EQ(f.test_sphere({0, 0, -100}, 1),  IntersectResult::Intersects);
+	EXPECT_EQ(f.test_sphere({0, 0, +50}, 1),   IntersectResult::Outside);
+	EXPECT_EQ(f.test_sphere({0, 0, -200}, 1),  IntersectResult::Outside);
+	EXPECT_EQ(f.test_sphere({100, 0, -50}, 1), IntersectResult::Outside);
+	EXPECT_TRUE(f.contains_point({0, 0, -50}));
+	EXPECT_FALSE(f.contains_point({0, 0, 50}));
+}
+
+TEST(Frustum, CullBox)
+{
+	const Frustum f = test_frustum();
+	EXPECT_FALSE(f.cull_box({0, 0, -50},  {1, 1, 1}));
+	EXPECT_FALSE(f.cull_box({0, 0, 0},    {5, 5, 5})); // Contains the near plane
+	EXPECT_TRUE (f.cull_box({0, 0, 50},   {1, 1, 1}));
+	EXPECT_TRUE (f.cull_box({0, 0, -200}, {1, 1, 1}));
+	EXPECT_TRUE (f.cull_box({100, 0, -50}, {1, 1, 1}));
+}
+
+TEST(Frustum, CullBoxesMatchesCullBox)
+{
+	const Frustum f = Frustum::from_matrix(
+		Mat4f::perspective(60, 1.5f, 0.5f, 300) * Mat4f::look_at({10, 5, -3}, {40, 0, 80}, {0, 1, 0}));
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> pos(-300, 300), ext(0.1f, 20);
+	const size_t n = 1003; // Not a multiple of the SIMD width
+	std::vector<Vec3f> centers(n), extents(n);
+	for (size_t i = 0; i < n; ++i) {
+		centers[i] = {pos(rng), pos(rng), pos(rng)};
+		extents[i] = {ext(rng), ext(rng), ext(rng)};
+	}
+
+	std::vector<uint8_t> visible((n + 7) / 8);
+	f.cull_boxes(centers.data(), extents.data(), n, visible.data());
+
+	size_t num_visible = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const bool batch_visible = (visible[i / 8] >> (i % 8)) & 1;
+		EXPECT_EQ(batch_visible, !f.cull_box(centers[i], extents[i])) << "box " << i;
+		num_visible += batch_visible;
+	}
+	EXPECT_GT(num_visible, 0u);
+	EXPECT_LT(num_visible, n);
+}
+
+TEST(Frustum, CornersFromInverse)
+{
+	// Compared to the corners computed in double, relative to the far distance.
+	// The worst measured FromInverse errors are 1/8 to 1/4 of these tolerances.
+	struct Case { float far_over_near, tolerance_compute, tolerance_inverse; };
+	const Case cases[] = {
+		{100,   1e-5f, 2e-4f},
+		{1000,  1e-5f, 2e-3f},
+		{10000, 1e-5f, 2e-2f},
+	};
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> dist(-1, 1);
+	for (const Case& c : cases) {
+		for (float far_dist : {50.0f, 200.0f, 5000.0f}) {
+			for (int i = 0; i < 20; ++i) {
+				const Vec3f eye(100 * dist(rng), 100 * dist(rng), 100 * dist(rng));
+				const Vec3f dir(dist(rng), dist(rng), dist(rng));
+				const float fov = 40 + 60 * std::abs(dist(rng));
+				const float aspect = 1 + std::abs(dist(rng));
+				const Mat4f mvp = Mat4f::perspective(fov, aspect, far_dist / c.far_over_near, far_dist)
+				                * Mat4f::look_at(eye, eye + dir, {0, 1, 0});
+				Mat4d mvpd;
+				for (int e = 0; e < 16; ++e) { mvpd.data()[e] = mvp.data()[e]; }
+				const Frustumd reference = Frustumd::from_matrix(mvpd);
+
+				const Frustum computed = Frustum::from_matrix(mvp, Frustum::Corners::Compute);
+				const Frustum inverse  = Frustum::from_matrix(mvp, Frustum::Corners::FromInverse);
+				EXPECT_LT(max_corner_error(computed, reference, far_dist), c.tolerance_compute) << c.far_over_near;
+				EXPECT_LT(max_corner_error(inverse,  reference, far_dist), c.tolerance_inverse) << c.far_over_near;
+			}
+		}
+	}
+}
+
+TEST(Frustum, SkipCorners)
+{
+	const Mat4f mvp = Mat4f::perspective(60, 1.5f, 0.5f, 200) * Mat4f::look_at({1, 2, 3}, {10, 0, -40}, {0, 1, 0});
+	const Frustum computed = Frustum::from_matrix(mvp);
+	Frustum skipped = Frustum::from_matrix(mvp, Frustum::Corners::Skip);
+	EXPECT_TRUE(computed.has_corners());
+	EXPECT_FALSE(skipped.has_corners());
+	skipped.compute_corners();
+	ASSERT_TRUE(skipped.has_corners());
+	for (size_t i = 0; i < 8; ++i) {
+		EXPECT_EQ(skipped.point(i), computed.point(i)) << i;
+	}
+}
+
+TEST(FrustumSet, MatchesFrustums)
+{
+	std::mt19937 rng(7);
+	const size_t n = 2000;
+	const Objects objects = random_objects(rng, n);
+
+	for (int num_frustums : {1, 5, 8}) {
+		for (int round = 0; round < 5; ++round) {
+			FrustumSet set;
+			for (int f = 0; f < num_frustums; ++f) {
+				EXPECT_EQ(set.add(random_frustum(rng)), f);
+			}
+			ASSERT_EQ(set.size(), num_frustums);
+
+			std::vector<uint8_t> sphere_masks(n), box_masks(n);
+			set.test_spheres(objects.centers.data(), objects.radii.data(), n, sphere_masks.data());
+			set.test_boxes(objects.centers.data(), objects.extents.data(), n, box_masks.data());
+
+			size_t num_visible = 0, num_inside = 0;
+			for (size_t i = 0; i < n; ++i) {
+				uint8_t expected_visible = 0, expected_inside = 0, expected_box = 0;
+				for (int f = 0; f < num_frustums; ++f) {
+					const IntersectResult result = set.frustum(f).test_sphere(objects.centers[i], objects.radii[i]);
+					if (result != IntersectResult::Outside) { expected_visible |= uint8_t(1 << f); }
+					if (result == IntersectResult::Inside)  { expected_inside  |= uint8_t(1 << f); }
+					if (!set.frustum(f).cull_box(objects.centers[i], objects.extents[i])) { expected_box |= uint8_t(1 << f); }
+				}
+
+				uint8_t inside = 0xFF;
+				ASSERT_EQ(set.test_sphere(objects.centers[i], objects.radii[i], &inside), expected_visible) << i;
+				ASSERT_EQ(inside, expected_inside) << i;
+				ASSERT_EQ(sphere_masks[i], expected_visible) << i;
+				ASSERT_EQ(set.test_box(objects.centers[i], objects.extents[i]), expected_box) << i;
+				ASSERT_EQ(box_masks[i], expected_box) << i;
+				num_visible += expected_box != 0;
+				num_inside  += expected_inside != 0;
+			}
+			EXPECT_GT(num_visible, 0u);
+			EXPECT_LT(num_visible, n);
+			EXPECT_GT(num_inside, 0u);
+		}
+	}
+}
+
+TEST(FrustumSet, Empty)
+{
+	FrustumSet set;
+	uint8_t inside = 0xFF;
+	EXPECT_EQ(set.test_sphere({0, 0, 0}, 1, &inside), 0);
+	EXPECT_EQ(inside, 0);
+	EXPECT_EQ(set.test_box({0, 0, 0}, {1, 1, 1}), 0);
+
+	set.add(test_frustum());
+	set.clear();
+	EXPECT_EQ(set.size(), 0);
+	EXPECT_EQ(set.test_box({0, 0, -50}, {1, 1, 1}), 0);
+}
+
+TEST(Frustum, MaskedSphere)
+{
+	std::mt19937 rng(8);
+	const Objects objects = random_objects(rng, 500);
+	size_t num_outside = 0, num_inside = 0;
+
+	for (int round = 0; round < 10; ++round) {
+		const Frustum f = random_frustum(rng);
+		for (size_t i = 0; i < objects.centers.size(); ++i) {
+			const Vec3f& c = objects.centers[i];
+			const float  r = objects.radii[i];
+
+			int first_outside = -1;
+			uint8_t expected_mask = 0;
+			for (int p = 0; p < 6; ++p) {
+				const float d = f.plane(p).distance(c);
+				if (d > r && first_outside < 0) { first_outside = p; }
+				if (d > -r) { expected_mask |= uint8_t(1 << p); }
+			}
+
+			uint8_t mask = Frustum::ALL_PLANES;
+			uint8_t last_plane = 0;
+			Frustum::CullStats stats;
+			const IntersectResult result = f.test_sphere_masked(c, r, &mask, &last_plane, &stats);
+			ASSERT_EQ(result == IntersectResult::Outside, f.test_sphere(c, r) == IntersectResult::Outside) << i;
+			EXPECT_EQ(stats.nodes, 1u);
+
+			if (result == IntersectResult::Outside) {
+				num_outside += 1;
+				EXPECT_EQ(mask, Frustum::ALL_PLANES) << "Left alone when Outside";
+				EXPECT_EQ(last_plane, first_outside);
+				EXPECT_EQ(stats.plane_tests, size_t(first_outside + 1));
+				EXPECT_EQ(stats.culled, 1u);
+
+				// Next time the plane that culled it is tried first:
+				Frustum::CullStats again;
+				uint8_t all = Frustum::ALL_PLANES;
+				EXPECT_EQ(f.test_sphere_masked(c, r, &all, &last_plane, &again), IntersectResult::Outside);
+				EXPECT_EQ(again.plane_tests, 1u);
+				EXPECT_EQ(last_plane, first_outside);
+			} else {
+				EXPECT_EQ(mask, expected_mask) << i;
+				EXPECT_EQ(result, mask == 0 ? IntersectResult::Inside : IntersectResult::Intersects);
+				EXPECT_EQ(last_plane, 0) << "Only changed when Outside";
+				EXPECT_EQ(stats.plane_tests, 6u);
+				EXPECT_EQ(stats.culled, 0u);
+				if (result == IntersectResult::Inside) {
+					num_inside += 1;
+					EXPECT_EQ(f.test_sphere(c, r), IntersectResult::Inside);
+
+					// Nothing left to test:
+					Frustum::CullStats child;
+					EXPECT_EQ(f.test_sphere_masked(c, 0.5f * r, &mask, nullptr, &child), IntersectResult::Inside);
+					EXPECT_EQ(child.plane_tests, 0u);
+				}
+			}
+		}
+	}
+	EXPECT_GT(num_outside, 0u);
+	EXPECT_GT(num_inside, 0u);
+}
+
+TEST(Frustum, MaskedBox)
+{
+	std::mt19937 rng(9);
+	const Objects objects = random_objects(rng, 500);
+	std::uniform_real_distribution<float> unit(-1, 1);
+	size_t num_outside = 0, num_inside = 0;
+
+	for (int round = 0; round < 10; ++round) {
+		const Frustum f = random_frustum(rng);
+		Frustum::CullStats stats;
+		size_t expected_nodes = 0, expected_culled = 0;
+
+		for (size_t i = 0; i < objects.centers.size(); ++i) {
+			const Vec3f& c = objects.centers[i];
+			const Vec3f& e = objects.extents[i];
+			const Vec3f mins = c - e, maxs = c + e;
+
+			bool outside = false;
+			uint8_t expected_mask = 0;
+			for (int p = 0; p < 6; ++p) {
+				const Vec3f& n = f.plane(p).normal();
+				const Vec3f closest (n.x > 0 ? mins.x : maxs.x, n.y > 0 ? mins.y : maxs.y, n.z > 0 ? mins.z : maxs.z);
+				const Vec3f farthest(n.x > 0 ? maxs.x : mins.x, n.y > 0 ? maxs.y : mins.y, n.z > 0 ? maxs.z : mins.z);
+				if (f.plane(p).distance(closest) >= 0) { outside = true; }
+				if (f.plane(p).distance(farthest) >= 0) { expected_mask |= uint8_t(1 << p); }
+			}
+
+			uint8_t mask = Frustum::ALL_PLANES;
+			const IntersectResult result = f.cull_box_masked(c, e, &mask, nullptr, &stats);
+			expected_nodes += 1;
+			ASSERT_EQ(result == IntersectResult::Outside, outside) << i;
+			if (outside) {
+				expected_culled += 1;
+				num_outside += 1;
+				EXPECT_TRUE(f.cull_box(c, e)) << "Masked culling must never cull more than cull_box";
+				continue;
+			}
+			EXPECT_EQ(mask, expected_mask) << i;
+			EXPECT_EQ(result, mask == 0 ? IntersectResult::Inside : IntersectResult::Intersects);
+			num_inside += result == IntersectResult::Inside;
+
+			// A child box inside this one, tested with the mask we got, gives the same answer
+			// as testing it against all planes:
+			const Vec3f child_extent = e * 0.25f;
+			const Vec3f child_center = c + Vec3f(unit(rng) * 0.75f * e.x, unit(rng) * 0.75f * e.y, unit(rng) * 0.75f * e.z);
+			uint8_t child_mask = mask, full_mask = Frustum::ALL_PLANES;
+			const IntersectResult child_result = f.cull_box_masked(child_center, child_extent, &child_mask, nullptr, &stats);
+			const IntersectResult full_result  = f.cull_box_masked(child_center, child_extent, &full_mask,  nullptr, &stats);
+			expected_nodes += 2;
+			expected_culled += 2 * (full_result == IntersectResult::Outside);
+			EXPECT_EQ(child_result, full_result) << i;
+			if (full_result != IntersectResult::Outside) {
+				EXPECT_EQ(child_mask, full_mask) << i;
+			}
+		}
+
+		EXPECT_EQ(stats.nodes, expected_nodes);
+		EXPECT_EQ(stats.culled, expected_culled);
+		EXPECT_LE(stats.plane_tests, 6 * expected_nodes);
+	}
+	EXPECT_GT(num_outside, 0u);
+	EXPECT_GT(num_inside, 0u);
+}
+
+TEST(Frustum, MaskedLastPlane)
+{
+	const Frustum f = test_frustum();
+	// Beyond the far plane, so outside of the Back plane only:
+	const Vec3f c(0, 0, -200), e(1, 1, 1);
+	uint8_t mask = Frustum::ALL_PLANES;
+	uint8_t last_plane = 2;
+	Frustum::CullStats stats;
+	ASSERT_EQ(f.cull_box_masked(c, e, &mask, &last_plane, &stats), IntersectResult::Outside);
+	EXPECT_EQ(last_plane, 4) << "Back";
+	EXPECT_EQ(stats.plane_tests, 3u) << "Top, Bottom, Back";
+
+	stats = {};
+	ASSERT_EQ(f.cull_box_masked(c, e, &mask, &last_plane, &stats), IntersectResult::Outside);
+	EXPECT_EQ(stats.plane_tests, 1u);
+
+	// A plane not in the mask is skipped, even if it's the last one:
+	mask = Frustum::ALL_PLANES & ~uint8_t(1 << 4);
+	stats = {};
+	const IntersectResult result = f.cull_box_masked(c, e, &mask, &last_plane, &stats);
+	EXPECT_EQ(stats.plane_tests, 5u);
+	EXPECT_NE(result, IntersectResult::Outside);
+	EXPECT_EQ(last_plane, 4);
+}
+
+TEST(Frustum, RelativeTo)
+{
+	// Far enough from the origin that float positions are only good to about a meter:
+	const Vec3d eye(1e7, 2e3, -3e6);
+	const Mat4d mvp = Mat4d::perspective(70, 1.5, 0.1, 100) * Mat4d::look_at(eye, eye + Vec3d(1, -0.2, -1), {0, 1, 0});
+	const Frustumd reference = Frustumd::from_matrix(mvp);
+	const Frustum f = reference.relative_to(eye);
+
+	for (size_t i = 0; i < 8; ++i) {
+		EXPECT_LT(length(Vec3d(f.point(i).x, f.point(i).y, f.point(i).z) - (reference.point(i) - eye)), 1e-3) << i;
+	}
+
+	std::mt19937 rng(10);
+	std::uniform_real_distribution<double> dist(-100, 100);
+	size_t num_checked = 0, num_inside = 0;
+	for (int i = 0; i < 10000; ++i) {
+		const Vec3d p = eye + Vec3d(dist(rng), dist(rng), dist(rng));
+		double closest_plane = 1e9;
+		for (int k = 0; k < 6; ++k) {
+			closest_plane = std::min(closest_plane, std::abs(reference.plane(k).distance(p)));
+		}
+		if (closest_plane < 1e-3) { continue; } // Too close to call in float.
+
+		const bool inside = reference.contains_point(p);
+		EXPECT_EQ(f.contains_point(Vec3f(p - eye)), inside) << i;
+		num_checked += 1;
+		num_inside += inside;
+	}
+	EXPECT_GT(num_checked, 9000u);
+	EXPECT_GT(num_inside, 0u);
+}
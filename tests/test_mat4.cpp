@@ -0,0 +1,115 @@
+// The SIMD specializations for Mat4f must agree with the generic code, which we get via Mat4d.
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <emath/mat4.hpp>
+#include <emath/vec3.hpp>
+#include <emath/vec4.hpp>
+
+using namespace emath;
+
+namespace {
+
+Mat4f random_mat4(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> dist(-2, 2);
+	Mat4f m;
+	for (int i = 0; i < 16; ++i) { m.data()[i] = dist(rng); }
+	return m;
+}
+
+Mat4d to_double(const Mat4f& m)
+{
+	Mat4d d;
+	for (int i = 0; i < 16; ++i) { d.data()[i] = m.data()[i]; }
+	return d;
+}
+
+void expect_near(const Mat4f& a, const Mat4d& b, double tolerance)
+{
+	for (int i = 0; i < 16; ++i) {
+		EXPECT_NEAR(a.data()[i], b.data()[i], tolerance) << "element " << i;
+	}
+}
+
+} // namespace
+
+TEST(Mat4, Multiply)
+{
+	std::mt19937 rng(1);
+	for (int k = 0; k < 100; ++k) {
+		const Mat4f a = random_mat4(rng), b = random_mat4(rng);
+		expect_near(a * b, to_double(a) * to_double(b), 1e-5);
+	}
+}
+
+TEST(Mat4, Transposed)
+{
+	std::mt19937 rng(2);
+	const Mat4f m = random_mat4(rng);
+	const Mat4f t = transposed(m);
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			EXPECT_EQ(t[r][c], m[c][r]);
+		}
+	}
+}
+
+TEST(Mat4, Inverted)
+{
+	std::mt19937 rng(3);
+	for (int k = 0; k < 100; ++k) {
+		const Mat4f m = random_mat4(rng);
+		const Mat4d d = to_double(m);
+		if (std::abs(d.determinant()) < 0.1) { continue; } // Badly conditioned
+		expect_near(inverted(m), inverted(d), 1e-3);
+		expect_near(m * inverted(m), Mat4d::identity(), 1e-4);
+	}
+}
+
+TEST(Mat4, MulVec)
+{
+	std::mt19937 rng(4);
+	const Mat4f m = random_mat4(rng);
+	const Mat4d d = to_double(m);
+	const Vec4f v(0.5f, -1.25f, 2, 1);
+	const Vec4f r = mul(m, v);
+	const Vec4d rd = mul(d, Vec4d(v));
+	for (int i = 0; i < 4; ++i) {
+		EXPECT_NEAR(r[i], rd[i], 1e-5);
+	}
+
+	const Vec3f p(1, 2, 3);
+	const Vec3f rp = mul_pos(m, p);
+	const Vec3d rpd = mul_pos(d, Vec3d(p));
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_NEAR(rp[i], rpd[i], 1e-4);
+	}
+}
+
+TEST(Mat4, MulDir)
+{
+	std::mt19937 rng(5);
+	const Vec3f dir(0.5f, -1.25f, 2);
+	for (int k = 0; k < 100; ++k) {
+		const Mat4f m = random_mat4(rng);
+		if (std::abs(determinant(m.upper_left3x3())) < 0.1f) { continue; } // Badly conditioned
+		const Vec3f r = mul_dir(m, dir);
+		const Vec3d rd = mul_dir(to_double(m), Vec3d(dir));
+		const Vec3f generic = mul(m.normal_transformer(), dir);
+		for (int i = 0; i < 3; ++i) {
+			EXPECT_NEAR(r[i], rd[i], 1e-4 * (1 + std::abs(rd[i])));
+			EXPECT_NEAR(r[i], generic[i], 1e-4f * (1 + std::abs(generic[i])));
+		}
+	}
+
+	// Singular upper-left 3x3: zero from all versions.
+	Mat4f flat = Mat4f::identity();
+	flat[1][0] = flat[1][1] = flat[1][2] = 0;
+	EXPECT_EQ(mul_dir(flat, dir), Vec3f(0, 0, 0));
+	EXPECT_EQ(mul_dir(to_double(flat), Vec3d(dir)), Vec3d(0, 0, 0));
+	EXPECT_EQ(mul(flat.normal_transformer(), dir), Vec3f(0, 0, 0));
+	EXPECT_EQ(mul_dir(flat, Vec2f(1, 2)), Vec2f(0, 0));
+}
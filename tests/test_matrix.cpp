@@ -0,0 +1,380 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/matrix.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<typename T>
+Matrix<T> numbered(int width, int height)
+{
+	Matrix<T> m(width, height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			m(x, y) = T(y * width + x);
+		}
+	}
+	return m;
+}
+
+template<typename T>
+void expect_transposed(const Matrix<T>& m, const Matrix<T>& t)
+{
+	ASSERT_EQ(t.width(),  m.height());
+	ASSERT_EQ(t.height(), m.width());
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) {
+			ASSERT_EQ(t(y, x), m(x, y)) << x << ", " << y;
+		}
+	}
+}
+
+Matrixf random_matrix(int width, int height, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+	Matrixf m(width, height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			m(x, y) = dist(rng);
+		}
+	}
+	return m;
+}
+
+template<typename A, typename B, typename = void>
+struct can_multiply : std::false_type {};
+
+template<typename A, typename B>
+struct can_multiply<A, B, decltype(void(std::declval<A>() * std::declval<B>()))> : std::true_type {};
+
+} // namespace
+
+// The expression would outlive the temporary:
+static_assert(!can_multiply<Matrixf, float>::value, "rvalue Matrix operand");
+static_assert(!can_multiply<float, Matrixf>::value, "rvalue Matrix operand");
+static_assert(!can_multiply<const Matrixf&, Matrixf>::value, "rvalue Matrix operand");
+static_assert(!can_multiply<Matrixf, Matrixf>::value, "rvalue Matrix operand");
+static_assert(can_multiply<const Matrixf&, float>::value, "lvalue Matrix operand");
+static_assert(can_multiply<Matrixf&, const Matrixf&>::value, "lvalue Matrix operand");
+
+TEST(Matrix, Transpose)
+{
+	// Sizes around the tile and SIMD widths:
+	for (int w : {1, 3, 8, 17, 64, 100}) {
+		for (int h : {1, 5, 8, 33, 64}) {
+			const Matrixf mf = numbered<float>(w, h);
+			expect_transposed(mf, mf.transpose());
+			expect_transposed(mf, mf.transpose(3));
+
+			const Matrix<double> md = numbered<double>(w, h);
+			expect_transposed(md, md.transpose());
+		}
+	}
+}
+
+TEST(Matrix, TransposeInPlace)
+{
+	for (int size : {1, 7, 8, 31, 64, 65}) {
+		const Matrixi m = numbered<int>(size, size);
+		Matrixi t = m;
+		t.transpose_in_place();
+		expect_transposed(m, t);
+
+		Matrixi t2 = m;
+		t2.transpose_in_place(4);
+		expect_transposed(m, t2);
+	}
+}
+
+TEST(Matrix, ExprScalarType)
+{
+	const Matrixi mi(5, 5, 2);
+	const Matrixi scaled = mi * 2.5f;
+	EXPECT_EQ(scaled(4, 4), 5);
+	const Matrixf scaled_f = mi * 2.5f;
+	EXPECT_EQ(scaled_f(0, 0), 5.0f);
+	EXPECT_EQ(sum(mi / 4.0), 25 * 0.5);
+	const Matrixi halved = 5 - mi / 2.0; // 5 - 1.0
+	EXPECT_EQ(halved(1, 2), 4);
+
+	// Stored with truncation toward zero, not rounding:
+	const Matrixi neg(3, 2, -1);
+	const Matrixi neg_scaled = neg * 2.5f; // -2.5
+	EXPECT_EQ(neg_scaled(2, 1), -2);
+	const Matrixi neg_shifted = neg * 1.7 - 0.5; // -2.2
+	EXPECT_EQ(neg_shifted(0, 0), -2);
+
+	// Float matrices stay float (and SIMD):
+	const Matrixf mf(17, 3, 1.5f);
+	static_assert(std::is_same<decltype(mf * 0.5)::value_type, float>::value, "float");
+	static_assert(std::is_same<decltype(sum(mf * 0.5)), double>::value, "summed in double");
+	const Matrixf r = mf * 0.5 + mf;
+	EXPECT_EQ(r(16, 2), 2.25f);
+}
+
+TEST(Matrix, SumDoesNotWrap)
+{
+	const Matrix<uint8_t> m(100, 30, 200);
+	static_assert(std::is_same<decltype(sum(m)), int64_t>::value, "int64_t");
+	EXPECT_EQ(sum(m), 100 * 30 * 200);
+	EXPECT_EQ(sum(m, 4), 100 * 30 * 200);
+
+	// 2^24 + 1 is not a float, but the total is exact in double:
+	Matrixf mf(1 << 12, 1 << 12, 1.0f);
+	mf(5, 7) = 2.0f;
+	EXPECT_EQ(sum(mf), double((1 << 24) + 1));
+	EXPECT_EQ(sum(mf, 3), double((1 << 24) + 1));
+}
+
+// Widths around the SIMD width, so both the packets and the scalar tail are used.
+const int kWidths[] = {1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33};
+
+TEST(Matrix, ExprMatchesScalar)
+{
+	std::mt19937 rng(0);
+	for (int width : kWidths) {
+		for (int height : {1, 5}) {
+			const Matrixf a = random_matrix(width, height, rng);
+			const Matrixf b = random_matrix(width, height, rng);
+			for (unsigned threads : {1u, 3u}) {
+				Matrixf r;
+				r.assign(-a * 2.0f - b / 4.0f + 1.0f, threads);
+				ASSERT_EQ(r.width(), width);
+				ASSERT_EQ(r.height(), height);
+				for (int y = 0; y < height; ++y) {
+					for (int x = 0; x < width; ++x) {
+						EXPECT_FLOAT_EQ(r(x, y), -a(x, y) * 2.0f - b(x, y) / 4.0f + 1.0f) << width << ": " << x << ", " << y;
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(Matrix, ExprOverSubViews)
+{
+	std::mt19937 rng(1);
+	const Matrixf a = random_matrix(40, 20, rng);
+	const Matrixf b = random_matrix(40, 20, rng);
+	for (int width : kWidths) {
+		for (unsigned threads : {1u, 4u}) {
+			Matrixf dst(40, 20, 99.0f);
+			evaluate(dst.sub(2, 3, width, 11), a.sub(1, 0, width, 11) * b.sub(5, 7, width, 11), threads);
+			for (int y = 0; y < dst.height(); ++y) {
+				for (int x = 0; x < dst.width(); ++x) {
+					const bool inside = 2 <= x && x < 2 + width && 3 <= y && y < 14;
+					const float expected = inside ? a(x - 1, y - 3) * b(x + 3, y + 4) : 99.0f;
+					ASSERT_FLOAT_EQ(dst(x, y), expected) << width << ": " << x << ", " << y;
+				}
+			}
+		}
+	}
+
+	// In place, on a view with padded rows:
+	Matrixf m = Matrixf::with_aligned_rows(13, 4, 64, 2.0f);
+	evaluate(m.view(), m * m - 1.0f, 2);
+	EXPECT_EQ(sum(m), 13 * 4 * 3.0);
+}
+
+TEST(Matrix, MapAndZipMap)
+{
+	std::mt19937 rng(2);
+	for (int width : kWidths) {
+		const Matrixf a = random_matrix(width, 3, rng);
+		const Matrixf b = random_matrix(width, 3, rng);
+		const Matrixf r = map(a, [](float v) { return v * v; }) + zip_map(a, b, [](float u, float v) { return u < v ? u : 2 * v; });
+		for (int y = 0; y < 3; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const float u = a(x, y), v = b(x, y);
+				EXPECT_FLOAT_EQ(r(x, y), u * u + (u < v ? u : 2 * v));
+			}
+		}
+	}
+
+	// The function decides the element type:
+	const Matrixi mi = numbered<int>(5, 4);
+	const auto halves = map(mi, [](int v) { return v * 0.5f; });
+	static_assert(std::is_same<decltype(halves)::value_type, float>::value, "float");
+	const Matrixf mf = halves;
+	EXPECT_EQ(mf(3, 2), 6.5f);
+	EXPECT_EQ(sum(zip_map(mi, mi, [](int u, int v) { return u * v; }), 2), 2470);
+}
+
+TEST(Matrix, Reduce)
+{
+	const Matrixi m = numbered<int>(7, 9);
+	for (unsigned threads : {1u, 2u, 4u}) {
+		EXPECT_EQ(reduce(m, 0, matrix_op::Add(), threads), 62 * 63 / 2);
+		EXPECT_EQ(reduce(m, 1000, matrix_op::Min(), threads), 0);
+		EXPECT_EQ(reduce(m * 2, -1, [](int a, int b) { return a > b ? a : b; }, threads), 124);
+		// Associative but not commutative: the order must be row-major.
+		const std::string digits = reduce(map(m.sub(0, 0, 3, 3), [](int v) { return std::to_string(v % 10); }),
+			std::string(), [](const std::string& a, const std::string& b) { return a + b; }, threads);
+		EXPECT_EQ(digits, "012789456");
+	}
+	EXPECT_EQ(reduce(Matrixi(), 42, matrix_op::Add()), 42);
+	EXPECT_EQ(reduce(Matrixi(0, 5), 42, matrix_op::Add()), 42);
+}
+
+TEST(Matrix, MinMax)
+{
+	std::mt19937 rng(3);
+	for (int width : kWidths) {
+		for (int height : {1, 6}) {
+			const Matrixf m = random_matrix(width, height, rng);
+			float lo = m(0, 0), hi = m(0, 0);
+			Vec2i lo_at(0, 0), hi_at(0, 0);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					if (m(x, y) < lo) { lo = m(x, y); lo_at = Vec2i(x, y); }
+					if (m(x, y) > hi) { hi = m(x, y); hi_at = Vec2i(x, y); }
+				}
+			}
+			for (unsigned threads : {1u, 4u}) {
+				EXPECT_EQ(min_value(m, threads), lo);
+				EXPECT_EQ(max_value(m, threads), hi);
+				EXPECT_EQ(argmin(m, threads), lo_at);
+				EXPECT_EQ(argmax(m, threads), hi_at);
+				EXPECT_EQ(max_value(-m, threads), -lo);
+				EXPECT_EQ(argmax(-m, threads), lo_at);
+			}
+		}
+	}
+}
+
+TEST(Matrix, ArgMinMaxTies)
+{
+	for (int width : kWidths) {
+		Matrixf m(width, 5, 0.0f);
+		m(width - 1, 1) = -1.0f;
+		m(width / 2, 2) = 5.0f;
+		m(0, 3)         = -1.0f; // Ties in later rows
+		m(width - 1, 4) = 5.0f;
+		for (unsigned threads : {1u, 4u}) {
+			EXPECT_EQ(argmin(m, threads), Vec2i(width - 1, 1));
+			EXPECT_EQ(argmax(m, threads), Vec2i(width / 2, 2));
+		}
+	}
+
+	const Matrixi same(6, 6, 7);
+	EXPECT_EQ(argmin(same), Vec2i(0, 0));
+	EXPECT_EQ(argmax(same, 3), Vec2i(0, 0));
+
+	Matrixi row(9, 1, 0);
+	row(2, 0) = 3;
+	row(6, 0) = 3;
+	EXPECT_EQ(argmax(row), Vec2i(2, 0));
+}
+
+TEST(Matrix, ViewIteration)
+{
+	const Matrixi m = numbered<int>(10, 6);
+	// The bottom-right corner, so a whole pitch past the last row would be outside the matrix:
+	for (const auto view : {m.view(), m.sub(3, 2, 7, 4), m.sub(9, 5, 1, 1), m.view().column(9), m.view().row(5)}) {
+		std::vector<int> expected;
+		for (int y = 0; y < view.height(); ++y) {
+			for (int x = 0; x < view.width(); ++x) { expected.push_back(view(x, y)); }
+		}
+		const std::vector<int> visited(view.begin(), view.end());
+		EXPECT_EQ(visited, expected);
+		EXPECT_EQ(&*view.begin(), view.data());
+		EXPECT_LE(view.end().operator->(), m.data() + m.width() * m.height());
+	}
+
+	const ConstMatrixView<int> empty = m.sub(4, 4, 0, 2);
+	EXPECT_TRUE(empty.begin() == empty.end());
+
+	Matrixi padded = Matrixi::with_aligned_rows(5, 3);
+	int i = 0;
+	for (int& v : padded.view()) { v = i++; }
+	EXPECT_EQ(i, 15);
+	EXPECT_EQ(padded(4, 2), 14);
+	EXPECT_EQ(padded.view().end().operator->(), padded.view().row_ptr(2) + 5);
+}
+
+TEST(Matrix, ToVector)
+{
+	Matrixi m = Matrixi::with_aligned_rows(5, 3);
+	ASSERT_EQ(m.pitch(), 16);
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) { m(x, y) = y * 5 + x; }
+	}
+	const std::vector<int> v = m.to_vector();
+	ASSERT_EQ(v.size(), 15u);
+	for (int i = 0; i < 15; ++i) { EXPECT_EQ(v[i], i); }
+	EXPECT_TRUE(Matrixi().to_vector().empty());
+}
+
+namespace {
+
+/// Random resize sequences compared to a std::vector<std::vector<T>>.
+/// std::string catches elements that are moved from without being moved to.
+template<typename T>
+void check_resize(Matrix<T> m, bool reserved, int max_size, std::mt19937& rng, T (*make)(int))
+{
+	std::uniform_int_distribution<int> size_dist(0, max_size);
+	if (reserved) { m.reserve(max_size, max_size); }
+	std::vector<std::vector<T>> ref(m.height(), std::vector<T>(m.width()));
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) { m(x, y) = ref[y][x] = make(y * m.width() + x); }
+	}
+
+	for (int step = 0; step < 300; ++step) {
+		const int new_w = size_dist(rng);
+		const int new_h = step % 7 == 0 ? m.height() : size_dist(rng); // Sometimes only the width changes
+		const T fill = make(1000 + step);
+		const bool shrinking = new_w <= m.width() && new_h <= m.height();
+		const T* data_before = m.data();
+		const size_t capacity_before = m.capacity();
+
+		m.resize(new_w, new_h, fill);
+		ref.resize(new_h, std::vector<T>(new_w, fill));
+		for (auto& row : ref) { row.resize(new_w, fill); }
+
+		ASSERT_EQ(m.width(), new_w);
+		ASSERT_EQ(m.height(), new_h);
+		for (int y = 0; y < new_h; ++y) {
+			for (int x = 0; x < new_w; ++x) {
+				ASSERT_EQ(m(x, y), ref[y][x]) << "step " << step << " at " << x << ", " << y;
+			}
+		}
+		if (shrinking || reserved) {
+			EXPECT_EQ(m.data(), data_before) << "step " << step;
+			EXPECT_EQ(m.capacity(), capacity_before) << "step " << step;
+		}
+	}
+}
+
+int make_int(int i) { return i; }
+std::string make_string(int i) { return "element number " + std::to_string(i); } // Too long for the small-string buffer
+
+} // namespace
+
+TEST(Matrix, Resize)
+{
+	std::mt19937 rng(7);
+	for (bool reserved : {false, true}) {
+		check_resize(Matrixi(5, 4), reserved, 12, rng, make_int);
+		check_resize(Matrixi::with_aligned_rows(5, 4), reserved, 40, rng, make_int); // Pitch steps of 16
+		check_resize(Matrix<std::string>(3, 3), reserved, 10, rng, make_string);
+		check_resize(Matrix<std::string>::with_aligned_rows(3, 3, 128), reserved, 10, rng, make_string);
+	}
+}
+
+TEST(Matrix, ResizeDiscardKeepsStorage)
+{
+	Matrixf m(50, 40);
+	const float* data = m.data();
+	const size_t capacity = m.capacity();
+	m.resize_discard(30, 60);
+	m.resize_discard(7, 3);
+	EXPECT_EQ(m.width(), 7);
+	EXPECT_EQ(m.height(), 3);
+	EXPECT_EQ(m.data(), data);
+	EXPECT_EQ(m.capacity(), capacity);
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/matrix_file.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// A file of its own for every test, so they can run in parallel.
+std::string temp_path()
+{
+	const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+	return ::testing::TempDir() + "emath_" + info->test_suite_name() + "_" + info->name() + ".bin";
+}
+
+Matrixf numbered(int width, int height)
+{
+	Matrixf m(width, height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) { m(x, y) = float(y * width + x); }
+	}
+	return m;
+}
+
+std::vector<char> read_file(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::vector<char>& bytes)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+/// Saves a small valid file, lets 'forge' change its header, and tries to open it.
+template<typename Forge>
+bool open_forged(const Forge& forge)
+{
+	const std::string path = temp_path();
+	EXPECT_TRUE(save_matrix(path, numbered(5, 3)));
+	std::vector<char> bytes = read_file(path);
+	MatrixFileHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	forge(header);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	write_file(path, bytes);
+
+	MappedMatrixFile file;
+	const bool ok = file.open(path);
+	std::remove(path.c_str());
+	return ok;
+}
+
+template<typename T>
+void reverse_bytes(T& value)
+{
+	char* bytes = reinterpret_cast<char*>(&value);
+	std::reverse(bytes, bytes + sizeof(T));
+}
+
+/// Rewrites a saved file the way a machine of the other endianness would have written it.
+void swap_endianness(const std::string& path)
+{
+	std::vector<char> bytes = read_file(path);
+	MatrixFileHeader h;
+	std::memcpy(&h, bytes.data(), sizeof(h));
+	const size_t size = h.element_size;
+	for (size_t i = size_t(h.data_offset); i + size <= bytes.size(); i += size) {
+		std::reverse(&bytes[i], &bytes[i] + size);
+	}
+	reverse_bytes(h.version);
+	reverse_bytes(h.endian);
+	reverse_bytes(h.element_type);
+	reverse_bytes(h.element_size);
+	reverse_bytes(h.width);
+	reverse_bytes(h.height);
+	reverse_bytes(h.pitch);
+	reverse_bytes(h.data_offset);
+	std::memcpy(bytes.data(), &h, sizeof(h));
+	write_file(path, bytes);
+}
+
+} // namespace
+
+TEST(MatrixFile, SaveAndLoad)
+{
+	const std::string path = temp_path();
+	const Matrixf m = numbered(17, 5);
+	ASSERT_TRUE(save_matrix(path, m, 64));
+
+	MappedMatrixFile file;
+	ASSERT_TRUE(file.open(path));
+	EXPECT_EQ(file.width(), 17);
+	EXPECT_EQ(file.height(), 5);
+	EXPECT_EQ(file.pitch(), 32);
+	const ConstMatrixView<float> view = file.view<float>();
+	Matrixf loaded;
+	ASSERT_TRUE(load_matrix(path, loaded));
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) {
+			EXPECT_EQ(view(x, y), m(x, y));
+			EXPECT_EQ(loaded(x, y), m(x, y));
+		}
+	}
+	file.close();
+	std::remove(path.c_str());
+}
+
+TEST(MatrixFile, LoadOtherEndianness)
+{
+	const std::string path = temp_path();
+	const Matrixf m = numbered(17, 5);
+	ASSERT_TRUE(save_matrix(path, m, 64));
+	swap_endianness(path);
+
+	MappedMatrixFile file;
+	ASSERT_TRUE(file.open(path));
+	EXPECT_FALSE(file.is_native_endian());
+	EXPECT_EQ(file.width(), 17);
+	EXPECT_EQ(file.height(), 5);
+	EXPECT_EQ(file.pitch(), 32);
+	file.close();
+
+	Matrixf loaded;
+	ASSERT_TRUE(load_matrix(path, loaded));
+	ASSERT_EQ(loaded.width(), m.width());
+	ASSERT_EQ(loaded.height(), m.height());
+	for (int y = 0; y < m.height(); ++y) {
+		for (int x = 0; x < m.width(); ++x) {
+			EXPECT_EQ(loaded(x, y), m(x, y)) << x << ", " << y;
+		}
+	}
+
+	// The wrong element type is still rejected after swapping:
+	Matrix<int32_t> wrong_type;
+	EXPECT_FALSE(load_matrix(path, wrong_type));
+	std::remove(path.c_str());
+}
+
+TEST(MatrixFile, RejectsForgedHeaders)
+{
+	EXPECT_TRUE(open_forged([](MatrixFileHeader&) {}));
+
+	// Truncated:
+	EXPECT_FALSE(open_forged([](MatrixFileHeader& h) { h.height += 1; }));
+	EXPECT_FALSE(open_forged([](MatrixFileHeader& h) { h.data_offset = 1 << 20; }));
+
+	// Don't fit in an int:
+	EXPECT_FALSE(open_forged([](MatrixFileHeader& h) { h.pitch = uint64_t(1) << 63; }));
+	EXPECT_FALSE(open_forged([](MatrixFileHeader& h) { h.width = h.height = 1u << 31; h.pitch = h.width; }));
+
+	// The size in bytes overflows 64 bits:
+	EXPECT_FALSE(open_forged([](MatrixFileHeader& h) {
+		h.width  = uint32_t(std::numeric_limits<int>::max());
+		h.height = h.width;
+		h.pitch  = h.width;
+		h.element_type = uint32_t(MatrixElementType::Float64);
+		h.element_size = 8;
+	}));
+}
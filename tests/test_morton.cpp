@@ -0,0 +1,153 @@
+// Runs whichever of the BMI2 and lookup table versions this build uses (see EMATH_BMI2),
+// and checks the lookup tables directly so they are covered on BMI2 builds too.
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/matrix.hpp>
+#include <emath/morton.hpp>
+#include <emath/tiled_matrix.hpp>
+#include <emath/vec2.hpp>
+#include <emath/vec3.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// Bit i of coordinate c goes to bit (i * dim + c).
+uint64_t naive_interleave(const uint32_t* coords, int dim, int bits_per_coord)
+{
+	uint64_t code = 0;
+	for (int i = 0; i < bits_per_coord; ++i) {
+		for (int c = 0; c < dim; ++c) {
+			code |= uint64_t((coords[c] >> i) & 1) << (i * dim + c);
+		}
+	}
+	return code;
+}
+
+/// Random values, with every single-bit value and all-ones mixed in so the top bits are covered.
+std::vector<uint32_t> test_values(std::mt19937& rng, int bits)
+{
+	std::vector<uint32_t> values = {0};
+	for (int i = 0; i < bits; ++i) { values.push_back(uint32_t(1) << i); }
+	values.push_back(uint32_t((uint64_t(1) << bits) - 1));
+	std::uniform_int_distribution<uint32_t> dist(0, uint32_t((uint64_t(1) << bits) - 1));
+	for (int i = 0; i < 200; ++i) { values.push_back(dist(rng)); }
+	return values;
+}
+
+template<typename T, int TILE_BITS>
+void check_tiled_round_trip(std::mt19937& rng)
+{
+	using Tiled = TiledMatrix<T, TILE_BITS>;
+	for (int width : {1, Tiled::TILE - 1, Tiled::TILE, Tiled::TILE + 1, 3 * Tiled::TILE + 5}) {
+		for (int height : {1, Tiled::TILE + 3, 2 * Tiled::TILE}) {
+			Matrix<T> m(width, height);
+			std::uniform_int_distribution<int> dist(-1000, 1000);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) { m(x, y) = T(dist(rng)); }
+			}
+
+			const Tiled tiled(m);
+			ASSERT_EQ(tiled.width(), width);
+			ASSERT_EQ(tiled.height(), height);
+			EXPECT_EQ(tiled.tiles_x(), (width  + Tiled::TILE - 1) / Tiled::TILE);
+			EXPECT_EQ(tiled.tiles_y(), (height + Tiled::TILE - 1) / Tiled::TILE);
+
+			std::vector<bool> used(size_t(tiled.tiles_x()) * tiled.tiles_y() * Tiled::TILE_SIZE, false);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					ASSERT_EQ(tiled(x, y), m(x, y)) << TILE_BITS << ": " << x << ", " << y;
+					const size_t i = tiled.index(x, y);
+					ASSERT_LT(i, used.size());
+					EXPECT_FALSE(used[i]) << "Two elements at the same index";
+					used[i] = true;
+
+					// Within the tile, elements are in Morton order:
+					const int tx = x / Tiled::TILE, ty = y / Tiled::TILE;
+					EXPECT_EQ(&tiled(x, y), tiled.tile_ptr(tx, ty) + morton_encode(uint32_t(x % Tiled::TILE), uint32_t(y % Tiled::TILE)));
+				}
+			}
+
+			const Matrix<T> back = tiled.to_matrix();
+			ASSERT_EQ(back.width(), width);
+			ASSERT_EQ(back.height(), height);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					ASSERT_EQ(back(x, y), m(x, y)) << TILE_BITS << ": " << x << ", " << y;
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+
+TEST(Morton, Encode2)
+{
+	std::mt19937 rng(1);
+	const auto values = test_values(rng, 32);
+	for (size_t i = 0; i < values.size(); ++i) {
+		const uint32_t xy[2] = {values[i], values[(i * 7 + 3) % values.size()]};
+		const uint64_t code = morton_encode(xy[0], xy[1]);
+		ASSERT_EQ(code, naive_interleave(xy, 2, 32)) << xy[0] << ", " << xy[1];
+		EXPECT_EQ(morton_compact_2(code),      xy[0]);
+		EXPECT_EQ(morton_compact_2(code >> 1), xy[1]);
+		if (xy[0] < (1u << 31) && xy[1] < (1u << 31)) {
+			const Vec2i p{int(xy[0]), int(xy[1])};
+			EXPECT_EQ(morton_encode(p), code);
+			EXPECT_EQ(morton_decode_2(code), p);
+		}
+	}
+}
+
+TEST(Morton, Encode3)
+{
+	std::mt19937 rng(2);
+	const auto values = test_values(rng, 21);
+	for (size_t i = 0; i < values.size(); ++i) {
+		const uint32_t xyz[3] = {values[i], values[(i * 7 + 3) % values.size()], values[(i * 13 + 5) % values.size()]};
+		const uint64_t code = morton_encode(xyz[0], xyz[1], xyz[2]);
+		ASSERT_EQ(code, naive_interleave(xyz, 3, 21)) << xyz[0] << ", " << xyz[1] << ", " << xyz[2];
+		const Vec3i p{int(xyz[0]), int(xyz[1]), int(xyz[2])};
+		EXPECT_EQ(morton_encode(p), code);
+		EXPECT_EQ(morton_decode_3(code), p);
+	}
+
+	// Only the lowest 21 bits are used:
+	EXPECT_EQ(morton_encode(0xFFFFFFFFu, 0u, 0u), morton_encode(0x1FFFFFu, 0u, 0u));
+	EXPECT_EQ(morton_compact_3(~uint64_t(0)), 0x1FFFFFu);
+}
+
+TEST(Morton, Tables)
+{
+	for (uint32_t v = 0; v < 256; ++v) {
+		const uint32_t xy[2] = {v, 0};
+		EXPECT_EQ(MORTON_TABLES.spread_2[v], uint16_t(naive_interleave(xy, 2, 8))) << v;
+		const uint32_t xyz[3] = {v, 0, 0};
+		EXPECT_EQ(MORTON_TABLES.spread_3[v], uint32_t(naive_interleave(xyz, 3, 8))) << v;
+		EXPECT_EQ(MORTON_TABLES.compact_2[v], uint8_t((v & 1) | ((v >> 1) & 2) | ((v >> 2) & 4) | ((v >> 3) & 8))) << v;
+	}
+	for (uint32_t v = 0; v < 512; ++v) {
+		EXPECT_EQ(MORTON_TABLES.compact_3[v], uint8_t((v & 1) | ((v >> 2) & 2) | ((v >> 4) & 4))) << v;
+	}
+}
+
+TEST(TiledMatrix, RoundTrip)
+{
+	std::mt19937 rng(3);
+	check_tiled_round_trip<float, 1>(rng);
+	check_tiled_round_trip<float, 2>(rng);
+	check_tiled_round_trip<float, 3>(rng);
+	check_tiled_round_trip<int,   4>(rng);
+}
+
+TEST(TiledMatrix, Empty)
+{
+	const TiledMatrix<float> tiled(Matrixf(0, 5));
+	EXPECT_TRUE(tiled.empty());
+	EXPECT_EQ(tiled.to_matrix().height(), 5);
+}
@@ -0,0 +1,56 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/matrix.hpp>
+#include <emath/noise.hpp>
+
+using namespace emath;
+
+namespace {
+
+// The fills do the float math in the same order as the scalar code, so they only differ if the
+// compiler contracts one of them into FMAs.
+const float TOLERANCE = 1e-6f;
+
+} // namespace
+
+TEST(Noise, Fill2dMatchesScalar)
+{
+	const Vec2f origin(-13.37f, 4.2f);
+	const Vec2f step(0.173f, 0.31f);
+	for (unsigned octaves : {1u, 4u}) {
+		for (unsigned num_threads : {1u, 3u}) {
+			Matrixf out(37, 13); // Not a multiple of the SIMD width
+			fill_noise_2d(out, origin, step, octaves, 0.5f, num_threads);
+			for (int y = 0; y < out.height(); ++y) {
+				for (int x = 0; x < out.width(); ++x) {
+					const float expected = octave_noise_2d(octaves, 0.5f,
+						origin.x + float(x) * step.x, origin.y + float(y) * step.y);
+					ASSERT_NEAR(out(x, y), expected, TOLERANCE) << x << ", " << y << ", octaves: " << octaves;
+				}
+			}
+		}
+	}
+}
+
+TEST(Noise, Fill3dMatchesScalar)
+{
+	const Vec3f origin(7.5f, -2.25f, 100.1f);
+	const Vec3f step(0.21f, 0.13f, 0.57f);
+	for (unsigned octaves : {1u, 3u}) {
+		for (unsigned num_threads : {1u, 4u}) {
+			std::vector<Matrixf> layers(5, Matrixf(19, 6));
+			fill_noise_3d(layers, origin, step, octaves, 0.6f, num_threads);
+			for (size_t z = 0; z < layers.size(); ++z) {
+				for (int y = 0; y < layers[z].height(); ++y) {
+					for (int x = 0; x < layers[z].width(); ++x) {
+						const float expected = octave_noise_3d(octaves, 0.6f,
+							origin.x + float(x) * step.x, origin.y + float(y) * step.y, origin.z + float(z) * step.z);
+						ASSERT_NEAR(layers[z](x, y), expected, TOLERANCE) << x << ", " << y << ", " << z;
+					}
+				}
+			}
+		}
+	}
+}
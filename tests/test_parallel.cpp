@@ -0,0 +1,67 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/parallel.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// Checks that parallel_for visits every index exactly once.
+void expect_covers(size_t n, unsigned num_threads)
+{
+	std::vector<std::atomic<int>> visits(n);
+	for (auto& v : visits) { v = 0; }
+	parallel_for(n, num_threads, [&](size_t begin, size_t end) {
+		ASSERT_LE(begin, end);
+		ASSERT_LE(end, n);
+		for (size_t i = begin; i < end; ++i) { visits[i] += 1; }
+	});
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT_EQ(visits[i], 1) << "n: " << n << ", threads: " << num_threads << ", index " << i;
+	}
+}
+
+} // namespace
+
+TEST(Parallel, CoversRange)
+{
+	for (size_t n : {0, 1, 2, 3, 7, 64, 1000}) {
+		for (unsigned num_threads : {0u, 1u, 2u, 3u, 8u, 16u}) {
+			expect_covers(n, num_threads);
+		}
+	}
+}
+
+TEST(Parallel, ManyCalls)
+{
+	// The pool is reused, so this is cheap:
+	for (int i = 0; i < 2000; ++i) {
+		expect_covers(37, 4);
+	}
+}
+
+TEST(Parallel, Nested)
+{
+	std::atomic<size_t> total{0};
+	parallel_for(8, 8, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			parallel_for(100, 4, [&](size_t b, size_t e) { total += e - b; });
+		}
+	});
+	EXPECT_EQ(total, 800u);
+}
+
+TEST(Parallel, ConcurrentCallers)
+{
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([]() {
+			for (int i = 0; i < 200; ++i) { expect_covers(100, 3); }
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/random.hpp>
+
+using namespace emath;
+
+namespace {
+
+const unsigned NUM_THREADS = 16;
+const size_t   NUM_DRAWS   = 1000;
+
+using Sequence = std::vector<uint32_t>;
+
+/// Mixes the draws we want reproducible: raw engine output, floats and normals.
+Sequence draw(Random& random)
+{
+	Sequence seq;
+	for (size_t i = 0; i < NUM_DRAWS; ++i) {
+		seq.push_back(random.engine()());
+		seq.push_back(uint32_t(random.random_int(1000)));
+		const float f = random.random_float();
+		const float n = random.random_normal();
+		uint32_t bits[2];
+		std::memcpy(&bits[0], &f, sizeof(f));
+		std::memcpy(&bits[1], &n, sizeof(n));
+		seq.push_back(bits[0]);
+		seq.push_back(bits[1]);
+	}
+	return seq;
+}
+
+/// Each thread draws from its thread_local_instance(), after seeding it with its index if seed == true.
+std::vector<Sequence> run_threads(bool seed)
+{
+	std::vector<Sequence> results(NUM_THREADS);
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < NUM_THREADS; ++i) {
+		threads.emplace_back([&results, i, seed]() {
+			if (seed) { Random::seed_thread_local_instance(i); }
+			results[i] = draw(Random::thread_local_instance());
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+	return results;
+}
+
+} // namespace
+
+TEST(Random, SeededThreadLocalIsReproducible)
+{
+	const uint64_t master = 0x1234567890abcdefULL;
+	set_master_random_seed(master);
+	const auto first  = run_threads(true);
+	const auto second = run_threads(true);
+
+	for (unsigned i = 0; i < NUM_THREADS; ++i) {
+		Random expected(thread_random_seed(master, i));
+		EXPECT_EQ(first[i], draw(expected)) << "thread " << i;
+		EXPECT_EQ(first[i], second[i]) << "thread " << i;
+		for (unsigned j = 0; j < i; ++j) {
+			EXPECT_NE(first[i], first[j]) << "threads " << i << " and " << j;
+		}
+	}
+
+	set_master_random_seed(master + 1);
+	const auto other = run_threads(true);
+	for (unsigned i = 0; i < NUM_THREADS; ++i) {
+		EXPECT_NE(first[i], other[i]) << "thread " << i;
+	}
+}
+
+TEST(Random, UnseededThreadLocalIsUnique)
+{
+	// Without seeding, the indices depend on scheduling, but no two threads may get the same one.
+	set_master_random_seed(42);
+	auto results = run_threads(false);
+	std::sort(results.begin(), results.end());
+	EXPECT_EQ(std::adjacent_find(results.begin(), results.end()), results.end());
+}
+
+TEST(Random, NextRandomSeedIsRaceFree)
+{
+	// Hammer the shared seed counter: every thread takes seeds directly and via default-constructed Random:s.
+	const size_t NUM_SEEDS = 20000; // Per thread, of each kind
+	const unsigned before = next_random_seed();
+
+	std::vector<std::vector<unsigned>> seeds(NUM_THREADS);
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < NUM_THREADS; ++i) {
+		threads.emplace_back([&seeds, i, NUM_SEEDS]() {
+			seeds[i].reserve(NUM_SEEDS);
+			volatile uint32_t sink = 0; // Keeps the Random:s from being optimized away
+			for (size_t k = 0; k < NUM_SEEDS; ++k) {
+				seeds[i].push_back(next_random_seed());
+				Random random;
+				sink = random.engine()();
+			}
+			(void)sink;
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+
+	std::vector<unsigned> all;
+	for (const auto& thread_seeds : seeds) { all.insert(all.end(), thread_seeds.begin(), thread_seeds.end()); }
+	ASSERT_EQ(all.size(), NUM_THREADS * NUM_SEEDS);
+	std::sort(all.begin(), all.end());
+	EXPECT_EQ(std::adjacent_find(all.begin(), all.end()), all.end()) << "A seed was handed out twice";
+
+	// No increment was lost, including the ones done by the Random constructor:
+	const unsigned after = next_random_seed();
+	EXPECT_EQ(after - before, unsigned(2 * NUM_THREADS * NUM_SEEDS + 1));
+}
+
+// ----------------------------------------------------------------------------
+// Engines
+
+namespace {
+
+/// xoshiro128 is linear over GF(2), so we can check jump() against the transition matrix raised
+/// to the power 2^k, without relying on the jump polynomials.
+/// A state is 128 bits (four uint32_t:s). The matrix is stored as its 128 columns.
+struct GF2Matrix
+{
+	using State = std::array<uint32_t, 4>;
+
+	State col[128];
+
+	State apply(const State& in) const
+	{
+		State r = {{0, 0, 0, 0}};
+		for (int j = 0; j < 128; ++j) {
+			if ((in[j / 32] >> (j % 32)) & 1) {
+				for (int w = 0; w < 4; ++w) { r[w] ^= col[j][w]; }
+			}
+		}
+		return r;
+	}
+
+	GF2Matrix squared() const
+	{
+		GF2Matrix result;
+		for (int j = 0; j < 128; ++j) { result.col[j] = apply(col[j]); }
+		return result;
+	}
+};
+
+/// The state after 2^log2_steps steps.
+Xoshiro128 xoshiro_skip(const Xoshiro128& start, int log2_steps)
+{
+	GF2Matrix m;
+	for (int j = 0; j < 128; ++j) {
+		GF2Matrix::State unit = {{0, 0, 0, 0}};
+		unit[j / 32] = uint32_t(1) << (j % 32);
+		Xoshiro128 x(unit);
+		x();
+		m.col[j] = x.state();
+	}
+	for (int i = 0; i < log2_steps; ++i) { m = m.squared(); }
+	return Xoshiro128(m.apply(start.state()));
+}
+
+template<typename Engine>
+std::vector<uint32_t> take(Engine engine, size_t n)
+{
+	std::vector<uint32_t> out(n);
+	for (auto& x : out) { x = engine(); }
+	return out;
+}
+
+} // namespace
+
+TEST(Pcg32, ReferenceOutput)
+{
+	// pcg32_srandom_r(&rng, 42, 54) in the reference C implementation:
+	Pcg32 pcg(42, 54);
+	const uint32_t expected[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+	for (uint32_t e : expected) { EXPECT_EQ(pcg(), e); }
+}
+
+TEST(Pcg32, Advance)
+{
+	const Pcg32 start(123, 456);
+	for (uint64_t k : {0, 1, 2, 3, 7, 64, 1000, 12345}) {
+		Pcg32 stepped = start;
+		for (uint64_t i = 0; i < k; ++i) { stepped(); }
+		Pcg32 advanced = start;
+		advanced.advance(k);
+		EXPECT_EQ(advanced, stepped) << k;
+		EXPECT_EQ(advanced(), stepped()) << k;
+	}
+
+	// Going all the way around the period of 2^64 in two jumps:
+	Pcg32 around = start;
+	around.advance(UINT64_MAX);
+	around();
+	EXPECT_EQ(around, start);
+
+	Pcg32 jumped = start, halves = start;
+	jumped.jump();
+	halves.advance(uint64_t(1) << 47);
+	halves.advance(uint64_t(1) << 47);
+	EXPECT_EQ(jumped, halves);
+	EXPECT_NE(jumped, start);
+}
+
+TEST(Pcg32, Split)
+{
+	Pcg32 parent(7);
+	const Pcg32 a = parent.split(1);
+	const Pcg32 b = parent.split(2);
+	const Pcg32 c = parent.split(1); // Same stream, different seed
+	const auto seq_parent = take(parent, 1000);
+	const auto seq_a = take(a, 1000), seq_b = take(b, 1000), seq_c = take(c, 1000);
+
+	std::vector<uint32_t> all;
+	for (const auto* seq : {&seq_parent, &seq_a, &seq_b, &seq_c}) { all.insert(all.end(), seq->begin(), seq->end()); }
+	std::sort(all.begin(), all.end());
+	const size_t num_duplicates = all.size() - size_t(std::unique(all.begin(), all.end()) - all.begin());
+	EXPECT_LE(num_duplicates, 1u) << "4000 draws out of 2^32 should (almost) never repeat";
+
+	Pcg32 parent2(7);
+	EXPECT_EQ(take(parent2.split(1), 1000), seq_a) << "Splitting is deterministic";
+}
+
+TEST(Xoshiro128, JumpMatchesTransitionMatrix)
+{
+	const Xoshiro128 start(99);
+	Xoshiro128 jumped = start;
+	jumped.jump();
+	EXPECT_EQ(jumped, xoshiro_skip(start, 64));
+
+	Xoshiro128 long_jumped = start;
+	long_jumped.long_jump();
+	EXPECT_EQ(long_jumped, xoshiro_skip(start, 96));
+
+	// And the matrix itself agrees with stepping:
+	Xoshiro128 stepped = start;
+	for (int i = 0; i < 1024; ++i) { stepped(); }
+	EXPECT_EQ(stepped, xoshiro_skip(start, 10));
+}
+
+TEST(Xoshiro128, ReferenceOutput)
+{
+	// xoshiro128** (next() in the reference C implementation) from s = {1, 2, 3, 4}:
+	const std::array<uint32_t, 4> s = {{1, 2, 3, 4}};
+	Xoshiro128 x(s);
+	const uint32_t expected[] = { 0x00002d00, 0x00000000, 0x005a7080, 0x04389d80, 0x79199d9b, 0x61963b24 };
+	for (uint32_t e : expected) { EXPECT_EQ(x(), e); }
+	EXPECT_EQ(Xoshiro128(x.state()), x);
+}
+
+// ----------------------------------------------------------------------------
+// Distributions
+
+TEST(Random, FillFloats)
+{
+	RandomXoshiro a(5);
+	RandomXoshiro b = a;
+	std::vector<float> floats(1001);
+	a.fill_floats(floats.data(), floats.size());
+	for (float f : floats) {
+		EXPECT_GE(f, 0.0f);
+		EXPECT_LT(f, 1.0f);
+		EXPECT_EQ(f, b.random_float());
+	}
+	EXPECT_EQ(a.engine(), b.engine());
+}
+
+TEST(Random, NormalDistribution)
+{
+	// Deterministic, so the tolerances are about five standard errors without any flakiness.
+	const size_t n = 2000000;
+	Random random(17);
+	const int NUM_BINS = 32; // Of width 0.25 over [-4, 4]
+	std::vector<size_t> bins(NUM_BINS + 2, 0); // Plus one for each tail
+	double sum = 0, sum_sq = 0, sum_4 = 0;
+	size_t beyond_r = 0; // |x| > 3.44262, i.e. from the base strip of the ziggurat
+
+	for (size_t i = 0; i < n; ++i) {
+		const double x = random.random_normal();
+		sum += x;
+		sum_sq += x * x;
+		sum_4 += x * x * x * x;
+		beyond_r += std::abs(x) > 3.442620;
+		const int bin = x < -4 ? 0 : x >= 4 ? NUM_BINS + 1 : 1 + int((x + 4) / 0.25);
+		bins[bin] += 1;
+	}
+
+	const double mean = sum / n, var = sum_sq / n - mean * mean;
+	EXPECT_NEAR(mean,      0, 0.004);
+	EXPECT_NEAR(var,       1, 0.005);
+	EXPECT_NEAR(sum_4 / n, 3, 0.03) << "Kurtosis";
+
+	auto cdf = [](double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); };
+	const double p_beyond_r = 2 * cdf(-3.442620);
+	EXPECT_NEAR(double(beyond_r) / n, p_beyond_r, 5 * std::sqrt(p_beyond_r / n));
+
+	for (int b = 0; b < NUM_BINS + 2; ++b) {
+		const double lo = b == 0 ? -1e9 : -4 + 0.25 * (b - 1);
+		const double hi = b == NUM_BINS + 1 ? 1e9 : -4 + 0.25 * b;
+		const double p = cdf(hi) - cdf(lo);
+		EXPECT_NEAR(double(bins[b]) / n, p, 5 * std::sqrt(p * (1 - p) / n) + 1e-6) << "[" << lo << ", " << hi << ")";
+	}
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/spatial_hash.hpp>
+
+using namespace emath;
+
+namespace {
+
+template<int DIM>
+class Tester
+{
+public:
+	using Hash  = SpatialHash<DIM>;
+	using V     = typename Hash::V;
+	using AABB  = typename Hash::AABB;
+	using Index = typename Hash::Index;
+
+	explicit Tester(float cell_size, unsigned seed) : _hash(cell_size), _rng(seed) {}
+
+	V random_pos(float extent)
+	{
+		std::uniform_real_distribution<float> dist(-extent, extent);
+		V v;
+		for (int d = 0; d < DIM; ++d) { v[d] = dist(_rng); }
+		return v;
+	}
+
+	/// Random inserts, removes and moves, checking everything against brute force along the way.
+	void run(int num_steps, float extent)
+	{
+		Index next_id = 0;
+		for (int step = 0; step < num_steps; ++step) {
+			const int op = std::uniform_int_distribution<int>(0, 9)(_rng);
+			if (op < 4 || _pos.empty()) {
+				const V pos = random_pos(extent);
+				_hash.insert(next_id, pos);
+				_pos[next_id++] = pos;
+			} else {
+				auto it = _pos.begin();
+				std::advance(it, std::uniform_int_distribution<size_t>(0, _pos.size() - 1)(_rng));
+				if (op < 6) {
+					ASSERT_TRUE(_hash.remove(it->first, it->second));
+					ASSERT_FALSE(_hash.remove(it->first, it->second));
+					_pos.erase(it);
+				} else {
+					// Half of the moves stay close, and so mostly in the same cell:
+					V new_pos = random_pos(extent);
+					if (op < 8) { new_pos = it->second + random_pos(0.1f * _hash.cell_size()); }
+					_hash.move(it->first, it->second, new_pos);
+					it->second = new_pos;
+				}
+			}
+			ASSERT_FALSE(_hash.remove(next_id + 1000, random_pos(extent)));
+
+			if (step % 16 == 0) {
+				check_contents();
+				check_queries(extent);
+				if (::testing::Test::HasFatalFailure()) { return; }
+			}
+		}
+		check_contents();
+		check_queries(extent);
+	}
+
+	void check_contents()
+	{
+		ASSERT_EQ(_hash.size(), _pos.size());
+		std::set<std::vector<int>> cells;
+		for (const auto& kv : _pos) {
+			const auto c = _hash.cell_of(kv.second);
+			std::vector<int> cell(DIM);
+			for (int d = 0; d < DIM; ++d) { cell[d] = c[d]; }
+			cells.insert(cell);
+
+			size_t count = 0;
+			const typename Hash::Entry* entries = _hash.cell_entries(c, &count);
+			ASSERT_NE(entries, nullptr);
+			const auto found = std::find_if(entries, entries + count, [&](const typename Hash::Entry& e) { return e.id == kv.first; });
+			ASSERT_NE(found, entries + count) << "Entity " << kv.first << " missing from its cell";
+			ASSERT_EQ(found->pos, kv.second);
+		}
+		ASSERT_EQ(_hash.num_cells(), cells.size());
+	}
+
+	void check_queries(float extent)
+	{
+		std::uniform_real_distribution<float> radius_dist(0, extent);
+		for (int i = 0; i < 8; ++i) {
+			const V center = random_pos(1.2f * extent);
+			// Tiny, medium, and large enough to go through all the cells instead:
+			for (const float radius : {0.3f * _hash.cell_size(), radius_dist(_rng), 10 * extent}) {
+				std::vector<Index> expected, actual;
+				for (const auto& kv : _pos) {
+					if (distance_sq(kv.second, center) <= radius * radius) { expected.push_back(kv.first); }
+				}
+				_hash.query_radius(center, radius, &actual);
+				std::sort(actual.begin(), actual.end());
+				ASSERT_EQ(actual, expected) << "radius " << radius;
+
+				const AABB box = AABB::from_min_max(center - V(radius), center + V(radius * 0.5f));
+				expected.clear();
+				actual.clear();
+				for (const auto& kv : _pos) {
+					if (box.contains(kv.second)) { expected.push_back(kv.first); }
+				}
+				_hash.query_aabb(box, &actual);
+				std::sort(actual.begin(), actual.end());
+				ASSERT_EQ(actual, expected) << "box half-size " << radius;
+			}
+		}
+	}
+
+	Hash& hash() { return _hash; }
+
+	void clear()
+	{
+		_hash.clear();
+		_pos.clear();
+	}
+
+private:
+	Hash               _hash;
+	std::mt19937       _rng;
+	std::map<Index, V> _pos; // Sorted, like the sorted query results
+};
+
+} // namespace
+
+TEST(SpatialHash, MatchesBruteForce2D)
+{
+	Tester<2> tester(2.5f, 0);
+	tester.run(3000, 40);
+}
+
+TEST(SpatialHash, MatchesBruteForce3D)
+{
+	Tester<3> tester(1.0f, 1);
+	tester.run(3000, 8);
+}
+
+TEST(SpatialHash, ManyPerCell)
+{
+	// Few cells, many entities in each:
+	Tester<2> tester(10.0f, 2);
+	tester.run(2000, 15);
+}
+
+TEST(SpatialHash, ReuseAfterClear)
+{
+	Tester<3> tester(0.5f, 3);
+	tester.run(500, 5);
+	tester.clear();
+	EXPECT_TRUE(tester.hash().empty());
+	EXPECT_EQ(tester.hash().num_cells(), 0u);
+	std::vector<uint32_t> out;
+	tester.hash().query_radius(Vec3f(0, 0, 0), 100, &out);
+	EXPECT_TRUE(out.empty());
+	tester.run(500, 5);
+}
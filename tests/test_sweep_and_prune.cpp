@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/sweep_and_prune.hpp>
+
+using namespace emath;
+
+namespace {
+
+using Handle = SweepAndPrune::Handle;
+using Pair   = SweepAndPrune::Pair;
+using Pairs  = std::vector<std::pair<Handle, Handle>>;
+
+/// On a coarse grid, so that many boxes touch exactly. Some are zero-width or inverted.
+AABB2f random_box(std::mt19937& rng)
+{
+	auto coord = [&](int lo, int hi) { return 0.25f * std::uniform_int_distribution<int>(lo, hi)(rng); };
+	const Vec2f min(coord(0, 80), coord(0, 80));
+	Vec2f size(coord(1, 12), coord(1, 12));
+	switch (std::uniform_int_distribution<int>(0, 9)(rng)) {
+		case 0: size.x = 0; break;
+		case 1: size.y = 0; break;
+		case 2: size.x = -size.x; break;
+		case 3: size.y = -size.y; break;
+		case 4: size = Vec2f(0, 0); break;
+		default: break;
+	}
+	return AABB2f::from_min_max(min, min + size);
+}
+
+AABB2f jittered(const AABB2f& box, std::mt19937& rng)
+{
+	const Vec2f offset(0.25f * std::uniform_int_distribution<int>(-2, 2)(rng),
+	                   0.25f * std::uniform_int_distribution<int>(-2, 2)(rng));
+	return AABB2f::from_min_max(box.min() + offset, box.max() + offset);
+}
+
+Pairs all_pairs(const std::map<Handle, AABB2f>& boxes)
+{
+	Pairs pairs;
+	for (auto a = boxes.begin(); a != boxes.end(); ++a) {
+		for (auto b = std::next(a); b != boxes.end(); ++b) {
+			if (AABB2f::intersects(a->second, b->second)) {
+				pairs.emplace_back(a->first, b->first);
+			}
+		}
+	}
+	return pairs;
+}
+
+void expect_pairs(SweepAndPrune& sap, const std::map<Handle, AABB2f>& boxes, std::vector<Pair>* pairs)
+{
+	sap.find_pairs(pairs);
+	Pairs actual;
+	for (const Pair& p : *pairs) {
+		actual.emplace_back(p.a, p.b);
+	}
+	std::sort(actual.begin(), actual.end());
+	ASSERT_EQ(actual, all_pairs(boxes));
+}
+
+} // namespace
+
+TEST(SweepAndPrune, MatchesAllPairs)
+{
+	std::mt19937 rng(0);
+	SweepAndPrune sap;
+	std::map<Handle, AABB2f> boxes;
+	std::vector<Pair> pairs;
+
+	auto add = [&]() {
+		const AABB2f box = random_box(rng);
+		const Handle h = sap.add(box);
+		EXPECT_EQ(boxes.count(h), 0u) << "Handle " << h << " is still in use";
+		boxes[h] = box;
+		return h;
+	};
+
+	for (int i = 0; i < 200; ++i) { add(); }
+
+	for (int frame = 0; frame < 100; ++frame) {
+		std::vector<Handle> removed;
+		for (auto it = boxes.begin(); it != boxes.end();) {
+			const int r = std::uniform_int_distribution<int>(0, 99)(rng);
+			if (r < 3) {
+				sap.remove(it->first);
+				EXPECT_FALSE(sap.is_valid(it->first));
+				removed.push_back(it->first);
+				it = boxes.erase(it);
+				continue;
+			}
+			if (r < 40) {
+				it->second = jittered(it->second, rng);
+			} else if (r < 42) {
+				it->second = random_box(rng); // Teleport
+			}
+			sap.update(it->first, it->second);
+			++it;
+		}
+
+		// Many at once now and then, which sorts from scratch:
+		const int num_added = frame % 25 == 10 ? 150 : std::uniform_int_distribution<int>(0, 6)(rng);
+		for (int i = 0; i < num_added; ++i) {
+			const Handle h = add();
+			// Removed handles are not reused before the next find_pairs():
+			ASSERT_EQ(std::count(removed.begin(), removed.end(), h), 0);
+		}
+		ASSERT_EQ(sap.size(), boxes.size());
+
+		expect_pairs(sap, boxes, &pairs);
+		if (HasFatalFailure()) { return; }
+		for (const auto& kv : boxes) {
+			EXPECT_EQ(sap.bounds(kv.first).min(), kv.second.min());
+			EXPECT_EQ(sap.bounds(kv.first).max(), kv.second.max());
+		}
+	}
+
+	// Nothing moved, so nothing needs sorting:
+	expect_pairs(sap, boxes, &pairs);
+	EXPECT_EQ(sap.last_num_moves(), 0u);
+}
+
+TEST(SweepAndPrune, HandleReuse)
+{
+	SweepAndPrune sap;
+	std::vector<Pair> pairs;
+	const AABB2f box = AABB2f::from_min_max(Vec2f(0, 0), Vec2f(2, 2));
+	const Handle a = sap.add(box);
+	const Handle b = sap.add(box);
+	sap.find_pairs(&pairs);
+	ASSERT_EQ(pairs.size(), 1u);
+
+	sap.remove(a);
+	// Its endpoints are still there until the next find_pairs(), so it must not be handed out yet:
+	const Handle c = sap.add(box);
+	EXPECT_NE(c, a);
+	EXPECT_NE(c, b);
+	sap.find_pairs(&pairs);
+	ASSERT_EQ(pairs.size(), 1u);
+	EXPECT_EQ(pairs[0].a, std::min(b, c));
+	EXPECT_EQ(pairs[0].b, std::max(b, c));
+
+	// Now it is:
+	const Handle d = sap.add(AABB2f::from_min_max(Vec2f(1, 1), Vec2f(3, 3)));
+	EXPECT_EQ(d, a);
+	sap.find_pairs(&pairs);
+	EXPECT_EQ(pairs.size(), 3u);
+
+	// Removed and re-added before a find_pairs(): only the new box may count.
+	sap.remove(d);
+	const Handle e = sap.add(AABB2f::from_min_max(Vec2f(10, 10), Vec2f(11, 11)));
+	sap.find_pairs(&pairs);
+	EXPECT_NE(e, d);
+	EXPECT_EQ(pairs.size(), 1u);
+
+	sap.clear();
+	EXPECT_TRUE(sap.empty());
+	EXPECT_EQ(sap.add(box), 0u);
+	sap.find_pairs(&pairs);
+	EXPECT_TRUE(pairs.empty());
+}
+
+TEST(SweepAndPrune, TouchingAndDegenerate)
+{
+	SweepAndPrune sap;
+	std::map<Handle, AABB2f> boxes;
+	std::vector<Pair> pairs;
+	auto add = [&](float x0, float y0, float x1, float y1) {
+		const AABB2f box = AABB2f::from_min_max(Vec2f(x0, y0), Vec2f(x1, y1));
+		boxes[sap.add(box)] = box;
+	};
+	add(0, 0, 2, 2);
+	add(2, 0, 4, 2); // Touches the first along x
+	add(0, 2, 2, 4); // Touches the first along y
+	add(1, 1, 1, 3); // Zero width, inside the first and the third
+	add(3, 1, 3, 1); // A point inside the second
+	add(2, 1, 2, 1); // A point on the shared edge
+	add(3, 3, 1, 1); // Inverted
+	add(5, 5, 5, 5);
+	add(5, 5, 5, 5); // Two identical points
+	expect_pairs(sap, boxes, &pairs);
+	EXPECT_FALSE(pairs.empty());
+}
@@ -0,0 +1,105 @@
+// The ray packets must give the same answers as the scalar trace functions.
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/capsule.hpp>
+#include <emath/circle.hpp>
+#include <emath/trace.hpp>
+
+using namespace emath;
+using namespace emath::trace;
+
+namespace {
+
+std::vector<Ray> random_rays(std::mt19937& rng, int n)
+{
+	std::uniform_real_distribution<float> dist(-10, 10);
+	std::vector<Ray> rays(n);
+	for (Ray& r : rays) {
+		r.o = {dist(rng), dist(rng)};
+		r.d = {dist(rng), dist(rng)};
+	}
+	return rays;
+}
+
+bool trace_scalar(info& ti, const Circle& c)       { return ray_circle(ti, c); }
+bool trace_scalar(info& ti, const CapsuleBaked& c) { return ray_capsule(ti, c); }
+bool trace_scalar(info& ti, const AABB2f& b)       { return rayAABB(ti, b); }
+
+unsigned trace_packet(info_packet& tp, const Circle& c)       { return ray_circle(tp, c); }
+unsigned trace_packet(info_packet& tp, const CapsuleBaked& c) { return ray_capsule(tp, c); }
+unsigned trace_packet(info_packet& tp, const AABB2f& b)       { return rayAABB(tp, b); }
+
+template<typename Shape>
+void expect_packet_matches_scalar(const Shape& shape, int seed)
+{
+	std::mt19937 rng(seed);
+	int num_hits = 0;
+	for (int k = 0; k < 200; ++k) {
+		const auto rays = random_rays(rng, info_packet::SIZE);
+		info_packet packet(rays.data(), info_packet::SIZE, 2.0f);
+		const unsigned hits = trace_packet(packet, shape);
+
+		for (int lane = 0; lane < info_packet::SIZE; ++lane) {
+			info ti(rays[lane], 2.0f);
+			const bool hit = trace_scalar(ti, shape);
+			ASSERT_EQ(hit, ((hits >> lane) & 1) != 0) << "lane " << lane;
+			if (hit) {
+				const info tp = packet.get(lane);
+				EXPECT_NEAR(tp.t, ti.t, 1e-5f);
+				EXPECT_NEAR(tp.normal_dir.x, ti.normal_dir.x, 1e-4f);
+				EXPECT_NEAR(tp.normal_dir.y, ti.normal_dir.y, 1e-4f);
+				num_hits += 1;
+			}
+		}
+	}
+	EXPECT_GT(num_hits, 0);
+}
+
+} // namespace
+
+TEST(Trace, RayCircle)
+{
+	const Circle c{{1, 2}, 3};
+	info ti(Ray{{-10, 2}, {1, 0}}, 100);
+	ASSERT_TRUE(ray_circle(ti, c));
+	EXPECT_NEAR(ti.t, 8, 1e-5f);
+	EXPECT_LE(dot(ti.normal_dir, ti.ray.d), 0);
+
+	info miss(Ray{{-10, 10}, {1, 0}}, 100);
+	EXPECT_FALSE(ray_circle(miss, c));
+}
+
+TEST(Trace, RayAABB)
+{
+	info ti(Ray{{-5, 0.5f}, {1, 0}}, 100);
+	ASSERT_TRUE(rayAABB(ti, AABB2f::from_min_max({0, 0}, {1, 1})));
+	EXPECT_NEAR(ti.t, 5, 1e-5f);
+}
+
+TEST(Trace, RayCapsule)
+{
+	const CapsuleBaked cap(Capsule({0, 0}, {4, 0}, 1));
+	info ti(Ray{{2, 10}, {0, -1}}, 100);
+	ASSERT_TRUE(ray_capsule(ti, cap));
+	EXPECT_NEAR(ti.t, 9, 1e-5f);
+}
+
+TEST(Trace, RayCircleCCD)
+{
+	// A circle growing from radius 1 to 3 while the ray moves toward it: 5 - 4t = 1 + 2t
+	info ti(Ray{{-5, 0}, {4, 0}}, 1);
+	ASSERT_TRUE(ray_circle_ccd(ti, Circle{{0, 0}, 1}, Circle{{0, 0}, 3}));
+	EXPECT_NEAR(ti.t, 2.0f / 3.0f, 1e-5f);
+}
+
+TEST(Trace, PacketsMatchScalar)
+{
+	expect_packet_matches_scalar(Circle{{1, 2}, 3}, 7);
+	expect_packet_matches_scalar(CapsuleBaked(Capsule({-3, 1}, {4, -2}, 1.5f)), 8);
+	expect_packet_matches_scalar(CapsuleBaked(Capsule({2, 2}, {2, 2}, 2)), 9); // A circle
+	expect_packet_matches_scalar(AABB2f::from_min_max({-2, -1}, {3, 4}), 10);
+}
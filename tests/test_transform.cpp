@@ -0,0 +1,179 @@
+// The bulk kernels must agree with mul_pos / mul_dir, including the SIMD remainder loops.
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <emath/mat3.hpp>
+#include <emath/mat4.hpp>
+#include <emath/simd.hpp>
+#include <emath/transform.hpp>
+#include <emath/vec3.hpp>
+
+using namespace emath;
+
+namespace {
+
+/// Enough to fill two SIMD blocks and leave a remainder of one.
+constexpr size_t MAX_N = 2 * simd::WIDTH + 1;
+
+Mat4f random_mat4(std::mt19937& rng, bool affine)
+{
+	std::uniform_real_distribution<float> dist(-2, 2);
+	Mat4f m;
+	for (int i = 0; i < 16; ++i) { m.data()[i] = dist(rng); }
+	if (affine) {
+		m[0][3] = m[1][3] = m[2][3] = 0;
+		m[3][3] = 1;
+	} else {
+		m[3][3] = 10; // Keeps w away from zero
+	}
+	return m;
+}
+
+Mat3f random_mat3(std::mt19937& rng, bool affine)
+{
+	std::uniform_real_distribution<float> dist(-2, 2);
+	Mat3f m;
+	for (int i = 0; i < 9; ++i) { m.data()[i] = dist(rng); }
+	if (affine) {
+		m.M(0,2) = m.M(1,2) = 0;
+		m.M(2,2) = 1;
+	} else {
+		m.M(2,2) = 10;
+	}
+	return m;
+}
+
+template<class Vec>
+std::vector<Vec> random_vecs(std::mt19937& rng, size_t n)
+{
+	std::uniform_real_distribution<float> dist(-1, 1);
+	std::vector<Vec> v(n);
+	for (auto& x : v) {
+		for (int d = 0; d < int(sizeof(Vec) / sizeof(float)); ++d) { x[d] = dist(rng); }
+	}
+	return v;
+}
+
+template<class Vec>
+void expect_near(const Vec& a, const Vec& b, const char* what, size_t n, size_t i)
+{
+	for (int d = 0; d < int(sizeof(Vec) / sizeof(float)); ++d) {
+		EXPECT_NEAR(a[d], b[d], 1e-4f * (1 + std::abs(b[d]))) << what << " n=" << n << " i=" << i << " d=" << d;
+	}
+}
+
+using Kernel3 = void (*)(const Mat4f&, const Vec3f*, Vec3f*, size_t);
+using Kernel2 = void (*)(const Mat3f&, const Vec2f*, Vec2f*, size_t);
+
+/// Checks the out-of-place and in-place versions of a kernel against a scalar function.
+template<class Mat, class Vec, class Kernel, class Scalar>
+void check_kernel(const Mat& m, const std::vector<Vec>& in, Kernel kernel, void (*in_place)(const Mat&, Vec*, size_t),
+                  Scalar scalar, const char* what)
+{
+	const size_t n = in.size();
+	std::vector<Vec> out(n);
+	kernel(m, in.data(), out.data(), n);
+	std::vector<Vec> inout = in;
+	in_place(m, inout.data(), n);
+	for (size_t i = 0; i < n; ++i) {
+		const Vec expected = scalar(m, in[i]);
+		expect_near(out[i], expected, what, n, i);
+		EXPECT_EQ(inout[i], out[i]) << what << " in-place, n=" << n << " i=" << i;
+	}
+}
+
+} // namespace
+
+TEST(Transform, Mat4MatchesMulPos)
+{
+	std::mt19937 rng(1);
+	for (size_t n = 1; n <= MAX_N; ++n) {
+		const auto in = random_vecs<Vec3f>(rng, n);
+		const Mat4f affine = random_mat4(rng, true), projective = random_mat4(rng, false);
+		const auto pos = [](const Mat4f& m, const Vec3f& p) { return mul_pos(m, p); };
+		const auto dir = [](const Mat4f& m, const Vec3f& d) { return mul_dir(m, d); };
+		check_kernel(affine,     in, Kernel3(transform_points), transform_points, pos, "transform_points");
+		check_kernel(projective, in, Kernel3(project_points),   project_points,   pos, "project_points");
+		check_kernel(projective, in, Kernel3(transform_dirs),   transform_dirs,   dir, "transform_dirs");
+	}
+}
+
+TEST(Transform, Mat3MatchesMulPos)
+{
+	std::mt19937 rng(2);
+	for (size_t n = 1; n <= MAX_N; ++n) {
+		const auto in = random_vecs<Vec2f>(rng, n);
+		const Mat3f affine = random_mat3(rng, true), projective = random_mat3(rng, false);
+		const auto pos = [](const Mat3f& m, const Vec2f& p) { return mul_pos(m, p); };
+		const auto dir = [](const Mat3f& m, const Vec2f& d) { return mul_dir(m, d); };
+		check_kernel(affine,     in, Kernel2(transform_points), transform_points, pos, "transform_points");
+		check_kernel(projective, in, Kernel2(project_points),   project_points,   pos, "project_points");
+		check_kernel(projective, in, Kernel2(transform_dirs),   transform_dirs,   dir, "transform_dirs");
+	}
+}
+
+TEST(Transform, Strided)
+{
+	struct Vertex { Vec3f pos; Vec2f uv; Vec3f normal; int id; };
+	std::mt19937 rng(3);
+	const Mat4f m4 = random_mat4(rng, false);
+	const Mat3f m3 = random_mat3(rng, false);
+
+	for (size_t n = 1; n <= MAX_N; ++n) {
+		std::vector<Vertex> vertices(n);
+		const auto pos = random_vecs<Vec3f>(rng, n), normals = random_vecs<Vec3f>(rng, n);
+		const auto uvs = random_vecs<Vec2f>(rng, n);
+		for (size_t i = 0; i < n; ++i) { vertices[i] = {pos[i], uvs[i], normals[i], int(i)}; }
+
+		// Out of place, into a tightly packed array:
+		std::vector<Vec3f> projected(n);
+		project_points_strided(m4, &vertices[0].pos, sizeof(Vertex), projected.data(), sizeof(Vec3f), n);
+
+		// In place:
+		transform_points_strided(m4, &vertices[0].pos,    sizeof(Vertex), &vertices[0].pos,    sizeof(Vertex), n);
+		transform_dirs_strided  (m4, &vertices[0].normal, sizeof(Vertex), &vertices[0].normal, sizeof(Vertex), n);
+		project_points_strided  (m3, &vertices[0].uv,     sizeof(Vertex), &vertices[0].uv,     sizeof(Vertex), n);
+
+		std::vector<Vec2f> uv_dirs(n);
+		transform_dirs_strided  (m3, uvs.data(), sizeof(Vec2f), uv_dirs.data(), sizeof(Vec2f), n);
+		std::vector<Vec2f> uv_points(n);
+		transform_points_strided(m3, uvs.data(), sizeof(Vec2f), uv_points.data(), sizeof(Vec2f), n);
+
+		for (size_t i = 0; i < n; ++i) {
+			// transform_points is the affine part of mul_pos:
+			const Vec4f p4 = mul(m4, Vec4f(pos[i], 1));
+			expect_near(vertices[i].pos, Vec3f(p4.x, p4.y, p4.z), "transform_points_strided", n, i);
+			expect_near(vertices[i].normal, mul_dir(m4, normals[i]), "transform_dirs_strided", n, i);
+			expect_near(vertices[i].uv, mul_pos(m3, uvs[i]), "project_points_strided (Mat3f)", n, i);
+			expect_near(projected[i], mul_pos(m4, pos[i]), "project_points_strided", n, i);
+			expect_near(uv_dirs[i], mul_dir(m3, uvs[i]), "transform_dirs_strided (Mat3f)", n, i);
+			const Vec3f p3 = mul(m3, Vec3f(uvs[i].x, uvs[i].y, 1));
+			expect_near(uv_points[i], Vec2f(p3.x, p3.y), "transform_points_strided (Mat3f)", n, i);
+			EXPECT_EQ(vertices[i].id, int(i)) << "Only the given floats are written";
+		}
+	}
+}
+
+TEST(Transform, SingularDirs)
+{
+	std::mt19937 rng(4);
+	Mat4f flat4 = random_mat4(rng, true);
+	flat4[1][0] = flat4[1][1] = flat4[1][2] = 0;
+	Mat3f flat3 = random_mat3(rng, true);
+	flat3.M(1,0) = flat3.M(1,1) = 0;
+
+	for (size_t n = 1; n <= MAX_N; ++n) {
+		auto dirs3 = random_vecs<Vec3f>(rng, n);
+		auto dirs2 = random_vecs<Vec2f>(rng, n);
+		transform_dirs(flat4, dirs3.data(), n);
+		transform_dirs(flat3, dirs2.data(), n);
+		for (size_t i = 0; i < n; ++i) {
+			EXPECT_EQ(dirs3[i], Vec3f(0, 0, 0)) << n << " " << i;
+			EXPECT_EQ(dirs2[i], Vec2f(0, 0)) << n << " " << i;
+		}
+	}
+	EXPECT_EQ(mul_dir(flat4, Vec3f(1, 2, 3)), Vec3f(0, 0, 0)) << "Same as the scalar version";
+}